@@ -0,0 +1,70 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/un.h>
+
+/**
+ * @brief Line-oriented control socket for a running process
+ *
+ * Listens on a Unix-domain stream socket (mode 0600) and serves clients
+ * from its own thread with poll(), so nothing runs on the feed or
+ * calculation threads. Each request is one line, "<command> [args...]";
+ * the reply is the handler's text followed by a line holding only ".".
+ * Handlers run on the admin thread and must only touch state that is
+ * safe to read or steer from another thread. A handler that throws
+ * std::exception answers "error: <what>". "help" lists the commands.
+ *
+ * "{pid}" in the path is replaced by the process id, so instances started
+ * with the default path do not share a socket. start() refuses a path that
+ * another process is still listening on.
+ *
+ * Usage: socat - UNIX-CONNECT:/tmp/websocket_client.<pid>.sock
+ */
+class AdminServer {
+public:
+    using Handler = std::function<std::string(const std::vector<std::string>& args)>;
+
+    explicit AdminServer(const std::string& path);
+    ~AdminServer();
+    AdminServer(const AdminServer&) = delete;
+    AdminServer& operator=(const AdminServer&) = delete;
+
+    /**
+     * @brief Register a command; only before start()
+     * @param usage Arguments and one-line description shown by "help"
+     */
+    void addCommand(const std::string& name, const std::string& usage, Handler handler);
+
+    /**
+     * @brief Bind the socket (replacing a stale one) and start serving
+     * @throws std::runtime_error if the path is live, not a socket, or cannot be bound
+     */
+    void start();
+    void stop();
+
+    const std::string& path() const { return m_path; }
+
+private:
+    struct Command {
+        std::string usage;
+        Handler handler;
+    };
+
+    std::string m_path;
+    std::map<std::string, Command> m_commands;
+    int m_listener = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+
+    void removeStaleSocket(const sockaddr_un& address) const;
+    void serveLoop();
+    std::string execute(const std::string& line) const;
+};
+
+#endif // ADMIN_SERVER_H
@@ -3,16 +3,100 @@
 
 #include <atomic>
 #include <mutex>
+#include <string>
+#include <vector>
+
+class TiledMatrixFile;
+class PreemptionGate;
+class DistributedInverter;
+class SparseMatrix;
+class SparseLU;
 
 class CalculationClass {
+public:
+    /**
+     * @brief Inversion engine used by run()
+     *
+     * GaussJordan keeps the original five-buffer pipeline (A, A_temp, X, E).
+     * InPlace inverts A over itself with a pivot permutation vector and
+     * verifies against a handful of sampled rows of the original matrix,
+     * so the working set is ~n^2 doubles instead of 4n^2.
+     * Recursive uses the same lean layout but inverts through recursive
+     * Schur complements (see MatrixKernels::invertRecursive).
+     * NewtonSchulz keeps A intact and iterates X <- X(2I - AX) on top of the
+     * blocked GEMM, optionally warm-started from a previous inverse.
+     * OutOfCore never holds the matrix in RAM: tiles live in a memory-mapped
+     * scratch file and stream through a bounded cache (see TiledMatrixFile).
+     * Distributed runs the same tiled sweep across several nodes, this
+     * process coordinating (see DistributedInverter).
+     *
+     * Every engine but GaussJordan and OutOfCore checks sparsity at ingest:
+     * a matrix whose density is at most Options::sparseThreshold stays in
+     * CSR form and is factored by sparse LU instead (see SparseLU), so
+     * memory and time follow the nonzeros rather than n^2.
+     */
+    enum class Engine { GaussJordan, InPlace, Recursive, NewtonSchulz, OutOfCore, Distributed };
+
+    /**
+     * @brief Engine tuning knobs that are not part of the job itself
+     */
+    struct Options {
+        int tileSize = 256;              // OutOfCore tile edge
+        int cacheTiles = 0;              // OutOfCore resident tiles (0 = minimum)
+        std::string scratchDir = "/tmp"; // OutOfCore backing file directory
+        PreemptionGate *gate = nullptr;  // Feed gate checked by every engine but Distributed
+        int preemptColumns = 0;          // Gauss-Jordan column steps between preemption points (0 = never)
+        bool perfCounters = false;       // run() reports hardware counters per inversion
+        DistributedInverter *distributed = nullptr; // Coordinator of the Distributed engine
+        double density = 1.;             // Fraction of off-diagonal entries generated nonzero
+        double sparseThreshold = 0.01;   // Density at or below which ingest keeps CSR (0 = always dense)
+        const std::atomic<int> *liveSize = nullptr; // run() re-reads the matrix size per inversion when set
+    };
+
+    static Engine engineFromString(const std::string& name);
+    static const char* engineName(Engine engine);
+
 private:
     int n;
-    double *A, *X, *A_temp, *X_temp, *E;
+    Engine engine;
+    Options options;
+    double *A, *X, *A_temp, *E;
+    TiledMatrixFile *tiled; // OutOfCore storage, replaces A
+    SparseMatrix *sparse;   // CSR storage, replaces A when ingest finds the matrix sparse
+    SparseLU *factors;      // Sparse LU made by the last invert() of a sparse matrix
+    int *perm;             // Row interchanges made by gaussJordanInPlace()
+    int sampleCount;
+    int *sampleIdx;        // Row indices of the retained samples
+    double *sampleRows;    // sampleCount x n copy of the original rows
+    int iterations;        // Newton-Schulz steps taken by the last invert()
+    int stepPhase;         // Resumable Gauss-Jordan state: sweep phase
+    int stepColumn;        // ... and next column within it
     void printRow(int i);
     void handleMemoryError();
+    void allocateDense();
+    void releaseDense();
+    void generateRow(int i, unsigned int *seed, std::vector<int>& cols, std::vector<double>& values);
+    int gaussJordanStep(int columns);
+    int gaussJordanInPlaceStep(int columns);
+    int preemptionStride() const;
+    double inversionFlops() const;
+    void preemptionPoint();
 
 public:
-    CalculationClass(int size);
+    explicit CalculationClass(int size, Engine engine = Engine::GaussJordan);
+    CalculationClass(int size, Engine engine, const Options& options);
+    ~CalculationClass();
+    CalculationClass(const CalculationClass&) = delete;
+    CalculationClass& operator=(const CalculationClass&) = delete;
+
+    /**
+     * @brief Refill the existing buffers with a new random matrix
+     * @param seed rand_r() state for per-thread generation; rand() if null
+     */
+    void reset(unsigned int *seed = nullptr);
+
+    int size() const { return n; }
+    Engine getEngine() const { return engine; }
     void printResult();
     void printEquation();
     void mainElement();
@@ -20,6 +104,15 @@ public:
     int gaussJordan();
     void matrixMultiplication();
     double calculateAccuracy();
+    int gaussJordanInPlace();
+    int invertRecursive();
+    int newtonSchulz(const double *guess = nullptr);
+    int invertOutOfCore();
+    int invertDistributed();
+    int invertSparse();
+    int invert();
+    double sampledResidual();
+    double verify();
     void run(std::atomic<bool>& flag, std::atomic<int>& heavyTasksCount, std::mutex& mutex);
 };
 
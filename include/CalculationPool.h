@@ -0,0 +1,100 @@
+#ifndef CALCULATION_POOL_H
+#define CALCULATION_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CalculationClass.h"
+
+/**
+ * @brief Throughput mode: many independent inversions in parallel
+ *
+ * A fixed set of workers pull jobs from a shared bounded queue. Each worker
+ * owns one CalculationClass for the whole run and refills it per job
+ * (CalculationClass::reset), so there is no per-job allocation and every
+ * workspace is first touched by the thread that uses it. The producer keeps
+ * the queue a couple of jobs deep per active worker until the stop flag is
+ * set. When Options::liveSize is set, a worker rebuilds its workspace once
+ * the size it points at changes.
+ *
+ * The cores are shared out between the workers: each one's kernels fan out
+ * to at most cores / workers tasks (MatrixKernels::setThreadBudget), so a
+ * full pool does not oversubscribe the machine.
+ */
+class CalculationPool {
+public:
+    /**
+     * @brief Counters owned by one worker, readable from any thread
+     */
+    struct WorkerStats {
+        std::atomic<int> completed{0};       // Jobs inverted successfully
+        std::atomic<int> failed{0};          // Singular / non-converged jobs
+        std::atomic<long long> busyMicros{0}; // Time spent inside jobs
+    };
+
+    CalculationPool(int workers, int matrixSize, CalculationClass::Engine engine,
+                    const CalculationClass::Options& options);
+    ~CalculationPool();
+    CalculationPool(const CalculationPool&) = delete;
+    CalculationPool& operator=(const CalculationPool&) = delete;
+
+    /**
+     * @brief Start the workers and feed them until flag is set, then join
+     * @param mutex Console mutex shared with the other threads
+     */
+    void run(std::atomic<bool>& flag, std::mutex& mutex);
+
+    int workerCount() const { return m_workers; }
+    int threadsPerWorker() const { return m_innerThreads; }
+
+    /**
+     * @brief Let only the first active workers take jobs; the rest park
+     * @param active Clamped to [1, workerCount()]; threads are never added
+     * @return The count now in effect
+     */
+    int setActiveWorkers(int active);
+    int activeWorkers() const;
+    const WorkerStats& workerStats(int index) const { return *m_stats[index]; }
+
+    /**
+     * @brief Aggregate of WorkerStats::completed over all workers
+     */
+    int totalCompleted() const;
+
+    /**
+     * @brief Print per-worker and aggregate counters, with inversions per
+     *        second over the measured wall time of the last run()
+     */
+    void printStats() const;
+
+private:
+    struct Job {
+        int id;
+        unsigned int seed;
+    };
+
+    int m_workers;
+    int m_innerThreads;          // Kernel task budget of each worker
+    int m_matrixSize;
+    CalculationClass::Engine m_engine;
+    CalculationClass::Options m_options;
+
+    std::deque<Job> m_queue;
+    int m_active;                // Workers [0, m_active) take jobs; guarded by m_queueMutex
+    mutable std::mutex m_queueMutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_spaceReady;
+    bool m_stopping;
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<WorkerStats>> m_stats;
+    std::atomic<long long> m_runMicros{0};  // Wall time of the last run(), workers joined
+
+    void workerLoop(int index, std::mutex& mutex);
+    void stop();
+};
+
+#endif // CALCULATION_POOL_H
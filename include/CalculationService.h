@@ -0,0 +1,185 @@
+#ifndef CALCULATION_SERVICE_H
+#define CALCULATION_SERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ResultCache;
+
+/**
+ * @brief Typed calculation jobs with priorities and deadlines
+ *
+ * Any thread can submit a job; results come back through a std::future or
+ * a callback run on the worker thread. Submission never takes a lock: jobs
+ * are pushed onto an atomic intrusive list (the inbox). Workers move the
+ * inbox into a priority heap ordered by priority, then deadline, then
+ * submission order, and pop from it. A job whose deadline has passed when
+ * it reaches the front is not executed and completes as Expired.
+ *
+ * Every submitted job completes exactly once: a job that throws completes
+ * as Failed with the exception message, jobs still queued at stop()
+ * complete as Expired, and a job submitted after stop() completes at once
+ * as Rejected. An exception thrown by a callback is logged and does not
+ * take the worker down.
+ *
+ * Every result carries its queueing delay and execution time, and the
+ * service keeps aggregate counters for both. With enableCache, results are
+ * memoised by content hash so repeated inputs skip the kernel.
+ */
+class CalculationService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class JobType {
+        Invert,           // value = a^-1
+        Solve,            // value = x with a * x = b
+        Multiply,         // value = a * b
+        CovarianceUpdate  // value = decay * a + (1 - decay) * b^T b / rows(b)
+    };
+
+    enum class Status { Done, Failed, Expired, Rejected };
+
+    /**
+     * @brief Dense row-major matrix
+     */
+    struct Matrix {
+        int rows = 0;
+        int cols = 0;
+        std::vector<double> data;
+    };
+
+    struct Request {
+        JobType type = JobType::Invert;
+        int priority = 0;                        // Higher runs first
+        Clock::time_point deadline = Clock::time_point::max();
+        Matrix a;
+        Matrix b;
+        double decay = 0.95;                     // CovarianceUpdate only
+    };
+
+    struct Result {
+        Status status = Status::Failed;
+        Matrix value;
+        std::chrono::microseconds queueDelay{0};
+        std::chrono::microseconds execTime{0};
+        std::string error;  // Why a Failed job failed, when it threw
+    };
+
+    using Callback = std::function<void(Result&&)>;
+
+    /**
+     * @brief Aggregate counters (snapshot)
+     */
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t expired = 0;
+        uint64_t rejected = 0;        // Submitted after stop()
+        uint64_t callbackErrors = 0;  // Callbacks that threw
+        uint64_t queueMicros = 0;     // Sum over dequeued jobs
+        uint64_t execMicros = 0;      // Sum over executed jobs
+        uint64_t maxQueueMicros = 0;
+    };
+
+    CalculationService();
+    ~CalculationService();
+    CalculationService(const CalculationService&) = delete;
+    CalculationService& operator=(const CalculationService&) = delete;
+
+    void start(int workers);
+    void stop();
+
+    /**
+     * @brief Serve repeated requests from a ResultCache of capacityBytes
+     *        (call before start; 0 disables)
+     */
+    void enableCache(size_t capacityBytes);
+
+    std::future<Result> submit(Request request);
+    void submit(Request request, Callback callback);
+
+    Stats stats() const;
+    void printStats() const;
+
+    /**
+     * @brief Drive the service with the random-inversion workload of
+     *        CalculationClass::run until flag is set
+     *
+     * Keeps two jobs per worker queued, with rotating priorities, so the
+     * priority and deadline ordering is what decides which runs next.
+     */
+    void run(std::atomic<bool>& flag, std::atomic<int>& heavyTasksCount, std::mutex& mutex,
+             int matrixSize, std::chrono::milliseconds deadline);
+
+    static const char* statusName(Status status);
+
+    /**
+     * @brief Result shape of a job on a (aRows x aCols) and b (bRows x bCols)
+     * @throws std::invalid_argument if the shapes do not fit the job type
+     */
+    static void resultShape(JobType type, int aRows, int aCols, int bRows, int bCols,
+                            int& rows, int& cols);
+
+    /**
+     * @brief Run one job on caller-owned row-major buffers
+     *
+     * The same code path serves queued jobs and out-of-process workers, so
+     * a job gives bit-identical results wherever it runs.
+     *
+     * @param out Receives the result, sized by resultShape()
+     * @return false if the matrix is singular
+     */
+    static bool execute(JobType type, double decay,
+                        const double* a, int aRows, int aCols,
+                        const double* b, int bRows, int bCols, double* out);
+
+private:
+    struct Job {
+        Request request;
+        Callback callback;
+        Clock::time_point enqueued;
+        uint64_t sequence = 0;
+        Job* next = nullptr;
+    };
+
+    std::atomic<Job*> m_inbox{nullptr};
+    std::atomic<uint64_t> m_sequence{0};
+    std::vector<Job*> m_heap;      // Guarded by m_heapMutex
+    std::mutex m_heapMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopped{false};  // Set by stop(): new jobs are rejected
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<ResultCache> m_cache;
+
+    std::atomic<uint64_t> m_submitted{0};
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_failed{0};
+    std::atomic<uint64_t> m_expired{0};
+    std::atomic<uint64_t> m_rejected{0};
+    std::atomic<uint64_t> m_callbackErrors{0};
+    std::atomic<uint64_t> m_queueMicros{0};
+    std::atomic<uint64_t> m_execMicros{0};
+    std::atomic<uint64_t> m_maxQueueMicros{0};
+
+    void push(Job* job);
+    void drainInbox();
+    void expireQueued();
+    void complete(Job* job, Result&& result);
+    Job* popNext();
+    void workerLoop();
+    void execute(Job* job);
+    static bool execute(const Request& request, Matrix& value);
+};
+
+#endif // CALCULATION_SERVICE_H
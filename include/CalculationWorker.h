@@ -0,0 +1,77 @@
+#ifndef CALCULATION_WORKER_H
+#define CALCULATION_WORKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Out-of-process calculation worker and its wire protocol
+ *
+ * A worker reads job requests from a Unix-domain SOCK_SEQPACKET socket.
+ * Each request carries a memfd (SCM_RIGHTS) laid out as [a | b | result],
+ * row-major doubles; the worker maps it, runs the job through
+ * CalculationService::execute straight into the result region and replies
+ * with a status. No matrix data crosses the socket in either direction.
+ *
+ * serve() is used by the calculation_worker executable; the dispatching
+ * side is WorkerProcessPool.
+ */
+class CalculationWorker {
+public:
+    static constexpr uint32_t kMagic = 0x434a4f42;  // "CJOB"
+
+    struct JobMessage {
+        uint32_t magic;
+        uint32_t type;          // CalculationService::JobType
+        uint64_t id;
+        int32_t aRows, aCols;
+        int32_t bRows, bCols;
+        double decay;
+        uint64_t bytes;         // Size of the attached buffer
+    };
+
+    enum ReplyStatus : uint32_t { Done = 0, Singular = 1, Rejected = 2 };
+
+    struct ReplyMessage {
+        uint32_t magic;
+        uint32_t status;        // ReplyStatus
+        uint64_t id;
+        uint64_t execMicros;
+    };
+
+    /**
+     * @brief Bytes of the [a | b | result] buffer for a job
+     * @throws std::invalid_argument if the shapes do not fit the job type
+     */
+    static size_t bufferBytes(const JobMessage& job, size_t* resultOffset = nullptr);
+
+    /**
+     * @brief Send a job with its buffer handle
+     * @return false if the peer has gone away
+     */
+    static bool sendJob(int socket, const JobMessage& job, int bufferFd);
+
+    /**
+     * @brief Receive a job; bufferFd is -1 if none was attached
+     * @return false on end of stream or a malformed message
+     */
+    static bool receiveJob(int socket, JobMessage& job, int& bufferFd);
+
+    static bool sendReply(int socket, const ReplyMessage& reply);
+    static bool receiveReply(int socket, ReplyMessage& reply);
+
+    /**
+     * @brief Execute jobs from a connected socket until the peer closes it
+     * @return Number of jobs served
+     */
+    static uint64_t serve(int socket);
+
+    /**
+     * @brief Listen on a filesystem socket and serve one dispatcher at a time
+     * @return Non-zero if the socket cannot be set up
+     */
+    static int listen(const std::string& path);
+};
+
+#endif // CALCULATION_WORKER_H
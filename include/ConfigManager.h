@@ -1,9 +1,15 @@
 #ifndef CONFIG_MANAGER_H
 #define CONFIG_MANAGER_H
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
+#include "RcuPointer.h"
 
 /**
  * @brief Configuration management class for loading JSON-based configurations
@@ -14,6 +20,28 @@
  * Configuration files are expected to be in the config/ directory with names:
  * - demo.json for demo/sandbox environment
  * - prod.json for production environment
+ *
+ * loadConfig() validates the JSON and compiles it once into an immutable
+ * Snapshot. The getters return references into that snapshot, and hot-path
+ * components keep a pointer to it, so reading settings after startup never
+ * touches the JSON again.
+ *
+ * reload() re-reads the file, re-validates it with validateConfig() and,
+ * if it passes, publishes a new snapshot by atomic pointer swap; the old
+ * one is freed once every registered reader has moved past it (see
+ * RcuPointer). An invalid file leaves the running configuration alone.
+ *
+ * Each load resolves three layers, later ones winning: the JSON file,
+ * environment variables WSCLIENT__<Section>__<field>=<value>, then the
+ * "--set Section.field=value" overrides from the command line. Values
+ * that parse as JSON (numbers, booleans, arrays) keep that type, anything
+ * else is a string. The OKXDataSrc API credentials are not part of the
+ * layered JSON: they come from OKX_API_KEY, OKX_API_SECRET and
+ * OKX_API_PASSPHRASE, or from file descriptors (OKX_API_SECRET_FD=3 or
+ * --secret-fd API_secret=3), are read once and go straight into the
+ * compiled snapshot. A configuration file that holds them is rejected.
+ * Without any credentials the private channel stays off; a partial set is
+ * rejected.
  */
 class ConfigManager {
 public:
@@ -21,9 +49,9 @@ public:
      * @brief Configuration structure for OKX Data Source
      */
     struct OKXConfig {
-        std::string url_pub;        // Public WebSocket URL
-        std::string url_private;    // Private WebSocket URL
-        std::string API_key;        // API Key
+        std::string url_pub = "wss://ws.okx.com:8443/ws/v5/public";       // Public WebSocket URL
+        std::string url_private = "wss://ws.okx.com:8443/ws/v5/private";  // Private WebSocket URL
+        std::string API_key;        // API Key (empty = no private channel)
         std::string API_secret;     // API Secret
         std::string API_passphrase; // API Passphrase
     };
@@ -35,10 +63,148 @@ public:
         OKXConfig OKXDataSrc;
     };
 
+    /**
+     * @brief One market data channel subscribed to on connect
+     */
+    struct Subscription {
+        std::string channel;  // OKX channel, e.g. "bbo-tbt", "books5"
+        std::string instId;   // Instrument, e.g. "BTC-USDT"
+    };
+
+    /**
+     * @brief Market data feed settings (optional section "Feed")
+     */
+    struct FeedConfig {
+        std::vector<Subscription> subscriptions = {{"bbo-tbt", "BTC-USDT"}};
+        // Subscribe frame for the list above, serialized once at compile time
+        std::string subscribe_message = R"({"op":"subscribe","args":[{"channel":"bbo-tbt","instId":"BTC-USDT"}]})";
+        std::string capture_path;             // Raw message capture file, read at startup (empty = off)
+    };
+
+    /**
+     * @brief Thread placement and run length (optional section "Threading")
+     */
+    struct ThreadingConfig {
+        int run_seconds = 60;                 // How long main() runs the feed and calculations
+        int feed_cpu = -1;                    // CPU the WebSocket thread is pinned to (-1 = any)
+        int calculation_cpu = -1;             // CPU the calculation thread is pinned to (-1 = any)
+    };
+
+    /**
+     * @brief Feed socket options (optional section "Socket")
+     */
+    struct SocketConfig {
+        bool tcp_nodelay = true;              // Disable Nagle on the feed connection
+        int receive_buffer_bytes = 0;         // SO_RCVBUF for the feed connection (0 = OS default)
+    };
+
+    enum class LogLevel { Debug, Info, Warn, Error };
+
+    /**
+     * @brief Console output settings (optional section "Logging")
+     */
+    struct LoggingConfig {
+        LogLevel level = LogLevel::Info;      // "debug", "info", "warn" or "error"; book updates print at info
+        bool access_log = true;               // websocketpp connection access log
+    };
+
+    /**
+     * @brief Startup warm-up before the feed connects (optional section "Warmup")
+     */
+    struct WarmupConfig {
+        bool resolve_dns = true;              // Resolve the feed host ahead of the connection
+        int decode_passes = 1000;             // Sample book updates run through the decoder
+        int kernel_passes = 1;                // Small inversions with the configured engine
+        bool lock_memory = false;             // mlockall(MCL_CURRENT) once workspaces are allocated; not with out_of_core
+    };
+
+    /**
+     * @brief Order entry on the private connection (optional section "Orders"), read at startup
+     */
+    struct OrdersConfig {
+        bool enabled = false;                 // Start the order gateway when API credentials are set
+        std::string inst_id = "BTC-USDT";     // Instrument the order templates are built for
+        std::string td_mode = "cash";         // OKX trade mode: cash, cross, isolated
+        std::string ord_type = "limit";       // OKX order type: limit, post_only, ioc, ...
+        int px_decimals = 1;                  // Price decimals sent (instrument tick size)
+        int sz_decimals = 8;                  // Size decimals sent (instrument lot size)
+        std::string client_id_prefix = "ws";  // clOrdId = prefix + number, up to 8 letters or digits
+        int batch_window_us = 0;              // Coalesce operations of one kind for this long (0 = send at once)
+        int batch_limit = 20;                 // Operations per batch frame, 1 to 20
+        int max_open_orders = 1024;           // Orders the local state table tracks at once
+    };
+
+    /**
+     * @brief Runtime control socket (optional section "Admin"), read at startup
+     */
+    struct AdminConfig {
+        std::string socket_path = "/tmp/websocket_client.{pid}.sock";  // Unix-domain admin socket, {pid} = process id (empty = off)
+    };
+
+    /**
+     * @brief Configuration for the matrix calculation thread (optional section)
+     */
+    struct CalculationConfig {
+        int matrix_size = 1000;               // Matrix dimension (n x n)
+        std::string engine = "gauss_jordan";  // Inversion engine: gauss_jordan, in_place, recursive, newton_schulz, out_of_core, distributed
+        int tile_size = 256;                  // out_of_core tile edge
+        int tile_cache_tiles = 0;             // out_of_core resident tiles (0 = minimum)
+        std::string scratch_dir = "/tmp";     // out_of_core backing file directory
+        double matrix_density = 1.0;          // Fraction of off-diagonal entries generated nonzero
+        double sparse_threshold = 0.01;       // Density at or below which ingest switches to CSR and sparse LU (0 = never); not gauss_jordan/out_of_core
+        bool autotune = false;                // Benchmark kernels at startup if no tuning cache exists
+        bool perf_counters = false;           // Report hardware counters per inversion (perf_event_open)
+        int workers = 0;                      // Throughput mode worker count (0 = single calculation thread)
+        int preempt_columns = 0;              // Feed preemption on (> 0): Gauss-Jordan column steps between points
+        int service_workers = 0;              // Job service worker count (0 = job service off)
+        int job_deadline_ms = 1000;           // Deadline of each job submitted to the job service
+        int result_cache_mb = 0;              // Job service result cache budget in MiB (0 = off); exact repeats only
+        int worker_processes = 0;             // calculation_worker process count (0 = in-process)
+        std::string worker_binary = "./calculation_worker";  // Worker executable
+        std::vector<int> worker_cpus;         // CPUs the worker processes are pinned to (empty = any); memory is not node-bound
+        std::vector<std::string> distributed_nodes;  // distributed: "host:port" per rank, rank 0 is this process
+        int distributed_loopback = 0;         // distributed: in-process stand-in nodes when no nodes are listed
+        std::string kernel_isa = "auto";      // Kernel instruction set cap: auto, baseline, avx2, avx512
+    };
+
+    /**
+     * @brief Every section compiled from one configuration file; immutable
+     */
+    struct Snapshot {
+        ConnectorConfig connectors;
+        FeedConfig feed;
+        ThreadingConfig threading;
+        SocketConfig socket;
+        CalculationConfig calculation;
+        LoggingConfig logging;
+        AdminConfig admin;
+        WarmupConfig warmup;
+        OrdersConfig orders;
+    };
+
+    /**
+     * @brief Startup options from the command line
+     *
+     * mode and configDir default to WSCLIENT_MODE and WSCLIENT_CONFIG_DIR
+     * when those are set.
+     */
+    struct CommandLine {
+        std::string mode = "demo";
+        std::string configDir = "config/";
+        std::vector<std::string> overrides;                  // "Section.field=value", applied after the environment
+        std::vector<std::pair<std::string, int>> secretFds;  // OKXDataSrc credential field, descriptor holding it
+        bool help = false;
+    };
+
 private:
     nlohmann::json m_config;
     std::string m_mode;
     std::string m_configPath;
+    RcuPointer<Snapshot> m_snapshot;
+    mutable std::mutex m_reloadMutex;  // Serializes loads; guards m_config and m_listeners
+    std::vector<std::function<void(const Snapshot&)>> m_listeners;
+    std::vector<std::string> m_overrides;                     // Command line layer
+    std::map<std::string, std::string> m_secrets;             // Credential field -> value, never in m_config
 
 public:
     /**
@@ -49,37 +215,99 @@ public:
     explicit ConfigManager(const std::string& mode = "demo", 
                           const std::string& configPath = "config/");
 
+    /**
+     * @brief Parse --mode, --config-dir, --set, --secret-fd and --help
+     * @throws std::invalid_argument on an unknown or malformed option
+     */
+    static CommandLine parseCommandLine(int argc, char* argv[]);
+    static const char* usage();
+
+    /**
+     * @brief true if WSCLIENT__* settings or credential descriptors (OKX_*_FD)
+     *        are in the environment; check before loadConfig(), which consumes the latter
+     */
+    static bool hasEnvironmentLayer();
+
+    /**
+     * @brief Set the command line layer applied on every load and reload
+     * @param overrides "Section.field=value" assignments
+     * @throws std::invalid_argument if one is malformed or names a credential
+     */
+    void setOverrides(const std::vector<std::string>& overrides);
+
+    /**
+     * @brief Read an OKXDataSrc credential (API_key, API_secret, API_passphrase)
+     *        from fd until EOF, then close fd; takes precedence over the environment
+     * @throws std::invalid_argument for an unknown field, std::runtime_error if fd is unreadable
+     */
+    void readSecretFromFd(const std::string& field, int fd);
+
     /**
      * @brief Load configuration from JSON file
      * @throws std::runtime_error if file cannot be loaded or parsed
      */
     void loadConfig();
 
+    /**
+     * @brief Re-read, re-validate and publish the configuration file
+     *
+     * Only Feed, Logging and Calculation.matrix_size reach the running
+     * components; a change to any other field is published but warned about
+     * as needing a restart (Socket: a reconnect).
+     * @return false if the file is unreadable or invalid; the current snapshot stays
+     */
+    bool reload();
+
+    /**
+     * @brief Call listener with each snapshot published by reload(), on the reloading thread
+     */
+    void addReloadListener(std::function<void(const Snapshot&)> listener);
+
+    /**
+     * @brief The swappable snapshot pointer, for live components to hold a Reader on
+     */
+    RcuPointer<Snapshot>& getLiveSnapshot() { return m_snapshot; }
+
     /**
      * @brief Get the current configuration mode
      * @return Current mode ("demo" or "prod")
      */
     const std::string& getMode() const { return m_mode; }
 
+    /**
+     * @brief Get the current compiled configuration
+     * @return Snapshot valid until the next reload(); threads that run across
+     *         reloads read through getLiveSnapshot() instead
+     * @throws std::runtime_error if configuration is not loaded
+     */
+    const Snapshot& getSnapshot() const;
+
     /**
      * @brief Get OKX configuration
      * @return OKXConfig structure with all OKX settings
-     * @throws std::runtime_error if configuration is not loaded or malformed
+     * @throws std::runtime_error if configuration is not loaded
      */
-    OKXConfig getOKXConfig() const;
+    const OKXConfig& getOKXConfig() const { return getSnapshot().connectors.OKXDataSrc; }
 
     /**
      * @brief Get all connector configurations
      * @return ConnectorConfig structure with all connector settings
-     * @throws std::runtime_error if configuration is not loaded or malformed
+     * @throws std::runtime_error if configuration is not loaded
+     */
+    const ConnectorConfig& getConnectorConfig() const { return getSnapshot().connectors; }
+
+    /**
+     * @brief Get calculation configuration
+     * @return CalculationConfig with defaults for any missing fields
+     * @throws std::runtime_error if configuration is not loaded
      */
-    ConnectorConfig getConnectorConfig() const;
+    const CalculationConfig& getCalculationConfig() const { return getSnapshot().calculation; }
 
     /**
      * @brief Check if configuration is loaded
      * @return true if configuration is loaded, false otherwise
      */
-    bool isLoaded() const { return !m_config.empty(); }
+    bool isLoaded() const { return m_snapshot.load() != nullptr; }
 
     /**
      * @brief Validate configuration structure
@@ -89,23 +317,71 @@ public:
 
     /**
      * @brief Get raw JSON configuration (for debugging)
-     * @return Reference to the loaded JSON configuration
+     * @return Copy of the loaded JSON configuration, taken under the reload lock
      */
-    const nlohmann::json& getRawConfig() const { return m_config; }
+    nlohmann::json getRawConfig() const;
 
-private:
     /**
      * @brief Construct configuration file path
      * @return Full path to configuration file
      */
     std::string getConfigFilePath() const;
 
+private:
+    /**
+     * @brief Read and parse the configuration file
+     * @throws std::runtime_error if file cannot be loaded or parsed
+     */
+    nlohmann::json readConfigFile() const;
+
+    /**
+     * @brief Apply the environment and command line layers to the file's JSON
+     * @throws std::runtime_error if a layer assigns below a non-object value
+     */
+    nlohmann::json resolveLayers(nlohmann::json config) const;
+
+    /**
+     * @brief Warn about changed fields that the running process does not pick up
+     */
+    void warnUnappliedChanges(const nlohmann::json& before, const nlohmann::json& after) const;
+
+    /**
+     * @brief Take credentials not read from a descriptor from the environment,
+     *        then remove them from it so child processes do not inherit them
+     */
+    void loadSecrets();
+
     /**
      * @brief Validate OKX configuration section
      * @param okxSection JSON object containing OKX configuration
      * @return true if valid, false otherwise
      */
     bool validateOKXConfig(const nlohmann::json& okxSection) const;
+
+    /**
+     * @brief Compile validated JSON into a snapshot
+     * @throws std::runtime_error if a field has the wrong type
+     */
+    static std::unique_ptr<const Snapshot> compile(const nlohmann::json& config,
+                                                   const std::map<std::string, std::string>& secrets);
+    static OKXConfig compileOKXConfig(const nlohmann::json& okxSection,
+                                      const std::map<std::string, std::string>& secrets);
+    static FeedConfig compileFeedConfig(const nlohmann::json& feedSection);
+    static CalculationConfig compileCalculationConfig(const nlohmann::json& calcSection);
+
+    /**
+     * @brief Validate the optional Feed, Threading, Socket, Logging, Admin, Warmup and Orders sections
+     * @param config Whole configuration
+     * @return true if valid, false otherwise
+     */
+    bool validateRuntimeConfig(const nlohmann::json& config) const;
+
+    /**
+     * @brief Validate Calculation configuration section
+     * @param calcSection JSON object containing calculation configuration
+     * @return true if valid, false otherwise
+     */
+    bool validateCalculationConfig(const nlohmann::json& calcSection) const;
 };
 
 #endif // CONFIG_MANAGER_H 
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+class ConfigManager;
+
+/**
+ * @brief Reloads a ConfigManager when its file changes on disk
+ *
+ * Watches the configuration directory with inotify, so both in-place
+ * writes and the write-then-rename most editors do are seen. Bursts of
+ * events are coalesced for settleTime before ConfigManager::reload() runs
+ * on the watcher thread; a file that fails validation is reported and
+ * ignored. The thread also reclaims retired snapshots periodically.
+ */
+class ConfigWatcher {
+public:
+    ConfigWatcher(ConfigManager& config,
+                  std::chrono::milliseconds settleTime = std::chrono::milliseconds(200));
+    ~ConfigWatcher();
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    /**
+     * @brief Start watching
+     * @throws std::runtime_error if inotify is unavailable
+     */
+    void start();
+    void stop();
+
+    int reloads() const { return m_reloads.load(); }
+    int rejected() const { return m_rejected.load(); }
+
+private:
+    ConfigManager& m_config;
+    std::chrono::milliseconds m_settleTime;
+    int m_inotify = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<int> m_reloads{0};
+    std::atomic<int> m_rejected{0};
+
+    void watchLoop(std::string fileName);
+};
+
+#endif // CONFIG_WATCHER_H
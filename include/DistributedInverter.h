@@ -0,0 +1,103 @@
+#ifndef DISTRIBUTED_INVERTER_H
+#define DISTRIBUTED_INVERTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Transport;
+
+/**
+ * @brief Block Gauss-Jordan inversion spread over the nodes of a Transport
+ *
+ * The (identity-padded) matrix is cut into tileSize x tileSize tiles that
+ * are dealt out 2D block-cyclically over a pr x pc grid of nodes: tile
+ * (i, j) lives on node (i mod pr) * pc + (j mod pc). Step k of the sweep
+ * (the same one TiledMatrixFile::invert runs) then needs only
+ *   - tile column k from the diagonal down, to the diagonal owner, which
+ *     picks pivot rows from all of it as partial pivoting would,
+ *   - the row swaps and the inverted pivoted diagonal tile D, from its
+ *     owner to every node; swapped rows move between the owners of each
+ *     tile column,
+ *   - the old tiles of column k, along their node row, and
+ *   - the updated tiles of row k, along their node column,
+ * after which every node updates its own tiles independently. The
+ * coordinator undoes the row swaps as column swaps on the gathered
+ * result.
+ *
+ * Rank 0 is the coordinator: it holds the matrix, scatters the tiles,
+ * takes part in the sweep and gathers the result. The other ranks run
+ * serve() until the coordinator calls shutdown(). Each node times its
+ * kernels and its transport calls separately; the coordinator collects
+ * these per node after every inversion.
+ */
+class DistributedInverter {
+public:
+    struct NodeStats {
+        double computeSeconds = 0.;
+        double commSeconds = 0.;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        int tiles = 0;
+    };
+
+    /**
+     * @param tileSize Tile edge; only the coordinator's value is used
+     */
+    DistributedInverter(Transport& transport, int tileSize);
+
+    /**
+     * @brief Longest message, in doubles, an inversion with this tile size sends
+     *
+     * The row swaps of a step are the largest: up to 2 tileSize rows
+     * between two owners of a tile column.
+     */
+    static size_t maxMessage(int tileSize) { return 2 * (size_t)tileSize * tileSize + 2 * (size_t)tileSize + 2; }
+
+    /**
+     * @brief Coordinator: invert the n x n row-major matrix A in place
+     * @return 0 on success, -1 if the matrix is singular
+     */
+    int invert(double* A, int n);
+
+    /**
+     * @brief Non-coordinator ranks: take part in inversions until shutdown()
+     */
+    void serve();
+
+    /**
+     * @brief Coordinator: release the serving ranks
+     */
+    void shutdown();
+
+    /**
+     * @brief Coordinator: per-node statistics of the last invert(), by rank
+     */
+    const std::vector<NodeStats>& nodeStats() const { return m_nodeStats; }
+    void printReport() const;
+
+    int gridRows() const { return m_gridRows; }
+    int gridCols() const { return m_gridCols; }
+
+private:
+    Transport& m_transport;
+    int m_tileSize;
+    int m_gridRows;
+    int m_gridCols;
+    int m_tiles;                // Tiles per matrix side of the current job
+    std::unordered_map<int, std::vector<double>> m_owned;  // i * m_tiles + j -> tile
+    std::vector<std::pair<int, int>> m_swaps;               // Row interchanges of the sweep, in order
+    NodeStats m_stats;
+    std::vector<NodeStats> m_nodeStats;
+
+    int owner(int i, int j) const;
+    bool participate(int n, int tileSize, const double* A, double* result);
+    int sweep();
+    void swapRows(int k, const std::vector<std::pair<int, int>>& swaps);
+    void sendTimed(int dest, uint64_t tag, const double* data, size_t count);
+    void receiveTimed(int source, uint64_t tag, double* data, size_t count);
+};
+
+#endif // DISTRIBUTED_INVERTER_H
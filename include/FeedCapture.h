@@ -0,0 +1,50 @@
+#ifndef FEED_CAPTURE_H
+#define FEED_CAPTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Append-only recording of raw feed messages for replay
+ *
+ * Each message is written as one "<receive time in ns since epoch> <payload>"
+ * line through a large stdio buffer, so recording costs a memcpy on the feed
+ * thread and a write() every few hundred messages. A roll is requested from
+ * any thread and carried out by the feed thread before its next record: the
+ * current file is moved to a name with a UTC timestamp suffix (plus ".N" if
+ * that name is taken; an earlier roll is never overwritten) and a new one
+ * started. If the move fails the current file is kept and appended to.
+ */
+class FeedCapture {
+public:
+    /**
+     * @throws std::runtime_error if path cannot be opened for appending
+     */
+    explicit FeedCapture(const std::string& path);
+    ~FeedCapture();
+    FeedCapture(const FeedCapture&) = delete;
+    FeedCapture& operator=(const FeedCapture&) = delete;
+
+    // Feed thread only
+    void record(int64_t receivedNs, const std::string& payload);
+
+    void requestRoll() { m_rollRequested.store(true, std::memory_order_release); }
+
+    const std::string& path() const { return m_path; }
+    uint64_t records() const { return m_records.load(std::memory_order_relaxed); }
+    uint64_t rolls() const { return m_rolls.load(std::memory_order_relaxed); }
+
+private:
+    std::string m_path;
+    FILE* m_file = nullptr;
+    std::atomic<bool> m_rollRequested{false};
+    std::atomic<uint64_t> m_records{0};
+    std::atomic<uint64_t> m_rolls{0};
+
+    void open();
+    void roll();
+};
+
+#endif // FEED_CAPTURE_H
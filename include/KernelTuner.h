@@ -0,0 +1,62 @@
+#ifndef KERNEL_TUNER_H
+#define KERNEL_TUNER_H
+
+#include <string>
+#include "MatrixKernels.h"
+
+/**
+ * @brief Benchmarks MatrixKernels parameters on the current CPU
+ *
+ * Candidate GEMM block sizes and unroll factors, GEMM task counts, the
+ * recursive inversion base size and the Strassen crossover are timed on
+ * small random problems and the fastest of each is kept. Results are
+ * stored in a per-host JSON file next to the environment configs
+ * (config/tuning-<hostname>.json) and reused on later starts as long as the
+ * CPU model and core count still match.
+ */
+class KernelTuner {
+public:
+    /**
+     * @param sampleSize Matrix dimension used for the GEMM and inversion runs
+     */
+    explicit KernelTuner(int sampleSize = 384);
+
+    /**
+     * @brief Run all benchmarks
+     * @return The fastest parameters found
+     */
+    MatrixKernels::Tuning tune() const;
+
+    /**
+     * @brief Path of the tuning cache for this host
+     * @param configDir Directory holding demo.json/prod.json
+     */
+    static std::string cachePath(const std::string& configDir);
+
+    /**
+     * @brief Load a tuning cache
+     * @return false if missing, unreadable, recorded on a different CPU or
+     *         holding a value out of range (loadOrTune() then retunes)
+     */
+    static bool loadCache(const std::string& path, MatrixKernels::Tuning& tuning);
+
+    /**
+     * @brief Write a tuning cache for this host
+     * @throws std::runtime_error if the file cannot be written
+     */
+    static void saveCache(const std::string& path, const MatrixKernels::Tuning& tuning);
+
+    /**
+     * @brief Cached parameters if present, otherwise tune (and persist) when allowed
+     * @param allowTuning If false and there is no cache, the defaults are returned
+     */
+    static MatrixKernels::Tuning loadOrTune(const std::string& configDir, bool allowTuning);
+
+private:
+    int m_sampleSize;
+
+    static std::string hostName();
+    static std::string cpuModel();
+};
+
+#endif // KERNEL_TUNER_H
@@ -0,0 +1,43 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Log2-bucketed latency histogram with one writer and any number of readers
+ *
+ * Bucket b counts values in [2^(b-1), 2^b), bucket 0 counts zeros. record()
+ * is a handful of relaxed loads and stores with no read-modify-write, so
+ * it is cheap on the hot path but must only be called from one thread;
+ * readers see a slightly stale but consistent-enough view.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 48;
+
+    void record(uint64_t value);
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /**
+     * @brief Upper bound of the bucket holding quantile q in [0, 1]
+     */
+    uint64_t percentile(double q) const;
+
+    /**
+     * @brief "count N mean M p50 A p90 B p99 C p99.9 D max E <unit>"
+     */
+    std::string summary(const char* unit) const;
+
+private:
+    std::atomic<uint64_t> m_buckets[kBuckets] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+#endif // LATENCY_HISTOGRAM_H
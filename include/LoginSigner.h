@@ -0,0 +1,47 @@
+#ifndef LOGIN_SIGNER_H
+#define LOGIN_SIGNER_H
+
+#include <cstddef>
+#include <string>
+
+typedef struct evp_mac_ctx_st EVP_MAC_CTX;
+
+/**
+ * @brief Signs OKX WebSocket login requests with HMAC-SHA256
+ *
+ * The signature is Base64(HMAC-SHA256(secret, timestamp + "GET" +
+ * "/users/self/verify")) with the timestamp in Unix seconds. The HMAC
+ * context is fetched and keyed once, in the constructor; each sign()
+ * re-initializes it with the stored key and builds the message to sign
+ * in a stack buffer, so signing allocates nothing and costs a few
+ * microseconds. One signer per key; not thread-safe.
+ */
+class LoginSigner {
+public:
+    static const size_t kSignatureSize = 45;  // 44 Base64 characters and the terminator
+
+    /**
+     * @throws std::runtime_error if OpenSSL has no HMAC-SHA256 or the secret is empty
+     */
+    explicit LoginSigner(const std::string& secret);
+    ~LoginSigner();
+    LoginSigner(const LoginSigner&) = delete;
+    LoginSigner& operator=(const LoginSigner&) = delete;
+
+    /**
+     * @brief Write the NUL-terminated signature for timestamp into signature
+     * @return false if OpenSSL fails; signature is then empty
+     */
+    bool sign(long long timestamp, char (&signature)[kSignatureSize]);
+
+    /**
+     * @brief The complete {"op":"login",...} frame, signed for the current time
+     * @throws std::runtime_error if signing fails
+     */
+    std::string loginFrame(const std::string& apiKey, const std::string& passphrase);
+
+private:
+    EVP_MAC_CTX* m_ctx = nullptr;
+};
+
+#endif // LOGIN_SIGNER_H
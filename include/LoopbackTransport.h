@@ -0,0 +1,33 @@
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include <memory>
+#include <vector>
+#include "Transport.h"
+
+/**
+ * @brief In-process Transport: every rank is a thread of this process
+ *
+ * Stands in for TcpTransport when testing distributed code on one box;
+ * a send is a copy straight into the destination's inbox.
+ */
+class LoopbackTransport : public Transport {
+public:
+    /**
+     * @brief Connected endpoints for ranks 0..size-1
+     *
+     * The endpoints refer to each other, so all of them must stay alive
+     * until the last one is done.
+     */
+    static std::vector<std::unique_ptr<LoopbackTransport>> createGroup(int size);
+
+protected:
+    void transmit(int dest, uint64_t tag, const double* data, size_t count) override;
+
+private:
+    LoopbackTransport(int rank, int size, std::shared_ptr<std::vector<LoopbackTransport*>> group);
+
+    std::shared_ptr<std::vector<LoopbackTransport*>> m_group;
+};
+
+#endif // LOOPBACK_TRANSPORT_H
@@ -0,0 +1,212 @@
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include <string>
+#include <vector>
+
+class PreemptionGate;
+
+/**
+ * @brief Dense row-major matrix kernels shared by the calculation engines
+ *
+ * All matrices are addressed as (pointer, leading dimension) so that the
+ * kernels can operate on sub-blocks of a larger matrix without copying.
+ *
+ * The innermost loops (the GEMM tile and the row update) are compiled once
+ * per instruction set into the same binary and picked through a dispatch
+ * table chosen from cpuid at startup, so a baseline x86-64 build still runs
+ * AVX2 or AVX-512 code on hosts that have it.
+ */
+class MatrixKernels {
+public:
+    /**
+     * @brief Instruction set of a kernel variant, in increasing order
+     */
+    enum class Isa { Baseline, AVX2, AVX512 };
+
+    /**
+     * @brief Best variant this CPU and OS support
+     */
+    static Isa detectIsa();
+
+    static Isa isa() { return s_isa; }
+
+    /**
+     * @brief Select the kernel variants, clamped to detectIsa()
+     *
+     * Set once at startup, before any calculation thread runs.
+     * @return The variant actually selected
+     */
+    static Isa setIsa(Isa isa);
+
+    static Isa isaFromString(const std::string& name);
+    static const char* isaName(Isa isa);
+
+    /**
+     * @brief Machine-dependent kernel parameters (see KernelTuner)
+     *
+     * Set once at startup, before any calculation thread runs.
+     */
+    struct Tuning {
+        int gemmBlock = 64;           // multiply() tile edge
+        int gemmUnroll = 1;           // multiply() k-loop unroll: 1, 2 or 4
+        int gemmThreads = 0;          // multiplyParallel() tasks (0 = all cores)
+        int recursiveBase = 64;       // invertRecursive() base-case size
+        int strassenCrossover = 512;  // multiplyStrassen() hand-off size
+    };
+
+    static const Tuning& tuning() { return s_tuning; }
+    static void setTuning(const Tuning& tuning);
+
+    /**
+     * @brief Cap the tasks that kernels called from this thread fan out to
+     *
+     * For callers that already run several calculations side by side, such
+     * as the CalculationPool workers. 0, the default, leaves the count to
+     * Tuning and the parallelDepth arguments.
+     */
+    static void setThreadBudget(int threads);
+    static int threadBudget() { return s_threadBudget; }
+
+    /**
+     * @brief Outcome of a Newton-Schulz run
+     */
+    struct NewtonSchulzStats {
+        int iterations = 0;        // GEMM pairs executed
+        double residual = 0.;      // Final ||I - A * X||_F
+        bool warmStarted = false;  // true if the supplied guess was usable
+    };
+
+    /**
+     * @brief Blocked GEMM: C = alpha * A * B + beta * C
+     * @param m Rows of A and C
+     * @param k Columns of A, rows of B
+     * @param n Columns of B and C
+     */
+    static void multiply(int m, int k, int n, double alpha,
+                         const double* A, int lda,
+                         const double* B, int ldb,
+                         double beta, double* C, int ldc);
+
+    /**
+     * @brief multiply() with the rows of C split across worker tasks
+     * @param threads Number of tasks; 0 uses Tuning::gemmThreads
+     */
+    static void multiplyParallel(int threads, int m, int k, int n, double alpha,
+                                 const double* A, int lda,
+                                 const double* B, int ldb,
+                                 double beta, double* C, int ldc);
+
+    /**
+     * @brief Strassen multiply of square n x n matrices: C = A * B
+     *
+     * Recurses on 2x2 quadrants with the seven-product scheme until the
+     * half size reaches crossover, then hands off to multiply(). Odd sizes
+     * are handled by peeling the last row/column. The seven products at
+     * the first parallelDepth levels run as parallel tasks. A crossover of
+     * 0 uses Tuning::strassenCrossover.
+     */
+    static void multiplyStrassen(int n, const double* A, int lda,
+                                 const double* B, int ldb,
+                                 double* C, int ldc,
+                                 int crossover = 0,
+                                 int parallelDepth = 1);
+
+    /**
+     * @brief Square C = A * B using Strassen from kStrassenThreshold upwards
+     *
+     * Below the threshold this is multiplyParallel(). Above it the Strassen
+     * result is spot-checked against exact dot products on a few sampled
+     * entries; if the relative error exceeds kStrassenGuard the product is
+     * recomputed with the blocked GEMM.
+     *
+     * @return true if the Strassen result was kept
+     */
+    static bool multiplyFast(int n, const double* A, int lda,
+                             const double* B, int ldb,
+                             double* C, int ldc);
+
+    /**
+     * @brief Row update y += alpha * x over n contiguous elements
+     */
+    static void axpy(int n, double alpha, const double* x, double* y);
+
+    /**
+     * @brief Row interchanges partial pivoting makes on a rows x cols panel (rows >= cols)
+     *
+     * The panel is eliminated on a copy and left unchanged. Step k swaps
+     * row pivots[k] into row k, in order, as LAPACK's getf2 records them.
+     * @return 0 on success, -1 if the panel's columns are linearly dependent
+     */
+    static int panelPivots(const double* A, int lda, int rows, int cols, std::vector<int>& pivots);
+
+    /**
+     * @brief Gauss-Jordan inversion with partial pivoting of an n x n block
+     * @return 0 on success, -1 if the block is singular
+     */
+    static int invertBase(double* A, int lda, int n);
+
+    /**
+     * @brief Solve A X = B by Gaussian elimination with partial pivoting
+     * @param A n x n matrix, destroyed
+     * @param B n x nrhs right-hand sides, replaced by X
+     * @return 0 on success, -1 if A is singular
+     */
+    static int solve(double* A, int n, double* B, int nrhs);
+
+    /**
+     * @brief Recursive 2x2 block inversion via the Schur complement
+     *
+     * Splits the matrix in halves until it reaches baseSize (0 uses
+     * Tuning::recursiveBase), where
+     * invertBase() takes over. The recursion gives cache blocking at every
+     * level without a tuned tile size. Independent sub-products are run as
+     * parallel tasks for the first parallelDepth levels.
+     *
+     * Each level first reorders its rows as partial pivoting on the
+     * leading half of the columns would, so the leading block and the
+     * Schur complement are as well conditioned as in pivoted Gauss-Jordan
+     * even when the original leading block is singular; the column
+     * interchanges are undone on the inverse.
+     *
+     * @param gate If set, yielded to once per block above the base size
+     * @return 0 on success, -1 if the matrix is singular
+     */
+    static int invertRecursive(double* A, int lda, int n,
+                               int baseSize = 0, int parallelDepth = 2,
+                               PreemptionGate* gate = nullptr);
+
+    /**
+     * @brief Newton-Schulz iteration X <- X (2I - A X) for a dense n x n matrix
+     *
+     * Each step costs two GEMMs and converges quadratically once
+     * ||I - A X|| < 1. With warmStart set, X is taken as the initial guess
+     * (e.g. the inverse of the previous, slightly different matrix) and is
+     * replaced by the scaled transpose A^T / (||A||_1 ||A||_inf) only if it
+     * is not close enough to converge.
+     *
+     * @param A Input matrix (not modified)
+     * @param X Initial guess if warmStart, receives the inverse
+     * @param tolerance Stop once ||I - A X||_F falls to this value
+     * @param gate If set, yielded to before every step
+     * @return 0 on convergence, -1 if maxIterations was reached first, -2 if
+     *         the residual stopped decreasing above tolerance (X holds the
+     *         last iterate either way)
+     */
+    static int invertNewtonSchulz(const double* A, int n, double* X, bool warmStart,
+                                  double tolerance = 1.e-9, int maxIterations = 100,
+                                  NewtonSchulzStats* stats = nullptr,
+                                  PreemptionGate* gate = nullptr);
+
+    /// Smallest n for which multiplyFast() switches to Strassen
+    static constexpr int kStrassenThreshold = 2048;
+    /// Largest accepted relative error of a sampled Strassen entry
+    static constexpr double kStrassenGuard = 1.e-10;
+
+private:
+    static Tuning s_tuning;
+    static Isa s_isa;
+    static thread_local int s_threadBudget;
+};
+
+#endif // MATRIX_KERNELS_H
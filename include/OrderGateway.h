@@ -0,0 +1,191 @@
+#ifndef ORDER_GATEWAY_H
+#define ORDER_GATEWAY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "ConfigManager.h"
+#include "LatencyHistogram.h"
+
+class PrivateChannel;
+
+/**
+ * @brief Order entry on the OKX private WebSocket
+ *
+ * The argument objects of the order, amend-order and cancel-order
+ * requests are serialized once, in the constructor, for the configured
+ * instrument and order type. Every field that changes per request --
+ * side, price, size and client order id -- has a fixed-width slot: the
+ * quoted value is written at the slot's offset and the rest of the slot
+ * is JSON whitespace. An operation copies its template into a reserved
+ * buffer and patches the slots, so no JSON is built and nothing is
+ * allocated before the frame reaches the channel.
+ *
+ * Operations of one kind are coalesced: with Orders.batch_window_us set,
+ * they wait up to that long after the first one, or until batch_limit
+ * (at most 20, the OKX limit) are queued, and go out as one
+ * batch-orders, batch-amend-orders or batch-cancel-orders frame. An
+ * operation of another kind sends what is queued first, so the exchange
+ * sees operations in call order. A lone operation goes out as a plain
+ * request. With no window each operation is sent at once. The window is
+ * timed by run(), on its own thread.
+ *
+ * Client order ids are Orders.client_id_prefix followed by a number; the
+ * gateway hands out the numbers, starting from the wall clock in
+ * microseconds so a restart does not reuse them. Replies are split back
+ * into one Ack per operation, matched by clOrdId or, failing that, by
+ * position in the request. They arrive on the channel thread through
+ * onMessage(); operations in a frame the channel could not send are
+ * reported as rejected on the thread that tried to send it. Every
+ * queued operation -- each one the submit handler saw -- gets one Ack.
+ */
+class OrderGateway {
+public:
+    enum class Side { Buy, Sell };
+    enum class Op { Place, Amend, Cancel };
+
+    /**
+     * @brief An operation as it is queued, before any of it is sent
+     */
+    struct Submit {
+        Op op;
+        uint64_t clientId;
+        Side side;     // Place only
+        double price;  // Place and Amend
+        double size;
+    };
+
+    /**
+     * @brief Outcome of one operation, from the exchange's reply
+     */
+    struct Ack {
+        Op op = Op::Place;
+        uint64_t requestId = 0;  // 0 if the frame was never sent
+        uint64_t clientId = 0;   // 0 if the reply names no client order id of ours
+        int batchSize = 1;       // Operations in the frame this one went out in
+        bool accepted = false;   // sCode (or code, for a reply without data) is "0"
+        std::string code;
+        std::string message;
+        std::string orderId;     // Exchange order id, when accepted
+    };
+
+    static constexpr int kMaxBatch = 20;    // OKX limit per batch request
+    static constexpr int kInFlight = 1024;  // Requests whose send time is kept for ack latency
+
+    /**
+     * @throws std::invalid_argument if the prefix is not alphanumeric or too long
+     */
+    OrderGateway(PrivateChannel& channel, const ConfigManager::OrdersConfig& config);
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    /**
+     * @brief Send or queue a new order
+     * @param tick Steady receive time of the market data that led to this
+     *        order (WebSocketClass::lastUpdateReceived() or the book handler's
+     *        argument); tick to send is recorded in tickToOrder(). A
+     *        default-constructed tick records nothing
+     * @return The new client id, or 0 if the channel is not logged in, the
+     *         price or size cannot be written, or an immediate send failed
+     *         (then reported to the ack handler as well)
+     */
+    uint64_t placeOrder(Side side, double price, double size, std::chrono::steady_clock::time_point tick);
+    bool amendOrder(uint64_t clientId, double price, double size, std::chrono::steady_clock::time_point tick);
+    bool cancelOrder(uint64_t clientId, std::chrono::steady_clock::time_point tick);
+
+    /**
+     * @brief Send queued operations now
+     */
+    void flush();
+
+    /**
+     * @brief Send each batch when its window closes, until flag is set; then flush
+     */
+    void run(std::atomic<bool>& flag);
+
+    /**
+     * @brief Channel thread: handle a private channel message; ignores non-order replies
+     * @return true if it was an order reply
+     */
+    bool onMessage(const std::string& payload);
+
+    // Before the channel runs: called for every acknowledged or unsent operation. Unsent
+    // ones are reported under the gateway's lock, like submits: must not call back into it
+    void setAckHandler(std::function<void(const Ack&)> handler) { m_onAck = std::move(handler); }
+    // Before the first operation: called under the gateway's lock as each operation is
+    // queued, so it is seen before its Ack can arrive. Must not call back into the gateway
+    void setSubmitHandler(std::function<void(const Submit&)> handler) { m_onSubmit = std::move(handler); }
+
+    const LatencyHistogram& tickToOrder() const { return m_tickToOrder; }  // ns, per operation
+    const LatencyHistogram& ackLatency() const { return m_ackLatency; }    // us, send to reply
+    const LatencyHistogram& batchSizes() const { return m_batchSizes; }    // Operations per frame
+    uint64_t sent() const { return m_sent.load(); }                        // Operations
+    uint64_t frames() const { return m_frames.load(); }
+    uint64_t accepted() const { return m_accepted.load(); }
+    uint64_t rejected() const { return m_rejected.load(); }
+
+    static const char* opName(Op op, bool batch = false);
+
+private:
+    struct Slot {
+        size_t offset = 0;
+        size_t width = 0;
+    };
+
+    struct Template {
+        std::string args;  // One argument object, serialized once; slots hold spaces
+        Slot side, price, size, clientId;
+    };
+
+    // Operations of one kind waiting to go out in the same frame
+    struct Batch {
+        Op op = Op::Place;
+        int count = 0;
+        std::chrono::steady_clock::time_point opened;
+        std::string args;  // Patched argument objects, comma separated
+        uint64_t clientIds[kMaxBatch];
+        std::chrono::steady_clock::time_point ticks[kMaxBatch];
+    };
+
+    // Filled before sentNs is released by the sender, read after the channel thread acquires it
+    struct InFlight {
+        std::atomic<long long> sentNs{0};  // steady_clock, 0 = free
+        Op op = Op::Place;
+        int count = 0;
+        uint64_t clientIds[kMaxBatch];
+    };
+
+    PrivateChannel& m_channel;
+    ConfigManager::OrdersConfig m_config;
+    Template m_templates[3];               // By Op
+    std::mutex m_mutex;                    // Guards m_batch to m_nextClientId, m_tickToOrder and m_batchSizes
+    std::condition_variable m_wake;        // A batch was opened
+    Batch m_batch;
+    std::string m_frame;                   // Frame being assembled
+    uint64_t m_nextRequestId = 1;
+    uint64_t m_nextClientId;
+    InFlight m_inFlight[kInFlight];
+    std::function<void(const Ack&)> m_onAck;
+    std::function<void(const Submit&)> m_onSubmit;
+    LatencyHistogram m_tickToOrder;
+    LatencyHistogram m_batchSizes;
+    LatencyHistogram m_ackLatency;         // Channel thread
+    std::atomic<uint64_t> m_sent{0};
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_rejected{0};
+
+    Template buildTemplate(Op op) const;
+    bool submit(Op op, uint64_t clientId, Side side, double price, double size,
+                std::chrono::steady_clock::time_point tick);
+    bool sendBatchLocked();
+    void deliver(const Ack& ack);
+    char* writeClientId(char* out, uint64_t clientId) const;
+    uint64_t parseClientId(const std::string& text) const;
+};
+
+#endif // ORDER_GATEWAY_H
@@ -0,0 +1,124 @@
+#ifndef ORDER_STATE_ENGINE_H
+#define ORDER_STATE_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "OrderGateway.h"
+
+/**
+ * @brief Local view of our open orders, from gateway submits, acks and the private "orders" channel
+ *
+ * Orders live in an open-addressing table (linear probing, backward-shift
+ * deletion) keyed by client order id number, allocated once for
+ * Orders.max_open_orders: inserting, finding and removing an order is
+ * O(1) and allocates nothing. An order is inserted when its placement is
+ * queued and removed once it is filled, canceled or rejected.
+ *
+ *   PendingNew --ack--> Live <--push--> PartiallyFilled --push--> Filled
+ *   Live / PartiallyFilled --amend--> PendingAmend --ack--> previous state
+ *   Live / PartiallyFilled --cancel--> PendingCancel --push--> Canceled
+ *   PendingNew --rejected ack--> Rejected
+ *
+ * Each order remembers which of its requests are awaiting a reply. An
+ * ack for a request that is not outstanding is stale; an ack or channel
+ * update for a client id that is not in the table is unknown; a channel
+ * update older (uTime) than the last one applied is stale. All three are
+ * counted and otherwise ignored. Every call is safe from any thread.
+ *
+ * Replies to requests sent on a connection that has since dropped never
+ * arrive, so onLogin() reconciles the table on each login: such requests
+ * are expired, an amend or cancel returns the order to its resting state
+ * (the orders channel reports anything the exchange did change), and a
+ * placement that was never acknowledged is dropped as expired.
+ */
+class OrderStateEngine {
+public:
+    enum class State { PendingNew, Live, PartiallyFilled, PendingAmend, PendingCancel, Filled, Canceled, Rejected };
+
+    struct Order {
+        uint64_t clientId = 0;       // 0 = empty slot
+        uint64_t orderId = 0;        // Exchange order id, once known
+        State state = State::PendingNew;
+        State resting = State::Live; // Live or PartiallyFilled, restored when an amend or cancel fails
+        OrderGateway::Side side = OrderGateway::Side::Buy;
+        uint8_t awaiting = 0;        // Bit per OrderGateway::Op with a request in flight
+        double price = 0;
+        double size = 0;
+        double filled = 0;
+        long long updateMs = 0;      // uTime of the last channel update applied
+        std::chrono::steady_clock::time_point requested; // Latest request submitted
+    };
+
+    struct Counters {
+        uint64_t inserted = 0;
+        uint64_t filled = 0;
+        uint64_t canceled = 0;
+        uint64_t rejected = 0;
+        uint64_t unknownAcks = 0;
+        uint64_t staleAcks = 0;
+        uint64_t unknownUpdates = 0;
+        uint64_t staleUpdates = 0;
+        uint64_t tableFull = 0;       // Placements not tracked because the table was full
+        uint64_t duplicates = 0;      // Placements not tracked because their client id already was
+        uint64_t expiredRequests = 0; // Requests whose reply was lost with their connection
+        uint64_t expired = 0;         // Unacknowledged placements dropped by those expiries
+    };
+
+    /**
+     * @param maxOpen Orders tracked at once; the table holds twice that, rounded up to a power of two
+     * @param clientIdPrefix Orders.client_id_prefix, to recognise our orders on the channel
+     */
+    OrderStateEngine(size_t maxOpen, const std::string& clientIdPrefix);
+
+    // Wire to OrderGateway::setSubmitHandler and setAckHandler
+    void onSubmit(const OrderGateway::Submit& submit);
+    void onAck(const OrderGateway::Ack& ack);
+
+    /**
+     * @brief Expire the requests submitted before loginSent, whose connection is gone
+     *
+     * Call from the channel's login handler with PrivateChannel::loginSent():
+     * anything submitted after it went out on the new connection.
+     */
+    void onLogin(std::chrono::steady_clock::time_point loginSent);
+
+    /**
+     * @brief Apply an "orders" channel push; ignores other messages
+     * @return true if it was an orders push
+     */
+    bool onMessage(const std::string& payload);
+
+    /**
+     * @brief Subscribe frame for the orders channel, to send after each login
+     */
+    static const char* subscribeFrame();
+
+    bool find(uint64_t clientId, Order& order) const;
+    size_t openOrders() const;
+    std::vector<Order> orders() const;  // Copies, for introspection
+    Counters counters() const;
+
+    static const char* stateName(State state);
+
+private:
+    std::vector<Order> m_slots;          // Allocated once
+    size_t m_mask;
+    int m_shift;                         // Fibonacci hashing: top bits of the product
+    size_t m_maxOpen;
+    size_t m_size = 0;
+    std::string m_prefix;
+    Counters m_counters;
+    mutable std::mutex m_mutex;          // Guards everything above
+
+    size_t home(uint64_t clientId) const;
+    Order* findLocked(uint64_t clientId);
+    Order* insertLocked(uint64_t clientId);
+    void eraseLocked(Order* order);
+    void finishLocked(Order* order, State state);
+};
+
+#endif // ORDER_STATE_ENGINE_H
@@ -0,0 +1,60 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Hardware performance counters of the calling thread (perf_event_open)
+ *
+ * Counts cycles, instructions, last-level cache misses and dTLB misses in
+ * user space. Threads spawned by the kernels after construction are
+ * inherited and their counts are added once they exit. Events the CPU or
+ * the kernel's perf_event_paranoid setting refuse are skipped, so the
+ * class is always safe to use; available() tells whether anything counts.
+ *
+ * Bracket a kernel with start()/stop(); counts are scaled for multiplexing.
+ */
+class PerfCounters {
+public:
+    enum Event { Cycles, Instructions, LlcMisses, DtlbMisses, EventCount };
+
+    struct Sample {
+        double counts[EventCount] = {};
+        bool valid[EventCount] = {};
+        double seconds = 0.;
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const;
+
+    void start();
+    Sample stop();
+
+    /**
+     * @brief One-line summary: counts plus IPC, GFLOP/s and the memory
+     *        bandwidth implied by LLC misses (64-byte lines)
+     * @param flops Floating-point operations the bracketed kernel performed
+     */
+    static std::string report(const Sample& sample, double flops);
+
+private:
+    struct Reading {
+        uint64_t value = 0;
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+    };
+
+    int m_fd[EventCount];
+    Reading m_start[EventCount];
+    std::chrono::steady_clock::time_point m_startTime;
+
+    bool read(int event, Reading& reading) const;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,83 @@
+#ifndef PREEMPTION_GATE_H
+#define PREEMPTION_GATE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Lets latency-sensitive work preempt long calculations cooperatively
+ *
+ * Feed work is pending from the moment data is readable on the feed
+ * socket until its message has been handled. runWatcher() polls the socket
+ * registered with watch() and holds the gate while unread bytes wait for
+ * the feed thread; the feed thread brackets every message it handles with
+ * enter()/leave() (or a Scope), which covers TLS decoding and parsing.
+ * Long kernels call yieldIfPending() at their preemption points -- every
+ * few column steps in Gauss-Jordan, per block or iteration in the other
+ * engines; while feed work is pending the calculation thread sleeps
+ * instead of competing for the core, and resumes from its saved loop state
+ * once the feed is done.
+ *
+ * enter()/leave() are a single atomic increment/decrement plus a notify, so
+ * the feed side never takes a lock.
+ */
+class PreemptionGate {
+public:
+    /**
+     * @brief RAII helper for enter()/leave(); a null gate is a no-op
+     */
+    class Scope {
+    public:
+        explicit Scope(PreemptionGate* gate) : m_gate(gate) { if (m_gate) m_gate->enter(); }
+        ~Scope() { if (m_gate) m_gate->leave(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        PreemptionGate* m_gate;
+    };
+
+    void enter();
+    void leave();
+    bool pending() const { return m_pending.load(std::memory_order_acquire) > 0; }
+
+    /**
+     * @brief Socket whose readable data counts as pending feed work; -1 for none
+     */
+    void watch(int fd) { m_watchFd.store(fd, std::memory_order_release); }
+
+    /**
+     * @brief Poll the watched socket until flag is set, holding the gate while it is readable
+     *
+     * A hold ends once the feed thread has read the data, or after
+     * kMaxHoldMicros so a stalled feed cannot park the calculation for good;
+     * data left unread past that is not held again.
+     */
+    void runWatcher(std::atomic<bool>& flag);
+
+    static constexpr int kMaxHoldMicros = 2000;
+
+    /**
+     * @brief Block the calling (calculation) thread while feed work is pending
+     * @return true if the caller actually yielded
+     */
+    bool yieldIfPending();
+
+    uint64_t yields() const { return m_yields.load(std::memory_order_relaxed); }
+    uint64_t yieldedMicros() const { return m_yieldedMicros.load(std::memory_order_relaxed); }
+    uint64_t readableSignals() const { return m_readable.load(std::memory_order_relaxed); }  // Holds by runWatcher()
+
+private:
+    std::atomic<int> m_pending{0};
+    std::atomic<uint64_t> m_yields{0};
+    std::atomic<uint64_t> m_yieldedMicros{0};
+    std::atomic<uint64_t> m_readable{0};
+    std::atomic<int> m_watchFd{-1};
+    std::mutex m_mutex;
+    std::condition_variable m_clear;
+
+    bool stillReadable(struct pollfd& readable) const;
+};
+
+#endif // PREEMPTION_GATE_H
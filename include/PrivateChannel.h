@@ -0,0 +1,97 @@
+#ifndef PRIVATE_CHANNEL_H
+#define PRIVATE_CHANNEL_H
+
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ConfigManager.h"
+#include "LoginSigner.h"
+
+/**
+ * @brief Authenticated connection to the OKX private WebSocket
+ *
+ * run() connects to OKXConfig::url_private and logs in on every open,
+ * signing with a LoginSigner that was keyed once in the constructor, so a
+ * reconnect costs a handshake and a few microseconds of signing. A closed
+ * or failed connection is retried with a doubling back-off (up to
+ * kMaxBackoffMs) until the stop flag is set, and an idle connection is
+ * kept open with the "ping" OKX expects within 30 s. Messages other than
+ * login results and pongs go to the message handler on the channel
+ * thread. The server certificate is verified against the system trust
+ * store and the host of url_private (sent as SNI); a connection that
+ * fails verification is never logged in to.
+ */
+class PrivateChannel {
+public:
+    using tls_client = websocketpp::client<websocketpp::config::asio_tls_client>;
+    using MessageHandler = std::function<void(const std::string& payload)>;
+
+    static constexpr int kMaxBackoffMs = 30000;
+    static constexpr int kPingIntervalMs = 25000;
+
+    /**
+     * @throws std::runtime_error if the API key or secret is missing or HMAC is unavailable
+     */
+    PrivateChannel(const ConfigManager::OKXConfig& config, const ConfigManager::SocketConfig& socket);
+    PrivateChannel(const PrivateChannel&) = delete;
+    PrivateChannel& operator=(const PrivateChannel&) = delete;
+
+    // Before run(): every message that is not a login result or a pong
+    void setMessageHandler(MessageHandler handler) { m_onMessage = std::move(handler); }
+    // Before run(): called on the channel thread after each successful login
+    void setLoginHandler(std::function<void()> handler) { m_onLogin = std::move(handler); }
+
+    /**
+     * @brief Connect, log in and reconnect until flag is set
+     */
+    void run(std::atomic<bool>& flag);
+
+    /**
+     * @brief Send a text frame on the logged-in connection; safe from any thread
+     * @return false if not logged in or the send failed
+     */
+    bool send(const std::string& frame);
+
+    bool loggedIn() const { return m_loggedIn.load(); }
+    int logins() const { return m_logins.load(); }
+    int reconnects() const { return m_reconnects.load(); }
+    long long lastSignNs() const { return m_signNs.load(); }    // Building and signing the last login frame
+    long long lastLoginUs() const { return m_loginUs.load(); }  // Login frame sent to login acknowledged
+    // Channel thread (the login handler): when the current connection's login frame went out
+    std::chrono::steady_clock::time_point loginSent() const { return m_loginSent; }
+
+private:
+    ConfigManager::OKXConfig m_config;
+    ConfigManager::SocketConfig m_socket;
+    LoginSigner m_signer;
+    std::string m_host;                               // From url_private: SNI and certificate name
+    tls_client m_client;
+    std::shared_ptr<boost::asio::ssl::context> m_tlsContext;
+    websocketpp::connection_hdl m_hdl;                // Latest connection; guarded by m_hdlMutex
+    mutable std::mutex m_hdlMutex;
+    MessageHandler m_onMessage;
+    std::function<void()> m_onLogin;
+    bool m_stopping = false;
+    int m_backoffMs = 0;
+    std::chrono::steady_clock::time_point m_loginSent;
+    std::atomic<bool> m_loggedIn{false};
+    std::atomic<int> m_logins{0};
+    std::atomic<int> m_reconnects{0};
+    std::atomic<long long> m_signNs{-1};
+    std::atomic<long long> m_loginUs{-1};
+
+    websocketpp::connection_hdl handle() const;
+    void connect();
+    void scheduleReconnect();
+    void schedulePing();
+    void on_open(websocketpp::connection_hdl hdl);
+    void on_message(const std::string& payload);
+};
+
+#endif // PRIVATE_CHANNEL_H
@@ -0,0 +1,118 @@
+#ifndef RCU_POINTER_H
+#define RCU_POINTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Pointer to an immutable object, replaced by atomic swap and freed late
+ *
+ * Readers never lock or wait: load() is one acquire load. publish() swaps
+ * in a new object and retires the old one, which is deleted only after
+ * every registered Reader has passed a quiescent point (quiescent-state-
+ * based reclamation). A Reader calls quiescent() where it holds no
+ * pointer obtained earlier -- typically at the top of each event it
+ * handles -- and then re-reads get(). A reader that stays idle only
+ * delays reclamation; it never blocks the writer or other readers.
+ *
+ * Code that reads without a Reader may only do so while no publish() can
+ * run (e.g. during startup).
+ */
+template <class T>
+class RcuPointer {
+public:
+    class Reader {
+    public:
+        explicit Reader(RcuPointer& owner) : m_owner(owner)
+        {
+            std::lock_guard<std::mutex> lock(owner.m_mutex);
+            owner.m_readers.emplace_back(owner.m_epoch.load());
+            m_slot = std::prev(owner.m_readers.end());
+        }
+        ~Reader()
+        {
+            std::lock_guard<std::mutex> lock(m_owner.m_mutex);
+            m_owner.m_readers.erase(m_slot);
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * @brief Announce that no pointer from an earlier get() is still in use
+         */
+        void quiescent() { m_slot->store(m_owner.m_epoch.load()); }
+        const T* get() const { return m_owner.load(); }
+
+    private:
+        RcuPointer& m_owner;
+        typename std::list<std::atomic<uint64_t>>::iterator m_slot;
+    };
+
+    explicit RcuPointer(std::unique_ptr<const T> initial = nullptr) : m_current(initial.release()) {}
+    ~RcuPointer()
+    {
+        delete m_current.load();
+        for (auto& retired : m_retired)
+            delete retired.second;
+    }
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    const T* load() const { return m_current.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Make next current; the previous object is reclaimed later
+     */
+    void publish(std::unique_ptr<const T> next)
+    {
+        const T* previous = m_current.exchange(next.release());
+        const uint64_t epoch = ++m_epoch;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (previous)
+            m_retired.emplace_back(epoch, previous);
+        reclaimLocked();
+    }
+
+    /**
+     * @brief Delete retired objects every reader has moved past
+     * @return Objects still waiting
+     */
+    size_t reclaim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        reclaimLocked();
+        return m_retired.size();
+    }
+
+private:
+    std::atomic<const T*> m_current;
+    std::atomic<uint64_t> m_epoch{1};
+    std::mutex m_mutex;                                   // Guards the lists below
+    std::list<std::atomic<uint64_t>> m_readers;           // Last epoch each reader was quiescent in
+    std::vector<std::pair<uint64_t, const T*>> m_retired; // Epoch of retirement, object
+
+    void reclaimLocked()
+    {
+        uint64_t oldest = m_epoch.load();
+        for (const auto& seen : m_readers)
+            oldest = std::min(oldest, seen.load());
+        auto keep = m_retired.begin();
+        for (auto& retired : m_retired)
+        {
+            if (retired.first <= oldest)
+                delete retired.second;
+            else
+                *keep++ = retired;
+        }
+        m_retired.erase(keep, m_retired.end());
+    }
+};
+
+#endif // RCU_POINTER_H
@@ -0,0 +1,104 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "CalculationService.h"
+
+/**
+ * @brief Content-addressed cache of calculation results
+ *
+ * Requests are keyed by a 128-bit hash of their type, dimensions,
+ * parameters and matrix bytes, so a repeated input costs one pass over its
+ * bytes instead of an O(n^3) kernel. The hash runs four independent 64-bit
+ * lanes over 32-byte stripes (the xxHash64 round), which keeps several
+ * multiplies in flight per cycle and vectorises where the target has
+ * 64-bit vector multiplies.
+ *
+ * Only byte-identical requests hit: there is no tolerance and no reuse of
+ * a near match. The cache pays off where the same input really recurs --
+ * a solve retried against an unchanged system, a covariance update
+ * replayed after a reconnect -- and never on the service's own random
+ * workload. Stats count hits and misses so the hit rate, and the time
+ * spent hashing against the time saved, can be checked per deployment.
+ *
+ * Entries are evicted least-recently-used first once the stored results
+ * exceed the byte budget. All methods are thread-safe.
+ */
+class ResultCache {
+public:
+    struct Key {
+        uint64_t lo;
+        uint64_t hi;
+        bool operator==(const Key& other) const { return lo == other.lo && hi == other.hi; }
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t bytesSaved = 0;       // Result bytes served without recomputation
+        uint64_t microsSaved = 0;      // Execution time those results originally took
+        uint64_t hashMicros = 0;       // Time spent computing keys, hit or miss
+        size_t bytesUsed = 0;
+        size_t entries = 0;
+    };
+
+    explicit ResultCache(size_t capacityBytes);
+
+    /**
+     * @brief 64-bit lanes hash of a byte range, chained through seed
+     */
+    static Key hash(const void* data, size_t bytes, Key seed = {0, 0});
+
+    /**
+     * @brief Key of a service request (type, dimensions, decay, a, b)
+     */
+    static Key keyOf(const CalculationService::Request& request);
+
+    /**
+     * @brief Copy the cached result for key into value
+     * @return false on a miss
+     */
+    bool lookup(const Key& key, CalculationService::Matrix& value);
+
+    /**
+     * @brief Store a result that took execMicros to compute
+     */
+    void insert(const Key& key, const CalculationService::Matrix& value, uint64_t execMicros);
+
+    /**
+     * @brief Add the time taken to compute one key to the stats
+     */
+    void recordHashTime(uint64_t micros);
+
+    /**
+     * @brief hits / (hits + misses), 0 before the first lookup
+     */
+    static double hitRate(const Stats& stats);
+
+    Stats stats() const;
+    size_t capacity() const { return m_capacity; }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return (size_t)key.lo; }
+    };
+
+    struct Entry {
+        Key key;
+        CalculationService::Matrix value;
+        uint64_t execMicros;
+    };
+
+    size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;    // Front is most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    Stats m_stats;
+};
+
+#endif // RESULT_CACHE_H
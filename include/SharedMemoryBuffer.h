@@ -0,0 +1,44 @@
+#ifndef SHARED_MEMORY_BUFFER_H
+#define SHARED_MEMORY_BUFFER_H
+
+#include <cstddef>
+
+/**
+ * @brief Anonymous shared memory (memfd) mapped into this process
+ *
+ * The file descriptor is the handle: send it to another process over a
+ * Unix-domain socket (SCM_RIGHTS) and map it there, and both processes
+ * see the same pages without copying. The memory disappears once the
+ * last descriptor and mapping are gone.
+ */
+class SharedMemoryBuffer {
+public:
+    /**
+     * @brief Create and map a new zero-filled buffer
+     * @throws std::runtime_error if it cannot be created or mapped
+     */
+    explicit SharedMemoryBuffer(size_t bytes);
+
+    /**
+     * @brief Map a received handle; the buffer takes ownership of fd
+     * @throws std::runtime_error if it cannot be mapped
+     */
+    SharedMemoryBuffer(int fd, size_t bytes);
+
+    ~SharedMemoryBuffer();
+    SharedMemoryBuffer(const SharedMemoryBuffer&) = delete;
+    SharedMemoryBuffer& operator=(const SharedMemoryBuffer&) = delete;
+
+    int fd() const { return m_fd; }
+    size_t size() const { return m_bytes; }
+    double* data() const { return static_cast<double*>(m_data); }
+
+private:
+    int m_fd;
+    size_t m_bytes;
+    void* m_data;
+
+    void map();
+};
+
+#endif // SHARED_MEMORY_BUFFER_H
@@ -0,0 +1,55 @@
+#ifndef SPARSE_LU_H
+#define SPARSE_LU_H
+
+#include <cstddef>
+#include <vector>
+
+class SparseMatrix;
+class PreemptionGate;
+
+/**
+ * @brief Left-looking sparse LU with partial pivoting: L U = P A Q
+ *
+ * Columns are taken in the order Q (normally a fill-reducing ordering
+ * from SparseMatrix::minimumDegreeOrdering). Column k of L and U comes
+ * from one sparse triangular solve against the columns already factored,
+ * whose nonzero pattern is found by a depth-first search first (Gilbert-
+ * Peierls), so work is proportional to the flops actually done and
+ * storage to the nonzeros of L and U. The pivot is the largest candidate
+ * unless the diagonal of the ordering is within pivotTolerance of it,
+ * which keeps the symmetric ordering intact on well-conditioned rows.
+ */
+class SparseLU {
+public:
+    /// Columns factored between preemption points when factor() is given a gate
+    static constexpr int kYieldColumns = 64;
+
+    /**
+     * @return 0 on success, -1 if the matrix is singular
+     */
+    int factor(const SparseMatrix& A, const std::vector<int>& columnOrder, double pivotTolerance = 0.1,
+               PreemptionGate* gate = nullptr);
+
+    /**
+     * @brief Solve A x = b with the factors; b and x may alias
+     */
+    void solve(const double* b, double* x) const;
+
+    int size() const { return m_n; }
+    size_t nonzerosL() const { return m_lValues.size(); }
+    size_t nonzerosU() const { return m_uValues.size(); }
+    double flops() const { return m_flops; }
+
+private:
+    int m_n = 0;
+    std::vector<int> m_pinv;        // Row -> pivot step
+    std::vector<int> m_q;           // Pivot step -> column
+    std::vector<int> m_lPtr, m_lIdx;  // Unit lower, diagonal first in each column
+    std::vector<double> m_lValues;
+    std::vector<int> m_uPtr, m_uIdx;  // Upper, diagonal last in each column
+    std::vector<double> m_uValues;
+    double m_flops = 0.;
+    mutable std::vector<double> m_work;
+};
+
+#endif // SPARSE_LU_H
@@ -0,0 +1,61 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Square matrix in compressed sparse row (CSR) form
+ *
+ * Rows are appended in order, each with strictly increasing column
+ * indices, so storage is built in one pass at ingest and costs
+ * O(n + nonzeros). Factorization lives in SparseLU.
+ */
+class SparseMatrix {
+public:
+    explicit SparseMatrix(int n);
+
+    int size() const { return m_n; }
+    int rows() const { return (int)m_rowPtr.size() - 1; }
+    size_t nonzeros() const { return m_values.size(); }
+    double density() const { return m_n ? double(nonzeros()) / (double(m_n) * m_n) : 0.; }
+
+    /**
+     * @brief Append the next row from its nonzeros, columns ascending
+     */
+    void appendRow(const int* cols, const double* values, int count);
+
+    const std::vector<int>& rowPtr() const { return m_rowPtr; }
+    const std::vector<int>& colIdx() const { return m_colIdx; }
+    const std::vector<double>& values() const { return m_values; }
+
+    /**
+     * @brief y = A x
+     */
+    void multiply(const double* x, double* y) const;
+
+    /**
+     * @brief Write the rows appended so far into the row-major n x n array out
+     */
+    void toDense(double* out) const;
+
+    /**
+     * @brief Fill-reducing elimination order of the pattern of A + A^T
+     *
+     * Greedy minimum degree on the elimination graph: repeatedly eliminate
+     * the node with the fewest neighbours and join its neighbours into a
+     * clique (ties by index, so the order is deterministic). When even the
+     * sparsest remaining node neighbours half of the rest, the remainder is
+     * treated as one dense block and appended by degree.
+     * @return order[k] = row/column eliminated at step k
+     */
+    std::vector<int> minimumDegreeOrdering() const;
+
+private:
+    int m_n;
+    std::vector<int> m_rowPtr;    // rows() + 1 offsets into m_colIdx/m_values
+    std::vector<int> m_colIdx;
+    std::vector<double> m_values;
+};
+
+#endif // SPARSE_MATRIX_H
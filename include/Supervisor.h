@@ -0,0 +1,106 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Starts, runs and stops the process's components in dependency order
+ *
+ * Each component registers hooks and the names of the components it
+ * depends on. start() calls the start hooks on the calling thread,
+ * dependencies first and otherwise in registration order; when it
+ * returns, every component is ready. run() then gives each component with
+ * a run hook its own thread, pinned to its CPU if one is set, and all of
+ * them share one stop flag. When the run time is over or requestStop() is
+ * called, stop() sets that flag and, in reverse start order, joins each
+ * component's thread and calls its stop hook, so nothing is stopped while
+ * a component that depends on it is still running.
+ *
+ * A required component whose start hook throws aborts start(): what was
+ * already started is stopped again and the error is rethrown. An optional
+ * one is reported and skipped, and so are its dependents. A run hook that
+ * throws marks its component failed and stops the process.
+ */
+class Supervisor {
+public:
+    struct Component {
+        std::string name;
+        std::vector<std::string> dependsOn;                // Started before and stopped after this one
+        std::function<void()> start;                       // Calling thread; throws std::exception to fail
+        std::function<void(std::atomic<bool>& stop)> run;  // Own thread until stop is set (empty = no thread)
+        std::function<void()> stop;                        // After the run thread is joined
+        std::function<std::string()> health;               // One line of status for health()
+        int cpu = -1;                                      // CPU the run thread is pinned to (-1 = any)
+        bool optional = false;                             // A failed start is skipped, not fatal
+    };
+
+    enum class State { Registered, Running, Skipped, Failed, Stopped };
+
+    Supervisor() = default;
+    ~Supervisor();
+    Supervisor(const Supervisor&) = delete;
+    Supervisor& operator=(const Supervisor&) = delete;
+
+    /**
+     * @brief Register a component; only before start()
+     * @throws std::invalid_argument if the name is empty or taken
+     */
+    void add(Component component);
+
+    /**
+     * @brief Start every component, dependencies first
+     * @throws std::invalid_argument on an unknown or cyclic dependency,
+     *         std::runtime_error if a required component fails to start
+     */
+    void start();
+
+    /**
+     * @brief Run the component threads for duration or until requestStop(), then stop()
+     */
+    void run(std::chrono::seconds duration);
+
+    /**
+     * @brief Make run() return early; safe from any thread, including run hooks
+     */
+    void requestStop();
+
+    /**
+     * @brief Stop in reverse start order; idempotent
+     */
+    void stop();
+
+    /**
+     * @brief One line per component: name, state and its health hook's text
+     */
+    std::string health() const;
+
+    static const char* stateName(State state);
+
+private:
+    struct Entry {
+        Component component;
+        std::atomic<State> state{State::Registered};
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Entry>> m_entries;  // Registration order
+    std::vector<Entry*> m_started;                  // Start order
+    std::atomic<bool> m_stopFlag{false};
+    std::mutex m_waitMutex;
+    std::condition_variable m_wake;
+    bool m_stopRequested = false;
+
+    std::vector<Entry*> startOrder() const;
+    Entry* find(const std::string& name) const;
+    void runEntry(Entry& entry);
+};
+
+#endif // SUPERVISOR_H
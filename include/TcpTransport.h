@@ -0,0 +1,52 @@
+#ifndef TCP_TRANSPORT_H
+#define TCP_TRANSPORT_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Transport.h"
+
+/**
+ * @brief Transport over a full mesh of TCP connections, one per pair of ranks
+ *
+ * Rank r listens on the port of endpoints[r], connects to every lower rank
+ * and accepts every higher one, so all nodes can be started in any order
+ * within the timeout. A reader thread per connection moves arriving
+ * messages into the inbox, so send() only waits for the socket buffer.
+ * If a connection drops, or a peer sends a frame longer than maxCount,
+ * receive() from that peer throws.
+ *
+ * For trusted networks only: traffic is neither encrypted nor
+ * authenticated, and a peer is recognised by a magic number alone. Each
+ * rank listens only on the host given for it in endpoints, so list an
+ * address on the private network the nodes share rather than 0.0.0.0.
+ */
+class TcpTransport : public Transport {
+public:
+    /**
+     * @param endpoints "host:port" of every rank, indexed by rank; this rank listens on its own
+     * @param maxCount Longest message accepted, in doubles (see DistributedInverter::maxMessage)
+     * @throws std::runtime_error if the mesh is not up within timeout
+     */
+    TcpTransport(int rank, const std::vector<std::string>& endpoints, size_t maxCount,
+                 std::chrono::seconds timeout = std::chrono::seconds(30));
+    ~TcpTransport() override;
+
+protected:
+    void transmit(int dest, uint64_t tag, const double* data, size_t count) override;
+
+private:
+    std::vector<int> m_sockets;                          // Indexed by peer rank, -1 for self
+    std::vector<std::unique_ptr<std::mutex>> m_sendMutex;
+    std::vector<std::thread> m_readers;
+    size_t m_maxCount;
+    std::atomic<bool> m_closing{false};
+
+    void readLoop(int peer);
+};
+
+#endif // TCP_TRANSPORT_H
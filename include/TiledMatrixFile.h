@@ -0,0 +1,141 @@
+#ifndef TILED_MATRIX_FILE_H
+#define TILED_MATRIX_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class PreemptionGate;
+
+/**
+ * @brief Square matrix stored tile-major in a memory-mapped scratch file
+ *
+ * The matrix is padded up to a whole number of tileSize x tileSize tiles
+ * (the padding is the identity, so inverting the padded matrix inverts the
+ * original one). Each tile is contiguous in the file. Kernels never touch
+ * the mapping directly: they pin tiles through a bounded LRU cache of
+ * in-memory copies, and dirty tiles are written back to the mapping on
+ * eviction. prefetch() hints the kernel to start reading a tile ahead of
+ * use (MADV_WILLNEED), so panel streaming overlaps compute with I/O.
+ *
+ * The scratch file is unlinked as soon as it is created, so it disappears
+ * with the process even on abnormal exit.
+ */
+class TiledMatrixFile {
+public:
+    /**
+     * @brief Tile cache and I/O counters
+     */
+    struct Stats {
+        uint64_t hits = 0;        // acquire() served from the cache
+        uint64_t loads = 0;       // Tiles copied in from the mapping
+        uint64_t writebacks = 0;  // Dirty tiles copied back on eviction/flush
+        uint64_t prefetches = 0;  // MADV_WILLNEED hints issued
+        uint64_t pivots = 0;      // Row interchanges made by invert()
+    };
+
+    /**
+     * @brief Create the scratch file and map it
+     * @param n Matrix dimension
+     * @param tileSize Tile edge in elements
+     * @param cacheTiles Resident tile budget; raised to the minimum the
+     *        inversion needs (one tile row plus three) if smaller
+     * @param scratchDir Directory for the backing file
+     * @throws std::runtime_error if the file cannot be created or mapped
+     */
+    TiledMatrixFile(int n, int tileSize, int cacheTiles, const std::string& scratchDir);
+    ~TiledMatrixFile();
+    TiledMatrixFile(const TiledMatrixFile&) = delete;
+    TiledMatrixFile& operator=(const TiledMatrixFile&) = delete;
+
+    int size() const { return m_n; }
+    int tileSize() const { return m_tileSize; }
+    int tileCount() const { return m_tiles; }
+    int cacheCapacity() const { return m_capacity; }
+    const Stats& stats() const { return m_stats; }
+
+    /**
+     * @brief Write row i (n values) of the logical matrix
+     */
+    void setRow(int i, const double* values);
+
+    /**
+     * @brief Pin tile (ti, tj) in the cache and return its buffer
+     * @param dirty Mark the tile for write-back
+     * @throws std::runtime_error if every resident tile is pinned
+     */
+    double* acquire(int ti, int tj, bool dirty);
+
+    /**
+     * @brief Unpin a tile obtained from acquire()
+     */
+    void release(int ti, int tj);
+
+    /**
+     * @brief Ask the kernel to start reading a tile in the background
+     */
+    void prefetch(int ti, int tj);
+
+    /**
+     * @brief Write all dirty resident tiles back to the mapping
+     */
+    void flush();
+
+    /**
+     * @brief Drop every cached tile without write-back and zero the stats
+     *
+     * Used before the matrix is overwritten through setRow().
+     */
+    void discardCache();
+
+    /**
+     * @brief Out-of-core block Gauss-Jordan inversion in place
+     *
+     * Every step reads its tile column from the diagonal down (one tile
+     * row's worth of memory) and swaps the rows partial pivoting would pick
+     * into the diagonal tile row, so the sweep is as stable as pivoted
+     * Gauss-Jordan; the interchanges are undone as column swaps on the
+     * inverse. That costs one extra read of the tile column per step, and
+     * the row swaps touch each tile column once when any are needed.
+     * @param gate If set, yielded to between tile rows of the sweep
+     * @return 0 on success, -1 if the matrix is singular
+     */
+    int invert(PreemptionGate* gate = nullptr);
+
+    /**
+     * @brief out = rows * M for count dense rows of length n, in one pass
+     */
+    void multiplyRowsLeft(int count, const double* rows, double* out);
+
+private:
+    struct Entry {
+        std::vector<double> data;
+        int pins = 0;
+        bool dirty = false;
+        std::list<int>::iterator lru;
+    };
+
+    int m_n;
+    int m_tileSize;
+    int m_tiles;
+    int m_capacity;
+    size_t m_tileElems;
+    size_t m_bytes;
+    int m_fd;
+    double* m_map;
+    std::unordered_map<int, Entry> m_cache;
+    std::list<int> m_lru;   // Front is most recently used
+    Stats m_stats;
+
+    double* mapped(int ti, int tj) const;
+    int panelPivots(int k, std::vector<std::pair<int, int>>& swaps);
+    void swapRows(const std::pair<int, int>* swaps, size_t count);
+    void unswapColumns(const std::pair<int, int>* swaps, size_t count);
+    void evictOne();
+};
+
+#endif // TILED_MATRIX_FILE_H
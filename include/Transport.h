@@ -0,0 +1,74 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Point-to-point message passing between the nodes of a distributed calculation
+ *
+ * Every node has a rank in [0, size). Messages are arrays of doubles
+ * addressed by (source rank, tag); receive() blocks until the matching
+ * message arrives, and messages with the same source and tag are received
+ * in the order they were sent. send() never waits for the receiver:
+ * incoming messages are buffered in this node's inbox until received.
+ *
+ * Implementations only have to move bytes (transmit) and hand arrivals to
+ * deliver(); matching and buffering live here. See LoopbackTransport and
+ * TcpTransport.
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+    Transport(const Transport&) = delete;
+    Transport& operator=(const Transport&) = delete;
+
+    int rank() const { return m_rank; }
+    int size() const { return m_size; }
+
+    void send(int dest, uint64_t tag, const double* data, size_t count);
+
+    /**
+     * @brief Wait for the message (source, tag) and copy it into data
+     * @throws std::runtime_error if its length is not count or the link from source failed
+     */
+    void receive(int source, uint64_t tag, double* data, size_t count);
+
+    uint64_t bytesSent() const { return m_bytesSent.load(std::memory_order_relaxed); }
+    uint64_t bytesReceived() const { return m_bytesReceived.load(std::memory_order_relaxed); }
+
+protected:
+    Transport(int rank, int size);
+
+    virtual void transmit(int dest, uint64_t tag, const double* data, size_t count) = 0;
+
+    /**
+     * @brief Queue an arrived message for receive(); callable from any thread
+     */
+    void deliver(int source, uint64_t tag, std::vector<double>&& payload);
+
+    /**
+     * @brief Make pending and future receive() calls from source throw once its queued messages run out
+     */
+    void fail(int source, const std::string& reason);
+
+private:
+    int m_rank;
+    int m_size;
+    std::mutex m_mutex;
+    std::condition_variable m_arrived;
+    std::map<std::pair<int, uint64_t>, std::deque<std::vector<double>>> m_inbox;
+    std::map<int, std::string> m_errors;  // Failed links by source rank
+    std::atomic<uint64_t> m_bytesSent{0};
+    std::atomic<uint64_t> m_bytesReceived{0};
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,45 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include <string>
+#include "CalculationClass.h"
+
+/**
+ * @brief Startup steps that move first-use costs ahead of the first update
+ *
+ * Without them the first minutes of data pay for resolver lookups, page
+ * faults on freshly allocated workspaces and cold instruction caches.
+ * Each step prints what it did and how long it took; a failing step is
+ * reported and skipped, never fatal.
+ */
+class Warmup {
+public:
+    /**
+     * @brief Resolve the host of a ws:// or wss:// URI once
+     *
+     * Brings the answer into the resolver caches (nscd, systemd-resolved)
+     * and surfaces DNS trouble before the connection attempt.
+     */
+    static bool resolveHost(const std::string& uri);
+
+    /**
+     * @brief mlockall(MCL_CURRENT)
+     *
+     * Faults in and pins everything mapped so far -- workspaces, heap,
+     * stacks. Later mappings (resized workspaces, task stacks) are left
+     * pageable so they cannot fail against RLIMIT_MEMLOCK; file-backed
+     * out_of_core storage must not be mapped, which the configuration
+     * enforces. Needs CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK.
+     */
+    static bool lockMemory();
+
+    /**
+     * @brief Invert small matrices with the engine run() will use
+     *
+     * Loads and warms the kernels, the allocator and the tuned code paths
+     * without any gate, live size or distributed coordinator attached.
+     */
+    static void kernelPasses(int size, CalculationClass::Engine engine, CalculationClass::Options options, int passes);
+};
+
+#endif // WARMUP_H
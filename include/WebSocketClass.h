@@ -11,7 +11,15 @@
 #include <ctime>
 
 #include <atomic>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
+
+#include "PreemptionGate.h"
+#include "ConfigManager.h"
+#include "FeedCapture.h"
+#include "LatencyHistogram.h"
 
 using client = websocketpp::client<websocketpp::config::asio_tls_client>;
 using context_ptr = std::shared_ptr<boost::asio::ssl::context>;
@@ -21,18 +29,95 @@ using message_ptr = websocketpp::config::asio_client::message_type::ptr;
 
 class WebSocketClass
 {
+public:
+    /**
+     * @brief Last book update seen for one instrument
+     */
+    struct BookView
+    {
+        size_t bidLevels = 0;
+        size_t askLevels = 0;
+        std::string bestBid;       // Price as sent by the exchange, empty if no level
+        std::string bestAsk;
+        long long exchangeTs = 0;  // Exchange timestamp of the update, ms since epoch
+        uint64_t updates = 0;
+    };
+
 private:
     client m_client;
     std::string m_uri;
+    PreemptionGate *m_gate = nullptr;
+    const ConfigManager::Snapshot *m_config;
+    std::unique_ptr<RcuPointer<ConfigManager::Snapshot>::Reader> m_configReader;
+    websocketpp::connection_hdl m_hdl;
+    bool m_open = false;
+    std::vector<ConfigManager::Subscription> m_subscribed;  // What the exchange has been asked for
+    std::map<std::string, BookView, std::less<>> m_books;    // By instId; feed thread only
+    std::map<std::string, BookView> m_publishedBooks;        // Copy of m_books for other threads
+    std::chrono::steady_clock::time_point m_booksPublished;  // When m_publishedBooks was last refreshed
+    mutable std::mutex m_stateMutex;                         // Guards m_subscribed and m_publishedBooks
+    LatencyHistogram m_handleLatency;                        // Message handling time, ns
+    LatencyHistogram m_exchangeLatency;                      // Exchange timestamp to receipt, us
+    std::unique_ptr<FeedCapture> m_capture;
+    context_ptr m_tlsContext;                                 // Built once, by prewarm() or the first handshake
+    std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
+    std::atomic<long long> m_firstUpdateUs{-1};               // Start to first book update
+    std::atomic<std::chrono::steady_clock::rep> m_lastUpdateTicks{0}; // Steady receive time of the last book update
+    std::atomic<long long> m_steadyStateUs{-1};               // Start to end of the first stable window
+    long long m_windowNs = 0;                                 // Handling time summed over the current window
+    int m_windowCount = 0;
+    long long m_previousWindowNs = 0;
 
     static std::string getCurrentUTCTimestamp();
-    static void on_message(const std::string &response_data);
-    static context_ptr on_tls_init();
-    static void on_open(client *m_client, websocketpp::connection_hdl hdl);
+    static void decodeBook(const nlohmann::json &update, BookView &book);
+    void trackSteadyState(long long handleNs);
+    void on_message(const std::string &response_data, std::chrono::system_clock::time_point received,
+                    std::chrono::steady_clock::time_point receivedSteady);
+    void updateBook(const nlohmann::json &message, std::chrono::system_clock::time_point received,
+                    std::chrono::steady_clock::time_point receivedSteady);
+    void publishBooks();
+    context_ptr on_tls_init();
+    void on_open(websocketpp::connection_hdl hdl);
+    void on_socket_init(websocketpp::connection_hdl hdl, boost::asio::ssl::stream<boost::asio::ip::tcp::socket> &socket);
+    void refreshConfig();
+    void sendSubscriptionOp(const char *op, const std::vector<ConfigManager::Subscription> &subscriptions);
 
 public:
     WebSocketClass(const std::string &uri, std::atomic<int> &WebSocketRequestsCount, std::mutex &mutex);
     void wsrun(std::atomic<bool> &flag);
+    // Messages are handled inside gate->enter()/leave() and the open socket is
+    // registered with gate->watch(), so calculations yield to pending data too
+    void setPreemptionGate(PreemptionGate *gate) { m_gate = gate; }
+    // Feed, socket and logging settings, built-in defaults until set. Each event on
+    // the feed thread picks up the latest published snapshot; changed subscriptions
+    // are applied to the open connection
+    void setConfig(RcuPointer<ConfigManager::Snapshot> &config);
+    // Build the TLS context and run the message decoder over a sample book update,
+    // so the first real message finds both ready
+    void prewarm(int decodePasses);
+    // Reference point for the time-to-first-update and time-to-steady-state reports
+    void setStartTime(std::chrono::steady_clock::time_point start) { m_startTime = start; }
+    long long timeToFirstUpdateUs() const { return m_firstUpdateUs.load(); }
+    long long timeToSteadyStateUs() const { return m_steadyStateUs.load(); }
+    // Steady clock receive time of the latest book update, the tick for orders
+    // it leads to (OrderGateway); default-constructed before the first one
+    std::chrono::steady_clock::time_point lastUpdateReceived() const
+    {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_lastUpdateTicks.load(std::memory_order_acquire)));
+    }
+    // Record every raw message to the file set in the feed configuration, if any
+    void setCapture(std::unique_ptr<FeedCapture> capture) { m_capture = std::move(capture); }
+
+    // Safe from any thread. Subscription changes run on the feed thread and last
+    // until the next configuration reload, which restores the file's list
+    void changeSubscription(const ConfigManager::Subscription &subscription, bool subscribe);
+    std::vector<ConfigManager::Subscription> subscriptions() const;
+    // Sampled: at most kBookPublishInterval behind the feed
+    std::map<std::string, BookView> books() const;
+    static constexpr std::chrono::milliseconds kBookPublishInterval{100};
+    const LatencyHistogram &handleLatency() const { return m_handleLatency; }
+    const LatencyHistogram &exchangeLatency() const { return m_exchangeLatency; }
+    FeedCapture *capture() const { return m_capture.get(); }
     static std::mutex m_mutex;
     static std::atomic<int> m_WebSocketRequestsCount;
 };
@@ -0,0 +1,147 @@
+#ifndef WORKER_PROCESS_POOL_H
+#define WORKER_PROCESS_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "CalculationService.h"
+#include "CalculationWorker.h"
+#include "SharedMemoryBuffer.h"
+
+/**
+ * @brief Dispatches calculation jobs to a pool of calculation_worker processes
+ *
+ * Each worker is a separate process connected by a socketpair, so a heavy
+ * or crashing job cannot disturb the feed process's memory or caches, and
+ * every worker can be pinned to its own CPU (affinity only; memory is not
+ * bound to a NUMA node). Jobs are built directly in
+ * shared memory (Job) and only their handle is sent; the worker writes the
+ * result into the same buffer. One dispatcher thread per worker takes jobs
+ * from a shared queue, so a slow job only holds up its own worker.
+ *
+ * Workers inherit the dispatcher's kernel ISA and GEMM tuning, so a job
+ * gives the same bits as CalculationService::execute in-process. A worker
+ * that dies fails its current job and is restarted; an idle one is checked
+ * every kIdleCheck. stop() waits kStopGrace for running jobs, then kills
+ * the workers still busy.
+ */
+class WorkerProcessPool {
+public:
+    /**
+     * @brief A job whose matrices live in shared memory
+     *
+     * Fill a() and b() in place, submit(), and read result() once the
+     * future is ready.
+     * @throws std::invalid_argument if the shapes do not fit the job type
+     */
+    class Job {
+    public:
+        Job(CalculationService::JobType type, int aRows, int aCols, int bRows = 0, int bCols = 0,
+            double decay = 0.95);
+
+        double* a() { return m_buffer->data(); }
+        double* b() { return m_buffer->data() + (size_t)m_message.aRows * m_message.aCols; }
+        const double* result() const { return m_buffer->data() + m_resultOffset; }
+        int resultRows() const { return m_resultRows; }
+        int resultCols() const { return m_resultCols; }
+
+    private:
+        friend class WorkerProcessPool;
+        CalculationWorker::JobMessage m_message;
+        size_t m_resultOffset;
+        int m_resultRows;
+        int m_resultCols;
+        std::unique_ptr<SharedMemoryBuffer> m_buffer;
+    };
+
+    struct Outcome {
+        CalculationService::Status status = CalculationService::Status::Failed;
+        std::chrono::microseconds queueDelay{0};
+        std::chrono::microseconds execTime{0};
+    };
+
+    /**
+     * @brief Counters owned by one worker slot, readable from any thread
+     */
+    struct WorkerStats {
+        std::atomic<int> completed{0};
+        std::atomic<int> failed{0};
+        std::atomic<int> restarts{0};
+        std::atomic<long long> busyMicros{0};
+    };
+
+    /**
+     * @param binary Path of the calculation_worker executable
+     * @param cpus Worker i is pinned to cpus[i % size]; empty leaves placement to the OS
+     */
+    WorkerProcessPool(const std::string& binary, int processes, const std::vector<int>& cpus);
+    ~WorkerProcessPool();
+    WorkerProcessPool(const WorkerProcessPool&) = delete;
+    WorkerProcessPool& operator=(const WorkerProcessPool&) = delete;
+
+    void start();
+    void stop();
+
+    std::future<Outcome> submit(std::shared_ptr<Job> job);
+
+    /**
+     * @brief Drive the pool with random inversions until flag is set
+     */
+    void run(std::atomic<bool>& flag, std::atomic<int>& heavyTasksCount, std::mutex& mutex, int matrixSize);
+
+    /**
+     * @brief Per-worker counters, with jobs per second over the measured wall time of the last run()
+     */
+    void printStats() const;
+
+    /// Interval at which an idle dispatcher checks that its worker is alive
+    static constexpr std::chrono::milliseconds kIdleCheck{250};
+    /// Time stop() and reap() give a worker before killing it
+    static constexpr std::chrono::milliseconds kStopGrace{2000};
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        pid_t pid = -1;
+        int socket = -1;
+        int cpu = -1;
+    };
+
+    struct Pending {
+        std::shared_ptr<Job> job;
+        std::promise<Outcome> promise;
+        Clock::time_point enqueued;
+    };
+
+    std::string m_binary;
+    int m_processes;
+    std::vector<Slot> m_slots;
+    std::vector<std::unique_ptr<WorkerStats>> m_stats;
+
+    std::deque<Pending> m_queue;
+    std::mutex m_queueMutex;
+    std::condition_variable m_jobReady;
+    std::atomic<bool> m_stopping;
+    std::atomic<Clock::rep> m_stopDeadline{0};  // Busy workers are killed after this once stopping
+    std::vector<std::thread> m_threads;
+    std::atomic<uint64_t> m_nextId{0};
+    std::atomic<long long> m_runMicros{0};  // Wall time of the last run()
+
+    bool spawn(int index);
+    void reap(int index);
+    void restart(int index);
+    bool idleWorkerLost(int index) const;
+    bool awaitReply(int index, CalculationWorker::ReplyMessage& reply);
+    void dispatchLoop(int index);
+};
+
+#endif // WORKER_PROCESS_POOL_H
@@ -0,0 +1,215 @@
+#include "AdminServer.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+   const size_t kMaxClients = 8;
+   const size_t kMaxLine = 4096;
+
+   bool sendAll(int fd, const std::string &text)
+   {
+      size_t sent = 0;
+      while (sent < text.size())
+      {
+         const ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n <= 0)
+            return false;
+         sent += (size_t)n;
+      }
+      return true;
+   }
+}
+
+AdminServer::AdminServer(const std::string &path) : m_path(path)
+{
+   const size_t pid = m_path.find("{pid}");
+   if (pid != std::string::npos)
+      m_path.replace(pid, 5, std::to_string(getpid()));
+}
+
+AdminServer::~AdminServer()
+{
+   stop();
+}
+
+void AdminServer::addCommand(const std::string &name, const std::string &usage, Handler handler)
+{
+   m_commands[name] = {usage, std::move(handler)};
+}
+
+void AdminServer::start()
+{
+   if (m_thread.joinable())
+      return;
+
+   sockaddr_un address = {};
+   address.sun_family = AF_UNIX;
+   if (m_path.empty() || m_path.size() >= sizeof(address.sun_path))
+      throw std::runtime_error("AdminServer: invalid socket path: " + m_path);
+   strncpy(address.sun_path, m_path.c_str(), sizeof(address.sun_path) - 1);
+
+   removeStaleSocket(address);
+   m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+   if (m_listener < 0)
+      throw std::runtime_error(std::string("AdminServer: socket failed: ") + strerror(errno));
+   // Owner only: the socket can change what the process is doing. Nobody
+   // can connect before listen(), so there is no window at the wider mode.
+   if (bind(m_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+       chmod(m_path.c_str(), S_IRUSR | S_IWUSR) < 0 || listen(m_listener, 4) < 0)
+   {
+      const int err = errno;
+      close(m_listener);
+      m_listener = -1;
+      throw std::runtime_error("AdminServer: cannot listen on " + m_path + ": " + strerror(err));
+   }
+
+   m_stop = false;
+   m_thread = std::thread(&AdminServer::serveLoop, this);
+   std::cout << "AdminServer: Listening on " << m_path << std::endl;
+}
+
+void AdminServer::removeStaleSocket(const sockaddr_un &address) const
+{
+   struct stat status;
+   if (lstat(m_path.c_str(), &status) != 0)
+      return;
+   if (!S_ISSOCK(status.st_mode))
+      throw std::runtime_error("AdminServer: " + m_path + " exists and is not a socket");
+
+   // A socket nobody accepts on is left over from a process that is gone
+   const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (probe < 0)
+      throw std::runtime_error(std::string("AdminServer: socket failed: ") + strerror(errno));
+   const int connected = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+   const int err = errno;
+   close(probe);
+   if (connected == 0)
+      throw std::runtime_error("AdminServer: " + m_path + " is in use by another process");
+   if (err != ECONNREFUSED)
+      throw std::runtime_error("AdminServer: cannot probe " + m_path + ": " + strerror(err));
+   unlink(m_path.c_str());
+}
+
+void AdminServer::stop()
+{
+   m_stop = true;
+   if (m_thread.joinable())
+      m_thread.join();
+   if (m_listener >= 0)
+   {
+      close(m_listener);
+      unlink(m_path.c_str());
+   }
+   m_listener = -1;
+}
+
+std::string AdminServer::execute(const std::string &line) const
+{
+   std::istringstream words(line);
+   std::string name;
+   std::vector<std::string> args;
+   words >> name;
+   for (std::string arg; words >> arg;)
+      args.push_back(arg);
+   if (name.empty())
+      return "";
+
+   if (name == "help")
+   {
+      std::ostringstream out;
+      out << "help\n";
+      for (const auto &command : m_commands)
+         out << command.first << (command.second.usage.empty() ? "" : " ") << command.second.usage << "\n";
+      return out.str();
+   }
+   const auto command = m_commands.find(name);
+   if (command == m_commands.end())
+      return "error: unknown command " + name + " (try help)\n";
+   try
+   {
+      std::string reply = command->second.handler(args);
+      if (!reply.empty() && reply.back() != '\n')
+         reply += '\n';
+      return reply;
+   }
+   catch (const std::exception &e)
+   {
+      return std::string("error: ") + e.what() + "\n";
+   }
+}
+
+void AdminServer::serveLoop()
+{
+   std::vector<int> clients;
+   std::vector<std::string> pending;  // Partial request line per client
+   char buffer[1024];
+
+   while (!m_stop)
+   {
+      std::vector<pollfd> fds;
+      fds.push_back({m_listener, POLLIN, 0});
+      for (int fd : clients)
+         fds.push_back({fd, POLLIN, 0});
+      if (poll(fds.data(), fds.size(), 200) <= 0)
+         continue;
+
+      if (fds[0].revents & POLLIN)
+      {
+         const int fd = accept4(m_listener, nullptr, nullptr, SOCK_CLOEXEC);
+         if (fd >= 0 && clients.size() >= kMaxClients)
+         {
+            sendAll(fd, "error: too many clients\n.\n");
+            close(fd);
+         }
+         else if (fd >= 0)
+         {
+            clients.push_back(fd);
+            pending.emplace_back();
+         }
+      }
+
+      for (size_t i = fds.size() - 1; i >= 1; i--)
+      {
+         if (!fds[i].revents)
+            continue;
+         const size_t c = i - 1;
+         const ssize_t n = recv(clients[c], buffer, sizeof(buffer), 0);
+         bool keep = n > 0;
+         if (keep)
+         {
+            pending[c].append(buffer, (size_t)n);
+            size_t newline;
+            while (keep && (newline = pending[c].find('\n')) != std::string::npos)
+            {
+               std::string line = pending[c].substr(0, newline);
+               pending[c].erase(0, newline + 1);
+               if (!line.empty() && line.back() == '\r')
+                  line.pop_back();
+               keep = sendAll(clients[c], execute(line) + ".\n");
+            }
+            keep = keep && pending[c].size() <= kMaxLine;
+         }
+         if (!keep)
+         {
+            close(clients[c]);
+            clients.erase(clients.begin() + c);
+            pending.erase(pending.begin() + c);
+         }
+      }
+   }
+
+   for (int fd : clients)
+      close(fd);
+}
@@ -1,45 +1,172 @@
 #include "CalculationClass.h"
+#include "MatrixKernels.h"
+#include "TiledMatrixFile.h"
+#include "PreemptionGate.h"
+#include "PerfCounters.h"
+#include "DistributedInverter.h"
+#include "SparseMatrix.h"
+#include "SparseLU.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
 
-CalculationClass::CalculationClass(int size)
+CalculationClass::CalculationClass(int size, Engine engine)
+    : CalculationClass(size, engine, Options())
 {
-   n = size;
-
-   if (!(A = (double *)malloc((n * n) * sizeof(double))))
+}
+CalculationClass::CalculationClass(int size, Engine engine, const Options &options)
+    : n(size), engine(engine), options(options), A(nullptr), X(nullptr), A_temp(nullptr), E(nullptr),
+      tiled(nullptr), sparse(nullptr), factors(nullptr), perm(nullptr), sampleCount(0), sampleIdx(nullptr), sampleRows(nullptr), iterations(0),
+      stepPhase(0), stepColumn(0)
+{
+   if (engine == Engine::OutOfCore)
    {
-      handleMemoryError();
+      // Rows are generated one at a time straight into the scratch file.
+      tiled = new TiledMatrixFile(n, options.tileSize, options.cacheTiles, options.scratchDir);
    }
-
-   if (!(A_temp = (double *)malloc((n * n) * sizeof(double))))
+   else if (engine == Engine::GaussJordan && !(A = (double *)malloc((n * n) * sizeof(double))))
    {
       handleMemoryError();
    }
 
-   if (!(E = (double *)malloc((n * n) * sizeof(double))))
+   if (engine != Engine::GaussJordan)
    {
-      handleMemoryError();
+      // Only the pivot vector and a few original rows are kept besides A.
+      sampleCount = n < 16 ? n : 16;
+
+      if (engine != Engine::OutOfCore && !(perm = (int *)malloc(n * sizeof(int))))
+      {
+         handleMemoryError();
+      }
+
+      if (!(sampleIdx = (int *)malloc(sampleCount * sizeof(int))))
+      {
+         handleMemoryError();
+      }
+
+      if (!(sampleRows = (double *)malloc(((size_t)sampleCount * n) * sizeof(double))))
+      {
+         handleMemoryError();
+      }
+
+      // A (and X) wait for ingest, which may keep the matrix sparse instead
+   }
+   else
+   {
+      if (!(A_temp = (double *)malloc((n * n) * sizeof(double))))
+      {
+         handleMemoryError();
+      }
+
+      if (!(E = (double *)malloc((n * n) * sizeof(double))))
+      {
+         handleMemoryError();
+      }
+
+      if (!(X = (double *)malloc((n * n) * sizeof(double))))
+      {
+         handleMemoryError();
+      }
    }
 
-   if (!(X = (double *)malloc((n * n) * sizeof(double))))
+   reset();
+}
+void CalculationClass::reset(unsigned int *seed)
+{
+   // rand_r() keeps pool workers off the shared rand() state
+   auto random = [seed]()
+   { return seed ? rand_r(seed) : rand(); };
+   int i;
+   std::vector<int> cols;
+   std::vector<double> values;
+
+   if (engine == Engine::OutOfCore)
    {
-      handleMemoryError();
+      double *row = (double *)malloc(n * sizeof(double));
+      if (!row)
+      {
+         handleMemoryError();
+      }
+
+      tiled->discardCache();
+      for (i = 0; i < sampleCount; i++)
+         sampleIdx[i] = random() % n;
+
+      for (i = 0; i < n; i++)
+      {
+         generateRow(i, seed, cols, values);
+         std::fill(row, row + n, 0.);
+         for (size_t p = 0; p < cols.size(); p++)
+            row[cols[p]] = values[p];
+         tiled->setRow(i, row);
+         for (int s = 0; s < sampleCount; s++)
+            if (sampleIdx[s] == i)
+               for (int j = 0; j < n; j++)
+                  sampleRows[(size_t)s * n + j] = row[j];
+      }
+      free(row);
+      return;
    }
 
-   if (!(X_temp = (double *)malloc((n * n) * sizeof(double))))
+   // Rows stay in CSR while the matrix is within the sparse threshold; the
+   // first row past it spills everything ingested so far to the dense A
+   delete sparse;
+   delete factors;
+   sparse = nullptr;
+   factors = nullptr;
+   SparseMatrix *csr = nullptr;
+   const double budget = options.sparseThreshold * n * double(n);
+   if (engine != Engine::GaussJordan && options.sparseThreshold > 0.)
+      csr = new SparseMatrix(n);
+   else
+      allocateDense();
+
+   for (i = 0; i < n; i++)
    {
-      handleMemoryError();
+      generateRow(i, seed, cols, values);
+      if (csr && csr->nonzeros() + cols.size() > budget)
+      {
+         allocateDense();
+         csr->toDense(A);
+         delete csr;
+         csr = nullptr;
+      }
+      if (csr)
+      {
+         csr->appendRow(cols.data(), values.data(), (int)cols.size());
+         continue;
+      }
+      double *row = A + (size_t)i * n;
+      std::fill(row, row + n, 0.);
+      for (size_t p = 0; p < cols.size(); p++)
+         row[cols[p]] = values[p];
    }
 
-   int i;
+   if (csr)
+   {
+      // Sparse residuals go through the factors, so only the indices are kept
+      sparse = csr;
+      releaseDense();
+      for (i = 0; i < sampleCount; i++)
+         sampleIdx[i] = random() % n;
+      return;
+   }
 
-   for (i = 0; i < n * n; i++)
+   if (engine != Engine::GaussJordan)
    {
-      A[i] = double(rand() % 10000) / double(1000);
+      for (i = 0; i < sampleCount; i++)
+      {
+         sampleIdx[i] = random() % n;
+         for (int j = 0; j < n; j++)
+            sampleRows[i * n + j] = A[sampleIdx[i] * n + j];
+      }
+      return;
    }
 
    for (i = 0; i < n * n; i++)
@@ -53,7 +180,119 @@ CalculationClass::CalculationClass(int size)
    for (i = 0; i < n * n; i++)
    {
       A_temp[i] = A[i];
-      X_temp[i] = X[i];
+   }
+}
+void CalculationClass::allocateDense()
+{
+   if (!A && !(A = (double *)malloc((n * n) * sizeof(double))))
+   {
+      handleMemoryError();
+   }
+
+   // Newton-Schulz leaves A untouched and builds the inverse in X.
+   if (engine == Engine::NewtonSchulz && !X && !(X = (double *)malloc((n * n) * sizeof(double))))
+   {
+      handleMemoryError();
+   }
+}
+void CalculationClass::releaseDense()
+{
+   free(A);
+   free(X);
+   A = nullptr;
+   X = nullptr;
+}
+void CalculationClass::generateRow(int i, unsigned int *seed, std::vector<int> &cols, std::vector<double> &values)
+{
+   auto random = [seed]()
+   { return seed ? rand_r(seed) : rand(); };
+   cols.clear();
+   values.clear();
+
+   if (options.density >= 1.)
+   {
+      for (int j = 0; j < n; j++)
+      {
+         cols.push_back(j);
+         values.push_back(double(random() % 10000) / double(1000));
+      }
+      return;
+   }
+
+   // Gaps between off-diagonal nonzeros are geometric, so a row costs O(its
+   // nonzeros); the diagonal is always set so no row or column is empty.
+   const double logMiss = std::log1p(-std::max(options.density, 0.));
+   bool diagonal = false;
+   for (int j = -1; logMiss < 0.;)
+   {
+      const double u = (random() + 1.) / (double(RAND_MAX) + 2.);
+      const double gap = std::floor(std::log(u) / logMiss);
+      if (j + 1. + gap >= n)
+         break;
+      j += 1 + (int)gap;
+      if (!diagonal && j >= i)
+      {
+         cols.push_back(i);
+         values.push_back(1. + double(random() % 10000) / double(1000));
+         diagonal = true;
+         if (j == i)
+            continue;
+      }
+      cols.push_back(j);
+      values.push_back(double(random() % 10000) / double(1000));
+   }
+   if (!diagonal)
+   {
+      cols.push_back(i);
+      values.push_back(1. + double(random() % 10000) / double(1000));
+   }
+}
+CalculationClass::~CalculationClass()
+{
+   free(A);
+   free(X);
+   free(A_temp);
+   free(E);
+   free(perm);
+   free(sampleIdx);
+   free(sampleRows);
+   delete tiled;
+   delete sparse;
+   delete factors;
+}
+CalculationClass::Engine CalculationClass::engineFromString(const std::string &name)
+{
+   if (name == "gauss_jordan")
+      return Engine::GaussJordan;
+   if (name == "in_place")
+      return Engine::InPlace;
+   if (name == "recursive")
+      return Engine::Recursive;
+   if (name == "newton_schulz")
+      return Engine::NewtonSchulz;
+   if (name == "out_of_core")
+      return Engine::OutOfCore;
+   if (name == "distributed")
+      return Engine::Distributed;
+   throw std::invalid_argument("Unknown calculation engine: " + name);
+}
+const char *CalculationClass::engineName(Engine engine)
+{
+   switch (engine)
+   {
+   case Engine::InPlace:
+      return "in_place";
+   case Engine::Recursive:
+      return "recursive";
+   case Engine::NewtonSchulz:
+      return "newton_schulz";
+   case Engine::OutOfCore:
+      return "out_of_core";
+   case Engine::Distributed:
+      return "distributed";
+   case Engine::GaussJordan:
+   default:
+      return "gauss_jordan";
    }
 }
 void CalculationClass::printRow(int i)
@@ -199,54 +438,65 @@ void CalculationClass::mainElementTemp()
 }
 int CalculationClass::gaussJordan()
 {
-   int i, j, k, max_row;
-   double temp, max_element;
-
    mainElement();
 
-   for (i = 0; i < n; i++)
+   stepPhase = 0;
+   stepColumn = 0;
+   while (gaussJordanStep(preemptionStride()) == 0)
+      preemptionPoint();
+   return 0;
+}
+int CalculationClass::gaussJordanStep(int columns)
+{
+   int i, j;
+   double temp;
+
+   // Phase 0 is the forward sweep over i = 0..n-1, phase 1 the backward
+   // sweep over i = n-1..0; stepColumn is the next i to process.
+   for (int step = 0; step < columns && stepPhase < 2; step++)
    {
-      temp = 1. / A[i * n + i];
+      i = stepColumn;
+      if (stepPhase == 0)
+      {
+         temp = 1. / A[i * n + i];
 
-      for (j = i; j < n; j++)
-         A[i * n + j] *= temp;
+         for (j = i; j < n; j++)
+            A[i * n + j] *= temp;
 
-      for (j = 0; j < n; j++)
-         X[i * n + j] *= temp;
+         for (j = 0; j < n; j++)
+            X[i * n + j] *= temp;
 
-      for (j = i + 1; j < n; j++)
-      {
-         temp = A[j * n + i];
-         for (k = i; k < n; k++)
-            A[j * n + k] -= temp * A[i * n + k];
+         for (j = i + 1; j < n; j++)
+         {
+            temp = A[j * n + i];
+            MatrixKernels::axpy(n - i, -temp, A + i * n + i, A + j * n + i);
+            MatrixKernels::axpy(n, -temp, X + i * n, X + j * n);
+         }
 
-         for (k = 0; k < n; k++)
-            X[j * n + k] -= temp * X[i * n + k];
+         if (++stepColumn == n)
+         {
+            stepPhase = 1;
+            stepColumn = n - 1;
+         }
       }
-   }
-   for (i = n - 1; i >= 0; i--)
-   {
-      for (j = i - 1; j >= 0; j--)
+      else
       {
-         temp = A[j * n + i];
-         for (k = 0; k < n; k++)
+         for (j = i - 1; j >= 0; j--)
          {
-            A[j * n + k] -= temp * A[i * n + k];
-            X[j * n + k] -= temp * X[i * n + k];
+            temp = A[j * n + i];
+            MatrixKernels::axpy(n, -temp, A + i * n, A + j * n);
+            MatrixKernels::axpy(n, -temp, X + i * n, X + j * n);
          }
+
+         if (--stepColumn < 0)
+            stepPhase = 2;
       }
    }
-   return 0;
+   return stepPhase == 2 ? 1 : 0;
 }
 void CalculationClass::matrixMultiplication()
 {
-   int i, j, k;
-   for (i = 0; i < n * n; i++)
-      E[i] = 0.0;
-   for (i = 0; i < n; i++)
-      for (j = 0; j < n; j++)
-         for (k = 0; k < n; k++)
-            E[i * n + j] += A_temp[i * n + k] * X[k * n + j];
+   MatrixKernels::multiplyFast(n, A_temp, n, X, n, E, n);
 }
 double CalculationClass::calculateAccuracy()
 {
@@ -263,6 +513,279 @@ double CalculationClass::calculateAccuracy()
    return fabs(sqrt(n) - norma);
 }
 
+int CalculationClass::gaussJordanInPlace()
+{
+   int status;
+
+   stepPhase = 0;
+   stepColumn = 0;
+   while ((status = gaussJordanInPlaceStep(preemptionStride())) == 0)
+      preemptionPoint();
+   return status < 0 ? -1 : 0;
+}
+int CalculationClass::gaussJordanInPlaceStep(int columns)
+{
+   int i, j, k, max_row;
+   double temp, max_element;
+
+   for (int step = 0; step < columns && stepPhase == 0; step++)
+   {
+      k = stepColumn;
+      max_element = fabs(A[k * n + k]);
+      max_row = k;
+      for (i = k + 1; i < n; i++)
+      {
+         if (max_element < fabs(A[i * n + k]))
+         {
+            max_element = fabs(A[i * n + k]);
+            max_row = i;
+         }
+      }
+
+      if (max_element < 1.e-20)
+      {
+         std::cout << "The matrix cannot be inverted!\n";
+         return -1;
+      }
+
+      perm[k] = max_row;
+      if (max_row != k)
+      {
+         for (j = 0; j < n; j++)
+         {
+            temp = A[k * n + j];
+            A[k * n + j] = A[max_row * n + j];
+            A[max_row * n + j] = temp;
+         }
+      }
+
+      // The pivot column of the identity is stored where A's column k was.
+      temp = 1. / A[k * n + k];
+      A[k * n + k] = 1.;
+      for (j = 0; j < n; j++)
+         A[k * n + j] *= temp;
+
+      for (i = 0; i < n; i++)
+      {
+         if (i == k)
+            continue;
+         temp = A[i * n + k];
+         A[i * n + k] = 0.;
+         MatrixKernels::axpy(n, -temp, A + k * n, A + i * n);
+      }
+
+      if (++stepColumn == n)
+         stepPhase = 1;
+   }
+
+   if (stepPhase == 0)
+      return 0;
+
+   // Undo the row interchanges as column interchanges, last pivot first.
+   for (k = n - 1; k >= 0; k--)
+   {
+      if (perm[k] == k)
+         continue;
+      for (i = 0; i < n; i++)
+      {
+         temp = A[i * n + k];
+         A[i * n + k] = A[i * n + perm[k]];
+         A[i * n + perm[k]] = temp;
+      }
+   }
+   stepPhase = 2;
+   return 1;
+}
+int CalculationClass::preemptionStride() const
+{
+   return options.gate && options.preemptColumns > 0 ? options.preemptColumns : n;
+}
+void CalculationClass::preemptionPoint()
+{
+   if (options.gate)
+      options.gate->yieldIfPending();
+}
+double CalculationClass::inversionFlops() const
+{
+   if (factors)
+      return factors->flops();
+   // Explicit inversion is 2n^3 however it is blocked; a Newton-Schulz step is two GEMMs
+   const double cube = double(n) * n * n;
+   return engine == Engine::NewtonSchulz ? 4. * cube * iterations : 2. * cube;
+}
+int CalculationClass::invertRecursive()
+{
+   if (MatrixKernels::invertRecursive(A, n, n, 0, 2, options.gate) != 0)
+   {
+      std::cout << "The matrix cannot be inverted!\n";
+      return -1;
+   }
+   return 0;
+}
+int CalculationClass::newtonSchulz(const double *guess)
+{
+   if (guess)
+   {
+      for (int i = 0; i < n * n; i++)
+         X[i] = guess[i];
+   }
+
+   MatrixKernels::NewtonSchulzStats stats;
+   int status = MatrixKernels::invertNewtonSchulz(A, n, X, guess != nullptr, 1.e-9, 100, &stats, options.gate);
+   iterations = stats.iterations;
+   std::cout << "CalculationClass: Newton-Schulz " << (stats.warmStarted ? "warm" : "cold")
+             << " start, " << stats.iterations << " iterations, ||I - AX|| = "
+             << std::scientific << std::setprecision(3) << stats.residual << '\n';
+   if (status != 0)
+   {
+      // A is still intact: invert a copy of it directly instead
+      std::cout << "CalculationClass: Newton-Schulz " << (status == -2 ? "stalled" : "did not converge")
+                << ", falling back to the recursive engine\n";
+      std::copy(A, A + (size_t)n * n, X);
+      status = MatrixKernels::invertRecursive(X, n, n, 0, 2, options.gate);
+      if (status != 0)
+         std::cout << "The matrix cannot be inverted!\n";
+   }
+   return status;
+}
+int CalculationClass::invertOutOfCore()
+{
+   if (tiled->invert(options.gate) != 0)
+   {
+      std::cout << "The matrix cannot be inverted!\n";
+      return -1;
+   }
+
+   const TiledMatrixFile::Stats &stats = tiled->stats();
+   std::cout << "CalculationClass: Out-of-core " << tiled->tileCount() << "x" << tiled->tileCount()
+             << " tiles, cache " << tiled->cacheCapacity() << " tiles, loads " << stats.loads
+             << ", write-backs " << stats.writebacks << ", hits " << stats.hits
+             << ", prefetches " << stats.prefetches << ", pivots " << stats.pivots << '\n';
+   return 0;
+}
+int CalculationClass::invertDistributed()
+{
+   if (!options.distributed)
+      throw std::runtime_error("CalculationClass: distributed engine has no node group");
+   if (options.distributed->invert(A, n) != 0)
+   {
+      std::cout << "The matrix cannot be inverted!\n";
+      return -1;
+   }
+   options.distributed->printReport();
+   return 0;
+}
+int CalculationClass::invertSparse()
+{
+   // Factor only: the inverse of a sparse matrix is dense in general, so it
+   // is applied through the factors (see sampledResidual()).
+   delete factors;
+   factors = new SparseLU();
+   if (factors->factor(*sparse, sparse->minimumDegreeOrdering(), 0.1, options.gate) != 0)
+   {
+      delete factors;
+      factors = nullptr;
+      std::cout << "The matrix cannot be inverted!\n";
+      return -1;
+   }
+
+   const size_t fill = factors->nonzerosL() + factors->nonzerosU();
+   std::cout << "CalculationClass: Sparse LU, density " << std::scientific << std::setprecision(2)
+             << sparse->density() << ", " << sparse->nonzeros() << " nonzeros, L+U " << fill
+             << " (fill " << std::fixed << std::setprecision(1) << double(fill) / sparse->nonzeros() << "x)\n";
+   return 0;
+}
+int CalculationClass::invert()
+{
+   if (sparse)
+      return invertSparse();
+
+   switch (engine)
+   {
+   case Engine::InPlace:
+      return gaussJordanInPlace();
+   case Engine::Recursive:
+      return invertRecursive();
+   case Engine::NewtonSchulz:
+      return newtonSchulz();
+   case Engine::OutOfCore:
+      return invertOutOfCore();
+   case Engine::Distributed:
+      return invertDistributed();
+   case Engine::GaussJordan:
+   default:
+      return gaussJordan();
+   }
+}
+double CalculationClass::sampledResidual()
+{
+   // ||(A * A^-1 - I)|| restricted to the retained rows of the original A.
+   double norma = 0.;
+   if (sparse)
+   {
+      // Sampled columns instead: x = A^-1 e_j through the factors, then A x - e_j
+      if (!factors)
+         return NAN;
+      std::vector<double> x(n), y(n);
+      for (int s = 0; s < sampleCount; s++)
+      {
+         std::fill(x.begin(), x.end(), 0.);
+         x[sampleIdx[s]] = 1.;
+         factors->solve(x.data(), x.data());
+         sparse->multiply(x.data(), y.data());
+         y[sampleIdx[s]] -= 1.;
+         for (int j = 0; j < n; j++)
+            norma += y[j] * y[j];
+      }
+      return sqrt(norma);
+   }
+
+   double *rows = (double *)malloc(((size_t)sampleCount * n) * sizeof(double));
+   if (!rows)
+   {
+      handleMemoryError();
+   }
+
+   if (engine == Engine::OutOfCore)
+   {
+      tiled->multiplyRowsLeft(sampleCount, sampleRows, rows);
+   }
+   else
+   {
+      const double *inverse = engine == Engine::NewtonSchulz ? X : A;
+      for (int s = 0; s < sampleCount; s++)
+      {
+         const double *a = sampleRows + (size_t)s * n;
+         double *row = rows + (size_t)s * n;
+         for (int j = 0; j < n; j++)
+            row[j] = 0.;
+         for (int k = 0; k < n; k++)
+            for (int j = 0; j < n; j++)
+               row[j] += a[k] * inverse[k * n + j];
+      }
+   }
+
+   for (int s = 0; s < sampleCount; s++)
+   {
+      double *row = rows + (size_t)s * n;
+      row[sampleIdx[s]] -= 1.;
+      for (int j = 0; j < n; j++)
+         norma += row[j] * row[j];
+   }
+   free(rows);
+   return sqrt(norma);
+}
+
+double CalculationClass::verify()
+{
+   if (engine != Engine::GaussJordan)
+      return sampledResidual();
+
+   mainElementTemp();
+   matrixMultiplication();
+   return calculateAccuracy();
+}
+
 void CalculationClass::handleMemoryError()
 {
    std::cerr << "Error allocating memory. Program terminating.\n";
@@ -272,37 +795,94 @@ void CalculationClass::handleMemoryError()
 void CalculationClass::run(std::atomic<bool> &flag, std::atomic<int> &heavyTasksCount, std::mutex &mutex)
 {
    double variable_for_time;
+   CalculationClass *previous = nullptr;
+   std::unique_ptr<PerfCounters> counters;
+   if (options.perfCounters)
+      counters.reset(new PerfCounters());
+   PerfCounters::Sample sample;
    try
    {
       while (!flag)
       {
          srand(time(0));
          variable_for_time = clock();
-         CalculationClass *calculation = new CalculationClass(n);
-         std::cout << "CalculationClass: Matrix " << n << " by " << n << " filled successfully.\n";
-         calculation->printEquation();
-         calculation->gaussJordan();
-         std::cout << "CalculationClass: Gauss-Jordan completed.\n";
-         std::cout << "CalculationClass: Matrix A and Matrix X after the gaussJordan function:\n";
-         calculation->printEquation();
-         calculation->mainElementTemp();
-         std::cout << "CalculationClass: Main element calculation completed.\n";
-         calculation->matrixMultiplication();
-         std::cout << "CalculationClass: Matrix multiplication completed.\n";
-         std::cout << "CalculationClass: Result of multiplying A (original) by X (after gaussJordan):\n";
-         calculation->printResult();
-
-         variable_for_time = clock() - variable_for_time;
-
+         const int size = options.liveSize ? options.liveSize->load(std::memory_order_relaxed) : n;
+         CalculationClass *calculation = new CalculationClass(size, engine, options);
+         std::cout << "CalculationClass: Matrix " << size << " by " << size << " filled successfully.\n";
          double accuracy;
-         accuracy = calculation->calculateAccuracy();
-         std::cout << std::scientific << std::setprecision(6) << "CalculationClass: L2 Norm ||AX - E|| = " << accuracy << '\n';
+         int status = 0;
+         if (engine != Engine::GaussJordan)
+         {
+            if (counters)
+               counters->start();
+            if (engine == Engine::NewtonSchulz && previous && previous->n == size && !calculation->sparse)
+               status = calculation->newtonSchulz(previous->X);
+            else
+               status = calculation->invert();
+            if (counters)
+               sample = counters->stop();
+
+            variable_for_time = clock() - variable_for_time;
+
+            if (status != 0)
+            {
+               // No inverse to verify: the residual of a failed attempt means nothing
+               std::cout << "CalculationClass: " << engineName(engine) << " inversion failed.\n";
+               accuracy = NAN;
+            }
+            else
+            {
+               std::cout << "CalculationClass: " << engineName(engine) << " inversion completed.\n";
+               accuracy = calculation->sampledResidual();
+               std::cout << std::scientific << std::setprecision(6) << "CalculationClass: Sampled L2 Norm ||AX - E|| (" << calculation->sampleCount << " rows) = " << accuracy << '\n';
+            }
+         }
+         else
+         {
+            calculation->printEquation();
+            if (counters)
+               counters->start();
+            calculation->gaussJordan();
+            if (counters)
+               sample = counters->stop();
+            std::cout << "CalculationClass: Gauss-Jordan completed.\n";
+            std::cout << "CalculationClass: Matrix A and Matrix X after the gaussJordan function:\n";
+            calculation->printEquation();
+            calculation->mainElementTemp();
+            std::cout << "CalculationClass: Main element calculation completed.\n";
+            calculation->matrixMultiplication();
+            std::cout << "CalculationClass: Matrix multiplication completed.\n";
+            std::cout << "CalculationClass: Result of multiplying A (original) by X (after gaussJordan):\n";
+            calculation->printResult();
+
+            variable_for_time = clock() - variable_for_time;
+
+            accuracy = calculation->calculateAccuracy();
+            std::cout << std::scientific << std::setprecision(6) << "CalculationClass: L2 Norm ||AX - E|| = " << accuracy << '\n';
+         }
+         const double flops = calculation->inversionFlops();
+         if (engine == Engine::NewtonSchulz)
+         {
+            // Kept as the warm-start guess for the next matrix; after a failure the next one starts cold
+            delete previous;
+            previous = status == 0 ? calculation : nullptr;
+            if (status != 0)
+               delete calculation;
+         }
+         else
+            delete calculation;
          {
             std::lock_guard<std::mutex> lock(mutex);
             std::cout << "CalculationClass: Calculation #" << heavyTasksCount++ << std::endl;
          }
          std::cout << "CalculationClass: Calculation time in seconds: " << std::fixed << std::setw(6) << std::setprecision(5) << variable_for_time / CLOCKS_PER_SEC << "\n";
+         if (counters)
+            std::cout << "CalculationClass: Kernel counters: " << PerfCounters::report(sample, flops) << "\n";
+         if (options.gate)
+            std::cout << "CalculationClass: Yielded to feed " << options.gate->yields() << " times ("
+                      << options.gate->yieldedMicros() / 1000 << " ms) so far\n";
       }
+      delete previous;
       std::cout << "CalculationClass: Finished!\n\n";
    }
    catch (const std::bad_alloc &e)
@@ -0,0 +1,172 @@
+#include "CalculationPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include "MatrixKernels.h"
+
+CalculationPool::CalculationPool(int workers, int matrixSize, CalculationClass::Engine engine,
+                                 const CalculationClass::Options &options)
+    : m_workers(workers < 1 ? 1 : workers),
+      m_innerThreads(std::max(1, (int)std::thread::hardware_concurrency() / m_workers)), m_matrixSize(matrixSize), m_engine(engine),
+      m_options(options), m_active(m_workers), m_stopping(false)
+{
+   for (int i = 0; i < m_workers; i++)
+      m_stats.push_back(std::make_unique<WorkerStats>());
+}
+
+CalculationPool::~CalculationPool()
+{
+   stop();
+}
+
+void CalculationPool::stop()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_stopping = true;
+      m_queue.clear();
+   }
+   m_jobReady.notify_all();
+   m_spaceReady.notify_all();
+   for (auto &thread : m_threads)
+      if (thread.joinable())
+         thread.join();
+   m_threads.clear();
+}
+
+void CalculationPool::run(std::atomic<bool> &flag, std::mutex &mutex)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_stopping = false;
+   }
+   const auto started = std::chrono::steady_clock::now();
+   for (int i = 0; i < m_workers; i++)
+      m_threads.emplace_back(&CalculationPool::workerLoop, this, i, std::ref(mutex));
+
+   unsigned int seedBase = (unsigned int)time(0);
+   int nextId = 0;
+   while (!flag)
+   {
+      std::unique_lock<std::mutex> lock(m_queueMutex);
+      const size_t depth = 2 * (size_t)m_active;
+      // Bounded wait so the stop flag is noticed promptly
+      m_spaceReady.wait_for(lock, std::chrono::milliseconds(50), [&]()
+                            { return m_queue.size() < depth; });
+      while (m_queue.size() < depth)
+      {
+         m_queue.push_back({nextId, seedBase + (unsigned int)nextId * 2654435761u});
+         nextId++;
+      }
+      lock.unlock();
+      m_jobReady.notify_all();
+   }
+
+   stop();
+   m_runMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+   std::cout << "CalculationPool: Finished!\n\n";
+}
+
+void CalculationPool::workerLoop(int index, std::mutex &mutex)
+{
+   WorkerStats &stats = *m_stats[index];
+   MatrixKernels::setThreadBudget(m_innerThreads);
+   try
+   {
+      auto workspace = std::make_unique<CalculationClass>(m_matrixSize, m_engine, m_options);
+      while (true)
+      {
+         Job job;
+         {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_jobReady.wait(lock, [&]()
+                            { return m_stopping || (index < m_active && !m_queue.empty()); });
+            if (m_stopping)
+               return;
+            job = m_queue.front();
+            m_queue.pop_front();
+         }
+         m_spaceReady.notify_one();
+
+         // A resized matrix costs one reallocation, then the workspace is reused again
+         const int size = m_options.liveSize ? m_options.liveSize->load(std::memory_order_relaxed) : m_matrixSize;
+         if (size != workspace->size())
+            workspace = std::make_unique<CalculationClass>(size, m_engine, m_options);
+
+         auto start = std::chrono::steady_clock::now();
+         workspace->reset(&job.seed);
+         int status = workspace->invert();
+         // No inverse to verify: the residual of a failed attempt means nothing
+         double accuracy = status == 0 ? workspace->verify() : NAN;
+         auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+         stats.busyMicros += elapsed.count();
+         if (status == 0)
+            stats.completed++;
+         else
+            stats.failed++;
+
+         std::lock_guard<std::mutex> lock(mutex);
+         if (status != 0)
+            std::cout << "CalculationPool: Worker " << index << " job #" << job.id << " failed"
+                      << " in " << std::fixed << std::setprecision(5) << elapsed.count() / 1e6 << " s" << std::endl;
+         else
+            std::cout << "CalculationPool: Worker " << index << " job #" << job.id
+                      << " residual " << std::scientific << std::setprecision(3) << accuracy
+                      << " in " << std::fixed << std::setprecision(5) << elapsed.count() / 1e6 << " s" << std::endl;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cerr << "CalculationPool: Worker " << index << " stopped: " << e.what() << std::endl;
+   }
+}
+
+int CalculationPool::setActiveWorkers(int active)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_active = std::max(1, std::min(active, m_workers));
+      active = m_active;
+   }
+   m_jobReady.notify_all();
+   m_spaceReady.notify_all();
+   return active;
+}
+
+int CalculationPool::activeWorkers() const
+{
+   std::lock_guard<std::mutex> lock(m_queueMutex);
+   return m_active;
+}
+
+int CalculationPool::totalCompleted() const
+{
+   int total = 0;
+   for (const auto &stats : m_stats)
+      total += stats->completed;
+   return total;
+}
+
+void CalculationPool::printStats() const
+{
+   const double seconds = m_runMicros / 1e6;
+   int failed = 0;
+   for (int i = 0; i < m_workers; i++)
+   {
+      const WorkerStats &stats = *m_stats[i];
+      failed += stats.failed;
+      std::cout << "CalculationPool: Worker " << i << ": " << stats.completed << " completed, "
+                << stats.failed << " failed, busy " << std::fixed << std::setprecision(2)
+                << stats.busyMicros / 1e6 << " s" << std::endl;
+   }
+   const int total = totalCompleted();
+   std::cout << "CalculationPool: Total " << total << " completed, " << failed << " failed, "
+             << std::fixed << std::setprecision(2) << (seconds > 0 ? total / seconds : 0.)
+             << " inversions/s over " << seconds << " s with " << m_workers << " workers of "
+             << m_innerThreads << (m_innerThreads == 1 ? " thread" : " threads") << std::endl;
+}
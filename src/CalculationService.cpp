@@ -0,0 +1,423 @@
+#include "CalculationService.h"
+#include "MatrixKernels.h"
+#include "ResultCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+   // Max-heap order: higher priority, then earlier deadline, then FIFO
+   template <typename JobPtr>
+   bool runsLater(const JobPtr a, const JobPtr b)
+   {
+      if (a->request.priority != b->request.priority)
+         return a->request.priority < b->request.priority;
+      if (a->request.deadline != b->request.deadline)
+         return a->request.deadline > b->request.deadline;
+      return a->sequence > b->sequence;
+   }
+
+   void atomicMax(std::atomic<uint64_t> &target, uint64_t value)
+   {
+      uint64_t current = target.load(std::memory_order_relaxed);
+      while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+      {
+      }
+   }
+}
+
+CalculationService::CalculationService()
+{
+}
+
+CalculationService::~CalculationService()
+{
+   stop();
+}
+
+void CalculationService::start(int workers)
+{
+   if (m_running.exchange(true))
+      return;
+   m_stopped = false;
+   for (int i = 0; i < (workers < 1 ? 1 : workers); i++)
+      m_threads.emplace_back(&CalculationService::workerLoop, this);
+}
+
+void CalculationService::enableCache(size_t capacityBytes)
+{
+   m_cache.reset(capacityBytes ? new ResultCache(capacityBytes) : nullptr);
+}
+
+void CalculationService::stop()
+{
+   m_stopped = true;
+   m_running = false;
+   m_wake.notify_all();
+   for (auto &thread : m_threads)
+      if (thread.joinable())
+         thread.join();
+   m_threads.clear();
+   expireQueued();
+}
+
+void CalculationService::expireQueued()
+{
+   // Whatever is still queued is dropped, but its caller still gets an answer.
+   std::vector<Job *> leftover;
+   {
+      std::lock_guard<std::mutex> lock(m_heapMutex);
+      drainInbox();
+      leftover.swap(m_heap);
+   }
+   for (Job *job : leftover)
+   {
+      Result result;
+      result.status = Status::Expired;
+      m_expired++;
+      complete(job, std::move(result));
+   }
+}
+
+void CalculationService::complete(Job *job, Result &&result)
+{
+   if (job->callback)
+   {
+      try
+      {
+         job->callback(std::move(result));
+      }
+      catch (const std::exception &e)
+      {
+         m_callbackErrors.fetch_add(1, std::memory_order_relaxed);
+         std::cerr << "CalculationService: Callback threw: " << e.what() << std::endl;
+      }
+      catch (...)
+      {
+         m_callbackErrors.fetch_add(1, std::memory_order_relaxed);
+         std::cerr << "CalculationService: Callback threw" << std::endl;
+      }
+   }
+   delete job;
+}
+
+void CalculationService::push(Job *job)
+{
+   job->enqueued = Clock::now();
+   job->sequence = m_sequence.fetch_add(1, std::memory_order_relaxed);
+   m_submitted.fetch_add(1, std::memory_order_relaxed);
+
+   Job *head = m_inbox.load(std::memory_order_relaxed);
+   do
+   {
+      job->next = head;
+   } while (!m_inbox.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+
+   // Notified without the mutex; workers also poll with a short timeout.
+   m_wake.notify_one();
+
+   // Raced with stop(): whichever of the two drains last answers the job
+   if (m_stopped)
+      expireQueued();
+}
+
+std::future<CalculationService::Result> CalculationService::submit(Request request)
+{
+   auto promise = std::make_shared<std::promise<Result>>();
+   std::future<Result> future = promise->get_future();
+   submit(std::move(request), [promise](Result &&result)
+          { promise->set_value(std::move(result)); });
+   return future;
+}
+
+void CalculationService::submit(Request request, Callback callback)
+{
+   Job *job = new Job();
+   job->request = std::move(request);
+   job->callback = std::move(callback);
+   if (m_stopped)
+   {
+      m_submitted.fetch_add(1, std::memory_order_relaxed);
+      m_rejected.fetch_add(1, std::memory_order_relaxed);
+      Result result;
+      result.status = Status::Rejected;
+      result.error = "service stopped";
+      complete(job, std::move(result));
+      return;
+   }
+   push(job);
+}
+
+void CalculationService::drainInbox()
+{
+   Job *job = m_inbox.exchange(nullptr, std::memory_order_acquire);
+   while (job)
+   {
+      Job *next = job->next;
+      m_heap.push_back(job);
+      std::push_heap(m_heap.begin(), m_heap.end(), runsLater<Job *>);
+      job = next;
+   }
+}
+
+CalculationService::Job *CalculationService::popNext()
+{
+   std::unique_lock<std::mutex> lock(m_heapMutex);
+   drainInbox();
+   if (m_heap.empty())
+   {
+      m_wake.wait_for(lock, std::chrono::milliseconds(1), [&]()
+                      { return !m_running || m_inbox.load(std::memory_order_relaxed) != nullptr; });
+      drainInbox();
+      if (m_heap.empty())
+         return nullptr;
+   }
+   std::pop_heap(m_heap.begin(), m_heap.end(), runsLater<Job *>);
+   Job *job = m_heap.back();
+   m_heap.pop_back();
+   return job;
+}
+
+void CalculationService::workerLoop()
+{
+   while (m_running)
+   {
+      Job *job = popNext();
+      if (job)
+         execute(job);
+   }
+}
+
+void CalculationService::execute(Job *job)
+{
+   Result result;
+   const Clock::time_point start = Clock::now();
+   result.queueDelay = std::chrono::duration_cast<std::chrono::microseconds>(start - job->enqueued);
+   m_queueMicros.fetch_add(result.queueDelay.count(), std::memory_order_relaxed);
+   atomicMax(m_maxQueueMicros, result.queueDelay.count());
+
+   if (start > job->request.deadline)
+   {
+      result.status = Status::Expired;
+      m_expired.fetch_add(1, std::memory_order_relaxed);
+   }
+   else
+   {
+      bool ok;
+      bool cached = false;
+      ResultCache::Key key = {0, 0};
+      try
+      {
+         if (m_cache)
+         {
+            key = ResultCache::keyOf(job->request);
+            m_cache->recordHashTime(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+            cached = m_cache->lookup(key, result.value);
+         }
+         ok = cached || execute(job->request, result.value);
+      }
+      catch (const std::exception &e)
+      {
+         result.error = e.what();
+         ok = false;
+      }
+      result.execTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+      m_execMicros.fetch_add(result.execTime.count(), std::memory_order_relaxed);
+      if (m_cache && ok && !cached)
+         m_cache->insert(key, result.value, result.execTime.count());
+      result.status = ok ? Status::Done : Status::Failed;
+      (ok ? m_completed : m_failed).fetch_add(1, std::memory_order_relaxed);
+   }
+
+   complete(job, std::move(result));
+}
+
+bool CalculationService::execute(const Request &request, Matrix &value)
+{
+   const Matrix &a = request.a;
+   const Matrix &b = request.b;
+   if ((size_t)a.rows * a.cols != a.data.size() || (size_t)b.rows * b.cols != b.data.size())
+   {
+      throw std::invalid_argument("matrix data does not match its dimensions");
+   }
+
+   resultShape(request.type, a.rows, a.cols, b.rows, b.cols, value.rows, value.cols);
+   value.data.resize((size_t)value.rows * value.cols);
+   return execute(request.type, request.decay, a.data.data(), a.rows, a.cols,
+                  b.data.data(), b.rows, b.cols, value.data.data());
+}
+
+void CalculationService::resultShape(JobType type, int aRows, int aCols, int bRows, int bCols,
+                                     int &rows, int &cols)
+{
+   switch (type)
+   {
+   case JobType::Invert:
+      if (aRows != aCols)
+         throw std::invalid_argument("invert needs a square matrix");
+      rows = cols = aRows;
+      return;
+
+   case JobType::Solve:
+      if (aRows != aCols || bRows != aRows)
+         throw std::invalid_argument("solve needs square a and b with matching rows");
+      rows = bRows;
+      cols = bCols;
+      return;
+
+   case JobType::Multiply:
+      if (aCols != bRows)
+         throw std::invalid_argument("multiply needs cols(a) == rows(b)");
+      rows = aRows;
+      cols = bCols;
+      return;
+
+   case JobType::CovarianceUpdate:
+      if (aRows != aCols || bCols != aCols || bRows == 0)
+         throw std::invalid_argument("covariance update needs n x n a and m x n observations");
+      rows = cols = aRows;
+      return;
+   }
+   throw std::invalid_argument("unknown job type");
+}
+
+bool CalculationService::execute(JobType type, double decay,
+                                 const double *a, int aRows, int aCols,
+                                 const double *b, int bRows, int bCols, double *out)
+{
+   int rows, cols;
+   resultShape(type, aRows, aCols, bRows, bCols, rows, cols);
+
+   switch (type)
+   {
+   case JobType::Invert:
+      std::copy(a, a + (size_t)aRows * aCols, out);
+      return MatrixKernels::invertBase(out, aCols, aRows) == 0;
+
+   case JobType::Solve:
+   {
+      std::vector<double> lu(a, a + (size_t)aRows * aCols);
+      std::copy(b, b + (size_t)bRows * bCols, out);
+      return MatrixKernels::solve(lu.data(), aRows, out, bCols) == 0;
+   }
+
+   case JobType::Multiply:
+      MatrixKernels::multiply(aRows, aCols, bCols, 1., a, aCols, b, bCols, 0., out, bCols);
+      return true;
+
+   case JobType::CovarianceUpdate:
+   {
+      const int n = aCols;
+      const double weight = (1. - decay) / bRows;
+      for (size_t q = 0; q < (size_t)n * n; q++)
+         out[q] = decay * a[q];
+      for (int r = 0; r < bRows; r++)
+      {
+         const double *obs = b + (size_t)r * n;
+         for (int i = 0; i < n; i++)
+            MatrixKernels::axpy(n, weight * obs[i], obs, out + (size_t)i * n);
+      }
+      return true;
+   }
+   }
+   return false;
+}
+
+CalculationService::Stats CalculationService::stats() const
+{
+   Stats stats;
+   stats.submitted = m_submitted.load(std::memory_order_relaxed);
+   stats.completed = m_completed.load(std::memory_order_relaxed);
+   stats.failed = m_failed.load(std::memory_order_relaxed);
+   stats.expired = m_expired.load(std::memory_order_relaxed);
+   stats.rejected = m_rejected.load(std::memory_order_relaxed);
+   stats.callbackErrors = m_callbackErrors.load(std::memory_order_relaxed);
+   stats.queueMicros = m_queueMicros.load(std::memory_order_relaxed);
+   stats.execMicros = m_execMicros.load(std::memory_order_relaxed);
+   stats.maxQueueMicros = m_maxQueueMicros.load(std::memory_order_relaxed);
+   return stats;
+}
+
+void CalculationService::printStats() const
+{
+   const Stats s = stats();
+   const uint64_t dequeued = s.completed + s.failed + s.expired;
+   const uint64_t executed = s.completed + s.failed;
+   std::cout << "CalculationService: " << s.submitted << " submitted, " << s.completed << " done, "
+             << s.failed << " failed, " << s.expired << " expired, " << s.rejected << " rejected, "
+             << s.callbackErrors << " callback errors" << std::endl;
+   std::cout << "CalculationService: Queue delay avg " << (dequeued ? s.queueMicros / dequeued : 0)
+             << " us, max " << s.maxQueueMicros << " us; execution avg "
+             << (executed ? s.execMicros / executed : 0) << " us" << std::endl;
+   if (m_cache)
+   {
+      const ResultCache::Stats c = m_cache->stats();
+      std::cout << "CalculationService: Result cache " << c.hits << " hits, " << c.misses << " misses ("
+                << std::fixed << std::setprecision(1) << 100. * ResultCache::hitRate(c) << "% hit rate), "
+                << c.evictions << " evictions, " << c.entries << " entries in " << c.bytesUsed / 1024
+                << " KiB; saved " << c.bytesSaved / 1024 << " KiB of results and "
+                << std::setprecision(3) << c.microsSaved / 1e6 << " s of compute for "
+                << c.hashMicros / 1e6 << " s of hashing" << std::endl;
+      if (c.misses > 0 && c.hits == 0)
+         std::cout << "CalculationService: No request repeated exactly; the cache only costs hashing here" << std::endl;
+   }
+}
+
+const char *CalculationService::statusName(Status status)
+{
+   switch (status)
+   {
+   case Status::Done:
+      return "done";
+   case Status::Expired:
+      return "expired";
+   case Status::Rejected:
+      return "rejected";
+   case Status::Failed:
+   default:
+      return "failed";
+   }
+}
+
+void CalculationService::run(std::atomic<bool> &flag, std::atomic<int> &heavyTasksCount, std::mutex &mutex,
+                             int matrixSize, std::chrono::milliseconds deadline)
+{
+   // Two jobs queued per worker, so the heap always has a choice to make
+   const size_t depth = 2 * std::max<size_t>(1, m_threads.size());
+   std::deque<std::pair<int, std::future<Result>>> inFlight;
+   int nextId = 0;
+   while (!flag || !inFlight.empty())
+   {
+      while (!flag && inFlight.size() < depth)
+      {
+         Request request;
+         request.type = JobType::Invert;
+         request.priority = nextId % 3;
+         request.deadline = Clock::now() + deadline;
+         request.a.rows = request.a.cols = matrixSize;
+         request.a.data.resize((size_t)matrixSize * matrixSize);
+         for (double &v : request.a.data)
+            v = double(rand() % 10000) / double(1000);
+         inFlight.emplace_back(request.priority, submit(std::move(request)));
+         nextId++;
+      }
+
+      const int priority = inFlight.front().first;
+      Result result = inFlight.front().second.get();
+      inFlight.pop_front();
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         std::cout << "CalculationService: Invert " << matrixSize << "x" << matrixSize << " priority " << priority
+                   << " " << statusName(result.status) << ", queued " << result.queueDelay.count()
+                   << " us, ran " << result.execTime.count() << " us"
+                   << (result.error.empty() ? "" : ": " + result.error) << std::endl;
+         if (result.status == Status::Done)
+            std::cout << "CalculationService: Calculation #" << heavyTasksCount++ << std::endl;
+      }
+   }
+   std::cout << "CalculationService: Finished!\n\n";
+}
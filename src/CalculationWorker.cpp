@@ -0,0 +1,204 @@
+#include "CalculationWorker.h"
+#include "CalculationService.h"
+#include "SharedMemoryBuffer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+   bool sendWithFd(int socket, const void *data, size_t bytes, int fd)
+   {
+      iovec iov;
+      iov.iov_base = const_cast<void *>(data);
+      iov.iov_len = bytes;
+
+      msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+
+      alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+      if (fd >= 0)
+      {
+         msg.msg_control = control;
+         msg.msg_controllen = sizeof(control);
+         cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg->cmsg_level = SOL_SOCKET;
+         cmsg->cmsg_type = SCM_RIGHTS;
+         cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+         memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+      }
+
+      ssize_t sent;
+      do
+      {
+         sent = sendmsg(socket, &msg, MSG_NOSIGNAL);
+      } while (sent < 0 && errno == EINTR);
+      return sent == (ssize_t)bytes;
+   }
+
+   bool receiveWithFd(int socket, void *data, size_t bytes, int &fd)
+   {
+      fd = -1;
+      iovec iov;
+      iov.iov_base = data;
+      iov.iov_len = bytes;
+
+      alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+      msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+
+      ssize_t received;
+      do
+      {
+         received = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+      } while (received < 0 && errno == EINTR);
+
+      for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+         if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+      if (received != (ssize_t)bytes || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+      {
+         if (fd >= 0)
+            close(fd);
+         fd = -1;
+         return false;
+      }
+      return true;
+   }
+}
+
+size_t CalculationWorker::bufferBytes(const JobMessage &job, size_t *resultOffset)
+{
+   if (job.aRows < 0 || job.aCols < 0 || job.bRows < 0 || job.bCols < 0)
+      throw std::invalid_argument("negative matrix dimension");
+
+   int rows, cols;
+   CalculationService::resultShape((CalculationService::JobType)job.type, job.aRows, job.aCols,
+                                   job.bRows, job.bCols, rows, cols);
+   const size_t inputs = (size_t)job.aRows * job.aCols + (size_t)job.bRows * job.bCols;
+   if (resultOffset)
+      *resultOffset = inputs;
+   return (inputs + (size_t)rows * cols) * sizeof(double);
+}
+
+bool CalculationWorker::sendJob(int socket, const JobMessage &job, int bufferFd)
+{
+   return sendWithFd(socket, &job, sizeof(job), bufferFd);
+}
+
+bool CalculationWorker::receiveJob(int socket, JobMessage &job, int &bufferFd)
+{
+   return receiveWithFd(socket, &job, sizeof(job), bufferFd) && job.magic == kMagic;
+}
+
+bool CalculationWorker::sendReply(int socket, const ReplyMessage &reply)
+{
+   return sendWithFd(socket, &reply, sizeof(reply), -1);
+}
+
+bool CalculationWorker::receiveReply(int socket, ReplyMessage &reply)
+{
+   int fd;
+   return receiveWithFd(socket, &reply, sizeof(reply), fd) && reply.magic == kMagic;
+}
+
+uint64_t CalculationWorker::serve(int socket)
+{
+   uint64_t served = 0;
+   JobMessage job;
+   int fd;
+   while (receiveJob(socket, job, fd))
+   {
+      ReplyMessage reply;
+      reply.magic = kMagic;
+      reply.id = job.id;
+      reply.status = Rejected;
+      reply.execMicros = 0;
+
+      auto start = std::chrono::steady_clock::now();
+      try
+      {
+         if (fd < 0)
+            throw std::invalid_argument("no buffer attached");
+         size_t resultOffset;
+         if (bufferBytes(job, &resultOffset) != job.bytes)
+            throw std::invalid_argument("buffer size does not match the job");
+
+         const int handle = fd;
+         fd = -1;
+         SharedMemoryBuffer buffer(handle, job.bytes);
+         const double *a = buffer.data();
+         const double *b = a + (size_t)job.aRows * job.aCols;
+         const bool ok = CalculationService::execute((CalculationService::JobType)job.type, job.decay,
+                                                     a, job.aRows, job.aCols, b, job.bRows, job.bCols,
+                                                     buffer.data() + resultOffset);
+         reply.status = ok ? Done : Singular;
+      }
+      catch (const std::exception &e)
+      {
+         std::cerr << "CalculationWorker: Job " << job.id << " rejected: " << e.what() << std::endl;
+         if (fd >= 0)
+            close(fd);
+      }
+      reply.execMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+      if (!sendReply(socket, reply))
+         break;
+      served++;
+   }
+   return served;
+}
+
+int CalculationWorker::listen(const std::string &path)
+{
+   sockaddr_un address;
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   if (path.size() >= sizeof(address.sun_path))
+   {
+      std::cerr << "CalculationWorker: Socket path too long: " << path << std::endl;
+      return 1;
+   }
+   strcpy(address.sun_path, path.c_str());
+
+   int server = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+   unlink(path.c_str());
+   if (server < 0 || bind(server, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(server, 1) != 0)
+   {
+      std::cerr << "CalculationWorker: Cannot listen on " << path << ": " << strerror(errno) << std::endl;
+      if (server >= 0)
+         close(server);
+      return 1;
+   }
+
+   std::cout << "CalculationWorker: Listening on " << path << std::endl;
+   while (true)
+   {
+      int connection = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         std::cerr << "CalculationWorker: accept failed: " << strerror(errno) << std::endl;
+         break;
+      }
+      const uint64_t served = serve(connection);
+      close(connection);
+      std::cout << "CalculationWorker: Dispatcher disconnected after " << served << " jobs" << std::endl;
+   }
+   close(server);
+   unlink(path.c_str());
+   return 1;
+}
@@ -1,7 +1,119 @@
 #include "ConfigManager.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <iterator>
+#include <unistd.h>
+
+namespace {
+    // OKXDataSrc credential field, environment variable holding it ("<name>_FD" for a descriptor)
+    const std::pair<const char*, const char*> kSecretFields[] = {
+        {"API_key", "OKX_API_KEY"},
+        {"API_secret", "OKX_API_SECRET"},
+        {"API_passphrase", "OKX_API_PASSPHRASE"},
+    };
+    const std::string kEnvironmentPrefix = "WSCLIENT__";
+    
+    const char* secretVariable(const std::string& field) {
+        for (const auto& secret : kSecretFields) {
+            if (field == secret.first) {
+                return secret.second;
+            }
+        }
+        return nullptr;
+    }
+    
+    bool isSecretPath(const std::string& path) {
+        return path.compare(0, 11, "OKXDataSrc.") == 0 && secretVariable(path.substr(11)) != nullptr;
+    }
+    
+    std::string readDescriptor(int fd) {
+        std::string value;
+        char buffer[256];
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) != 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            if (length < 0) {
+                const int err = errno;
+                close(fd);
+                throw std::runtime_error("Cannot read secret from descriptor " + std::to_string(fd) + ": " + strerror(err));
+            }
+            value.append(buffer, (size_t)length);
+        }
+        close(fd);
+        while (!value.empty() && (value.back() == '\n' || value.back() == '\r')) {
+            value.pop_back();
+        }
+        if (value.empty()) {
+            throw std::runtime_error("Empty secret on descriptor " + std::to_string(fd));
+        }
+        return value;
+    }
+    
+    int parseDescriptor(const std::string& text) {
+        if (text.empty() || text.size() > 6 || text.find_first_not_of("0123456789") != std::string::npos) {
+            throw std::invalid_argument("Invalid file descriptor: " + text);
+        }
+        return std::stoi(text);
+    }
+    
+    // Set Section.field[.field...] = value, creating objects on the way
+    void assign(nlohmann::json& config, const std::string& path, const std::string& value, const char* layer) {
+        if (isSecretPath(path)) {
+            throw std::runtime_error(std::string("Credentials cannot be set from the ") + layer + " layer: " + path);
+        }
+        nlohmann::json* node = &config;
+        size_t begin = 0;
+        while (true) {
+            const size_t dot = path.find('.', begin);
+            const std::string key = path.substr(begin, dot == std::string::npos ? std::string::npos : dot - begin);
+            if (key.empty() || !node->is_object()) {
+                throw std::runtime_error(std::string("Cannot apply ") + layer + " setting: " + path);
+            }
+            if (dot == std::string::npos) {
+                // Numbers, booleans and arrays keep their type, anything else is a string
+                nlohmann::json parsed = nlohmann::json::parse(value, nullptr, false);
+                (*node)[key] = parsed.is_discarded() ? nlohmann::json(value) : parsed;
+                return;
+            }
+            node = &(*node)[key];
+            if (node->is_null()) {
+                *node = nlohmann::json::object();
+            }
+            begin = dot + 1;
+        }
+    }
+    
+    // "Section.field" for each field of section that differs between two configurations
+    std::vector<std::string> changedFields(const nlohmann::json& before, const nlohmann::json& after,
+                                           const std::string& section) {
+        static const nlohmann::json kEmpty = nlohmann::json::object();
+        auto sectionOf = [&](const nlohmann::json& config) -> const nlohmann::json& {
+            auto found = config.find(section);
+            return found != config.end() && found->is_object() ? *found : kEmpty;
+        };
+        const nlohmann::json& old = sectionOf(before);
+        const nlohmann::json& now = sectionOf(after);
+        std::vector<std::string> changed;
+        for (auto field = old.begin(); field != old.end(); ++field) {
+            auto other = now.find(field.key());
+            if (other == now.end() || *other != field.value()) {
+                changed.push_back(section + "." + field.key());
+            }
+        }
+        for (auto field = now.begin(); field != now.end(); ++field) {
+            if (!old.contains(field.key())) {
+                changed.push_back(section + "." + field.key());
+            }
+        }
+        return changed;
+    }
+}
 
 ConfigManager::ConfigManager(const std::string& mode, const std::string& configPath)
     : m_mode(mode), m_configPath(configPath) {
@@ -11,7 +123,184 @@ ConfigManager::ConfigManager(const std::string& mode, const std::string& configP
     }
 }
 
+ConfigManager::CommandLine ConfigManager::parseCommandLine(int argc, char* argv[]) {
+    CommandLine options;
+    if (const char* mode = std::getenv("WSCLIENT_MODE")) {
+        options.mode = mode;
+    }
+    if (const char* configDir = std::getenv("WSCLIENT_CONFIG_DIR")) {
+        options.configDir = configDir;
+    }
+    
+    for (int i = 1; i < argc; i++) {
+        const std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            options.help = true;
+            continue;
+        }
+        if (option != "--mode" && option != "--config-dir" && option != "--set" && option != "--secret-fd") {
+            throw std::invalid_argument("Unknown option: " + option);
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + option);
+        }
+        const std::string value = argv[++i];
+        if (option == "--mode") {
+            options.mode = value;
+        } else if (option == "--config-dir") {
+            options.configDir = value;
+        } else if (option == "--set") {
+            options.overrides.push_back(value);
+        } else {
+            const size_t equals = value.find('=');
+            if (equals == std::string::npos) {
+                throw std::invalid_argument("--secret-fd expects FIELD=FD: " + value);
+            }
+            options.secretFds.emplace_back(value.substr(0, equals), parseDescriptor(value.substr(equals + 1)));
+        }
+    }
+    return options;
+}
+
+const char* ConfigManager::usage() {
+    return "Usage: websocket_client [options]\n"
+           "  --mode demo|prod              Configuration file <mode>.json (WSCLIENT_MODE)\n"
+           "  --config-dir DIR              Directory holding it, default config/ (WSCLIENT_CONFIG_DIR)\n"
+           "  --set Section.field=value     Override a setting; repeatable, wins over\n"
+           "                                WSCLIENT__Section__field=value in the environment\n"
+           "  --secret-fd FIELD=FD          Read API_key, API_secret or API_passphrase from a\n"
+           "                                descriptor (or OKX_API_KEY[_FD], OKX_API_SECRET[_FD],\n"
+           "                                OKX_API_PASSPHRASE[_FD] in the environment)\n"
+           "  --help                        Show this text\n";
+}
+
+bool ConfigManager::hasEnvironmentLayer() {
+    for (char** entry = environ; *entry; entry++) {
+        if (std::strncmp(*entry, kEnvironmentPrefix.c_str(), kEnvironmentPrefix.size()) == 0) {
+            return true;
+        }
+    }
+    for (const auto& secret : kSecretFields) {
+        if (std::getenv((std::string(secret.second) + "_FD").c_str())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConfigManager::setOverrides(const std::vector<std::string>& overrides) {
+    for (const auto& assignment : overrides) {
+        const size_t equals = assignment.find('=');
+        if (equals == std::string::npos || equals == 0) {
+            throw std::invalid_argument("--set expects Section.field=value: " + assignment);
+        }
+        if (isSecretPath(assignment.substr(0, equals))) {
+            throw std::invalid_argument("Credentials cannot be set with --set; use --secret-fd or the environment");
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    m_overrides = overrides;
+}
+
+void ConfigManager::readSecretFromFd(const std::string& field, int fd) {
+    if (!secretVariable(field)) {
+        throw std::invalid_argument("Unknown credential field: " + field);
+    }
+    std::string value = readDescriptor(fd);
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    m_secrets[field] = std::move(value);
+}
+
+void ConfigManager::loadSecrets() {
+    for (const auto& secret : kSecretFields) {
+        const std::string variable = secret.second;
+        const std::string fdVariable = variable + "_FD";
+        if (!m_secrets.count(secret.first)) {
+            if (const char* fd = std::getenv(fdVariable.c_str())) {
+                m_secrets[secret.first] = readDescriptor(parseDescriptor(fd));
+            } else if (const char* value = std::getenv(variable.c_str())) {
+                m_secrets[secret.first] = value;
+            }
+        }
+        unsetenv(variable.c_str());
+        unsetenv(fdVariable.c_str());
+    }
+}
+
+nlohmann::json ConfigManager::resolveLayers(nlohmann::json config) const {
+    for (char** entry = environ; *entry; entry++) {
+        const std::string variable = *entry;
+        const size_t equals = variable.find('=');
+        if (variable.compare(0, kEnvironmentPrefix.size(), kEnvironmentPrefix) != 0 || equals == std::string::npos) {
+            continue;
+        }
+        std::string path = variable.substr(kEnvironmentPrefix.size(), equals - kEnvironmentPrefix.size());
+        for (size_t separator; (separator = path.find("__")) != std::string::npos;) {
+            path.replace(separator, 2, ".");
+        }
+        assign(config, path, variable.substr(equals + 1), "environment");
+    }
+    for (const auto& assignment : m_overrides) {
+        const size_t equals = assignment.find('=');
+        assign(config, assignment.substr(0, equals), assignment.substr(equals + 1), "command line");
+    }
+    return config;
+}
+
 void ConfigManager::loadConfig() {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    loadSecrets();
+    m_config = resolveLayers(readConfigFile());
+    
+    // Validate configuration structure
+    if (!validateConfig()) {
+        throw std::runtime_error("Invalid configuration structure in file: " + getConfigFilePath());
+    }
+    
+    // Compile once; nothing reads m_config after this
+    m_snapshot.publish(compile(m_config, m_secrets));
+    
+    std::cout << "ConfigManager: Successfully loaded configuration for mode: " << m_mode << std::endl;
+}
+
+bool ConfigManager::reload() {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    std::unique_ptr<const Snapshot> next;
+    nlohmann::json previous;
+    try {
+        nlohmann::json candidate = resolveLayers(readConfigFile());
+        previous = std::move(m_config);
+        m_config = std::move(candidate);
+        if (!validateConfig()) {
+            throw std::runtime_error("invalid configuration structure");
+        }
+        next = compile(m_config, m_secrets);
+    } catch (const std::exception& e) {
+        if (!previous.is_null()) {
+            m_config = std::move(previous);
+        }
+        std::cerr << "ConfigManager: Reload rejected, keeping the running configuration: " << e.what() << std::endl;
+        return false;
+    }
+    
+    const Snapshot* published = next.get();
+    m_snapshot.publish(std::move(next));
+    std::cout << "ConfigManager: Reloaded configuration for mode: " << m_mode << std::endl;
+    warnUnappliedChanges(previous, m_config);
+    
+    // Only the next reload could retire it, and that waits for this lock
+    for (const auto& listener : m_listeners) {
+        listener(*published);
+    }
+    return true;
+}
+
+void ConfigManager::addReloadListener(std::function<void(const Snapshot&)> listener) {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    m_listeners.push_back(std::move(listener));
+}
+
+nlohmann::json ConfigManager::readConfigFile() const {
     std::string configFile = getConfigFilePath();
     
     // Check if file exists
@@ -25,38 +314,131 @@ void ConfigManager::loadConfig() {
         throw std::runtime_error("Failed to open configuration file: " + configFile);
     }
     
+    nlohmann::json config;
     try {
-        file >> m_config;
+        file >> config;
     } catch (const nlohmann::json::exception& e) {
         throw std::runtime_error("Failed to parse JSON configuration: " + std::string(e.what()));
     }
-    
-    // Validate configuration structure
-    if (!validateConfig()) {
-        throw std::runtime_error("Invalid configuration structure in file: " + configFile);
+    return config;
+}
+
+void ConfigManager::warnUnappliedChanges(const nlohmann::json& before, const nlohmann::json& after) const {
+    // Feed, Logging and Calculation.matrix_size are followed live; the rest is read once
+    for (const char* section : {"OKXDataSrc", "Threading", "Calculation", "Admin", "Warmup", "Orders"}) {
+        for (const std::string& field : changedFields(before, after, section)) {
+            if (field != "Calculation.matrix_size") {
+                std::cerr << "ConfigManager: Warning: " << field << " changed but takes effect only after a restart" << std::endl;
+            }
+        }
     }
-    
-    std::cout << "ConfigManager: Successfully loaded configuration for mode: " << m_mode << std::endl;
+    for (const std::string& field : changedFields(before, after, "Socket")) {
+        std::cerr << "ConfigManager: Warning: " << field << " changed but applies only from the next connection" << std::endl;
+    }
+}
+
+nlohmann::json ConfigManager::getRawConfig() const {
+    std::lock_guard<std::mutex> lock(m_reloadMutex);
+    return m_config;
 }
 
-ConfigManager::OKXConfig ConfigManager::getOKXConfig() const {
+const ConfigManager::Snapshot& ConfigManager::getSnapshot() const {
     if (!isLoaded()) {
         throw std::runtime_error("Configuration not loaded. Call loadConfig() first.");
     }
-    
-    if (!m_config.contains("OKXDataSrc")) {
+    return *m_snapshot.load();
+}
+
+std::unique_ptr<const ConfigManager::Snapshot> ConfigManager::compile(const nlohmann::json& config,
+                                                                     const std::map<std::string, std::string>& secrets) {
+    auto snapshot = std::make_unique<Snapshot>();
+    if (!config.contains("OKXDataSrc")) {
         throw std::runtime_error("OKXDataSrc configuration not found");
     }
+    snapshot->connectors.OKXDataSrc = compileOKXConfig(config["OKXDataSrc"], secrets);
     
-    const auto& okxSection = m_config["OKXDataSrc"];
+    if (config.contains("Feed")) {
+        snapshot->feed = compileFeedConfig(config["Feed"]);
+    }
+    
+    if (config.contains("Calculation")) {
+        snapshot->calculation = compileCalculationConfig(config["Calculation"]);
+    }
     
+    try {
+        if (config.contains("Threading")) {
+            const auto& threadingSection = config["Threading"];
+            auto& threading = snapshot->threading;
+            threading.run_seconds = threadingSection.value("run_seconds", threading.run_seconds);
+            threading.feed_cpu = threadingSection.value("feed_cpu", threading.feed_cpu);
+            threading.calculation_cpu = threadingSection.value("calculation_cpu", threading.calculation_cpu);
+        }
+        
+        if (config.contains("Socket")) {
+            const auto& socketSection = config["Socket"];
+            auto& socket = snapshot->socket;
+            socket.tcp_nodelay = socketSection.value("tcp_nodelay", socket.tcp_nodelay);
+            socket.receive_buffer_bytes = socketSection.value("receive_buffer_bytes", socket.receive_buffer_bytes);
+        }
+        
+        if (config.contains("Logging")) {
+            const auto& loggingSection = config["Logging"];
+            auto& logging = snapshot->logging;
+            const std::string level = loggingSection.value("level", std::string("info"));
+            logging.level = level == "debug" ? LogLevel::Debug
+                          : level == "warn"  ? LogLevel::Warn
+                          : level == "error" ? LogLevel::Error
+                                             : LogLevel::Info;
+            logging.access_log = loggingSection.value("access_log", logging.access_log);
+        }
+        
+        if (config.contains("Admin")) {
+            snapshot->admin.socket_path = config["Admin"].value("socket_path", snapshot->admin.socket_path);
+        }
+        
+        if (config.contains("Warmup")) {
+            const auto& warmupSection = config["Warmup"];
+            auto& warmup = snapshot->warmup;
+            warmup.resolve_dns = warmupSection.value("resolve_dns", warmup.resolve_dns);
+            warmup.decode_passes = warmupSection.value("decode_passes", warmup.decode_passes);
+            warmup.kernel_passes = warmupSection.value("kernel_passes", warmup.kernel_passes);
+            warmup.lock_memory = warmupSection.value("lock_memory", warmup.lock_memory);
+        }
+        
+        if (config.contains("Orders")) {
+            const auto& ordersSection = config["Orders"];
+            auto& orders = snapshot->orders;
+            orders.enabled = ordersSection.value("enabled", orders.enabled);
+            orders.inst_id = ordersSection.value("inst_id", orders.inst_id);
+            orders.td_mode = ordersSection.value("td_mode", orders.td_mode);
+            orders.ord_type = ordersSection.value("ord_type", orders.ord_type);
+            orders.px_decimals = ordersSection.value("px_decimals", orders.px_decimals);
+            orders.sz_decimals = ordersSection.value("sz_decimals", orders.sz_decimals);
+            orders.client_id_prefix = ordersSection.value("client_id_prefix", orders.client_id_prefix);
+            orders.batch_window_us = ordersSection.value("batch_window_us", orders.batch_window_us);
+            orders.batch_limit = ordersSection.value("batch_limit", orders.batch_limit);
+            orders.max_open_orders = ordersSection.value("max_open_orders", orders.max_open_orders);
+        }
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Failed to parse runtime configuration: " + std::string(e.what()));
+    }
+    
+    return snapshot;
+}
+
+ConfigManager::OKXConfig ConfigManager::compileOKXConfig(const nlohmann::json& okxSection,
+                                                         const std::map<std::string, std::string>& secrets) {
     OKXConfig config;
+    auto credential = [&](const char* field) {
+        const auto secret = secrets.find(field);
+        return secret != secrets.end() ? secret->second : std::string();
+    };
     try {
         config.url_pub = okxSection.at("url_pub").get<std::string>();
         config.url_private = okxSection.at("url_private").get<std::string>();
-        config.API_key = okxSection.at("API_key").get<std::string>();
-        config.API_secret = okxSection.at("API_secret").get<std::string>();
-        config.API_passphrase = okxSection.at("API_passphrase").get<std::string>();
+        config.API_key = credential("API_key");
+        config.API_secret = credential("API_secret");
+        config.API_passphrase = credential("API_passphrase");
     } catch (const nlohmann::json::exception& e) {
         throw std::runtime_error("Failed to parse OKX configuration: " + std::string(e.what()));
     }
@@ -64,9 +446,58 @@ ConfigManager::OKXConfig ConfigManager::getOKXConfig() const {
     return config;
 }
 
-ConfigManager::ConnectorConfig ConfigManager::getConnectorConfig() const {
-    ConnectorConfig config;
-    config.OKXDataSrc = getOKXConfig();
+ConfigManager::FeedConfig ConfigManager::compileFeedConfig(const nlohmann::json& feedSection) {
+    FeedConfig config;
+    config.capture_path = feedSection.value("capture_path", config.capture_path);
+    if (!feedSection.contains("subscriptions")) {
+        return config;
+    }
+    
+    config.subscriptions.clear();
+    nlohmann::ordered_json args = nlohmann::ordered_json::array();
+    try {
+        for (const auto& entry : feedSection["subscriptions"]) {
+            Subscription subscription;
+            subscription.channel = entry.at("channel").get<std::string>();
+            subscription.instId = entry.at("instId").get<std::string>();
+            args.push_back({{"channel", subscription.channel}, {"instId", subscription.instId}});
+            config.subscriptions.push_back(subscription);
+        }
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Failed to parse Feed configuration: " + std::string(e.what()));
+    }
+    config.subscribe_message = nlohmann::ordered_json({{"op", "subscribe"}, {"args", args}}).dump();
+    
+    return config;
+}
+
+ConfigManager::CalculationConfig ConfigManager::compileCalculationConfig(const nlohmann::json& calcSection) {
+    CalculationConfig config;
+    try {
+        config.matrix_size = calcSection.value("matrix_size", config.matrix_size);
+        config.engine = calcSection.value("engine", config.engine);
+        config.tile_size = calcSection.value("tile_size", config.tile_size);
+        config.tile_cache_tiles = calcSection.value("tile_cache_tiles", config.tile_cache_tiles);
+        config.scratch_dir = calcSection.value("scratch_dir", config.scratch_dir);
+        config.matrix_density = calcSection.value("matrix_density", config.matrix_density);
+        config.sparse_threshold = calcSection.value("sparse_threshold", config.sparse_threshold);
+        config.autotune = calcSection.value("autotune", config.autotune);
+        config.perf_counters = calcSection.value("perf_counters", config.perf_counters);
+        config.workers = calcSection.value("workers", config.workers);
+        config.preempt_columns = calcSection.value("preempt_columns", config.preempt_columns);
+        config.service_workers = calcSection.value("service_workers", config.service_workers);
+        config.job_deadline_ms = calcSection.value("job_deadline_ms", config.job_deadline_ms);
+        config.result_cache_mb = calcSection.value("result_cache_mb", config.result_cache_mb);
+        config.kernel_isa = calcSection.value("kernel_isa", config.kernel_isa);
+        config.worker_processes = calcSection.value("worker_processes", config.worker_processes);
+        config.worker_binary = calcSection.value("worker_binary", config.worker_binary);
+        config.worker_cpus = calcSection.value("worker_cpus", config.worker_cpus);
+        config.distributed_nodes = calcSection.value("distributed_nodes", config.distributed_nodes);
+        config.distributed_loopback = calcSection.value("distributed_loopback", config.distributed_loopback);
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Failed to parse Calculation configuration: " + std::string(e.what()));
+    }
+    
     return config;
 }
 
@@ -81,7 +512,20 @@ bool ConfigManager::validateConfig() const {
         return false;
     }
     
-    return validateOKXConfig(m_config["OKXDataSrc"]);
+    if (!validateOKXConfig(m_config["OKXDataSrc"])) {
+        return false;
+    }
+    
+    // Calculation section is optional
+    if (m_config.contains("Calculation") && !validateCalculationConfig(m_config["Calculation"])) {
+        return false;
+    }
+    
+    if (!validateRuntimeConfig(m_config)) {
+        return false;
+    }
+    
+    return true;
 }
 
 std::string ConfigManager::getConfigFilePath() const {
@@ -98,7 +542,7 @@ std::string ConfigManager::getConfigFilePath() const {
 bool ConfigManager::validateOKXConfig(const nlohmann::json& okxSection) const {
     // Required fields for OKX configuration
     const std::vector<std::string> requiredFields = {
-        "url_pub", "url_private", "API_key", "API_secret", "API_passphrase"
+        "url_pub", "url_private"
     };
     
     for (const auto& field : requiredFields) {
@@ -118,6 +562,25 @@ bool ConfigManager::validateOKXConfig(const nlohmann::json& okxSection) const {
         }
     }
     
+    // Credentials come from the environment or descriptors only, and as a set or not at all
+    size_t credentials = 0;
+    for (const auto& secret : kSecretFields) {
+        if (okxSection.contains(secret.first)) {
+            std::cerr << "ConfigManager: OKXDataSrc." << secret.first << " must not be in the configuration file; "
+                      << "set " << secret.second << ", " << secret.second << "_FD or --secret-fd" << std::endl;
+            return false;
+        }
+        credentials += m_secrets.count(secret.first);
+    }
+    if (credentials != 0 && credentials != std::size(kSecretFields)) {
+        std::cerr << "ConfigManager: Incomplete OKXDataSrc credentials; set all of";
+        for (const auto& secret : kSecretFields) {
+            std::cerr << " " << secret.second;
+        }
+        std::cerr << " (or their _FD descriptors) or none" << std::endl;
+        return false;
+    }
+    
     // Validate URL format (basic check)
     std::string url_pub = okxSection["url_pub"].get<std::string>();
     std::string url_private = okxSection["url_private"].get<std::string>();
@@ -132,5 +595,331 @@ bool ConfigManager::validateOKXConfig(const nlohmann::json& okxSection) const {
         return false;
     }
     
+    return true;
+}
+
+bool ConfigManager::validateRuntimeConfig(const nlohmann::json& config) const {
+    for (const char* section : {"Feed", "Threading", "Socket", "Logging", "Admin", "Warmup", "Orders"}) {
+        if (config.contains(section) && !config[section].is_object()) {
+            std::cerr << "ConfigManager: " << section << " section must be an object" << std::endl;
+            return false;
+        }
+    }
+    
+    if (config.contains("Feed") && config["Feed"].contains("subscriptions")) {
+        const auto& subscriptions = config["Feed"]["subscriptions"];
+        if (!subscriptions.is_array() || subscriptions.empty()) {
+            std::cerr << "ConfigManager: subscriptions must be a non-empty array in Feed" << std::endl;
+            return false;
+        }
+        for (const auto& entry : subscriptions) {
+            for (const char* field : {"channel", "instId"}) {
+                if (!entry.is_object() || !entry.contains(field) || !entry[field].is_string() ||
+                    entry[field].get<std::string>().empty()) {
+                    std::cerr << "ConfigManager: Each subscription in Feed needs a non-empty string: " << field << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    
+    if (config.contains("Feed") && config["Feed"].contains("capture_path") && !config["Feed"]["capture_path"].is_string()) {
+        std::cerr << "ConfigManager: Field must be a string in Feed: capture_path" << std::endl;
+        return false;
+    }
+    
+    if (config.contains("Admin") && config["Admin"].contains("socket_path") && !config["Admin"]["socket_path"].is_string()) {
+        std::cerr << "ConfigManager: Field must be a string in Admin: socket_path" << std::endl;
+        return false;
+    }
+    
+    if (config.contains("Warmup")) {
+        const auto& warmupSection = config["Warmup"];
+        for (const char* field : {"resolve_dns", "lock_memory"}) {
+            if (warmupSection.contains(field) && !warmupSection[field].is_boolean()) {
+                std::cerr << "ConfigManager: Field must be boolean in Warmup: " << field << std::endl;
+                return false;
+            }
+        }
+        for (const char* field : {"decode_passes", "kernel_passes"}) {
+            if (warmupSection.contains(field)) {
+                if (!warmupSection[field].is_number_integer() || warmupSection[field].get<int>() < 0) {
+                    std::cerr << "ConfigManager: " << field << " must be a non-negative integer in Warmup" << std::endl;
+                    return false;
+                }
+            }
+        }
+        // Locking would fault in and pin the whole scratch file mapping
+        if (warmupSection.value("lock_memory", false) && config.contains("Calculation") &&
+            config["Calculation"].value("engine", CalculationConfig().engine) == "out_of_core") {
+            std::cerr << "ConfigManager: Warmup.lock_memory cannot be used with the out_of_core engine" << std::endl;
+            return false;
+        }
+    }
+    
+    if (config.contains("Orders")) {
+        const auto& ordersSection = config["Orders"];
+        if (ordersSection.contains("enabled") && !ordersSection["enabled"].is_boolean()) {
+            std::cerr << "ConfigManager: Field must be boolean in Orders: enabled" << std::endl;
+            return false;
+        }
+        for (const char* field : {"inst_id", "td_mode", "ord_type", "client_id_prefix"}) {
+            if (ordersSection.contains(field) && !ordersSection[field].is_string()) {
+                std::cerr << "ConfigManager: Field must be a string in Orders: " << field << std::endl;
+                return false;
+            }
+        }
+        for (const char* field : {"px_decimals", "sz_decimals"}) {
+            if (ordersSection.contains(field)) {
+                if (!ordersSection[field].is_number_integer() || ordersSection[field].get<int>() < 0 ||
+                    ordersSection[field].get<int>() > 12) {
+                    std::cerr << "ConfigManager: " << field << " must be an integer from 0 to 12 in Orders" << std::endl;
+                    return false;
+                }
+            }
+        }
+        if (ordersSection.contains("batch_window_us")) {
+            if (!ordersSection["batch_window_us"].is_number_integer() || ordersSection["batch_window_us"].get<int>() < 0) {
+                std::cerr << "ConfigManager: batch_window_us must be a non-negative integer in Orders" << std::endl;
+                return false;
+            }
+        }
+        if (ordersSection.contains("batch_limit")) {
+            if (!ordersSection["batch_limit"].is_number_integer() || ordersSection["batch_limit"].get<int>() < 1 ||
+                ordersSection["batch_limit"].get<int>() > 20) {
+                std::cerr << "ConfigManager: batch_limit must be an integer from 1 to 20 in Orders" << std::endl;
+                return false;
+            }
+        }
+        if (ordersSection.contains("max_open_orders")) {
+            if (!ordersSection["max_open_orders"].is_number_integer() || ordersSection["max_open_orders"].get<int>() < 1) {
+                std::cerr << "ConfigManager: max_open_orders must be a positive integer in Orders" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    if (config.contains("Threading")) {
+        const auto& threadingSection = config["Threading"];
+        if (threadingSection.contains("run_seconds")) {
+            if (!threadingSection["run_seconds"].is_number_integer() || threadingSection["run_seconds"].get<int>() <= 0) {
+                std::cerr << "ConfigManager: run_seconds must be a positive integer in Threading" << std::endl;
+                return false;
+            }
+        }
+        for (const char* field : {"feed_cpu", "calculation_cpu"}) {
+            if (threadingSection.contains(field)) {
+                if (!threadingSection[field].is_number_integer() || threadingSection[field].get<int>() < -1) {
+                    std::cerr << "ConfigManager: " << field << " must be a CPU index or -1 in Threading" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    
+    if (config.contains("Socket")) {
+        const auto& socketSection = config["Socket"];
+        if (socketSection.contains("tcp_nodelay") && !socketSection["tcp_nodelay"].is_boolean()) {
+            std::cerr << "ConfigManager: Field must be boolean in Socket: tcp_nodelay" << std::endl;
+            return false;
+        }
+        if (socketSection.contains("receive_buffer_bytes")) {
+            if (!socketSection["receive_buffer_bytes"].is_number_integer() ||
+                socketSection["receive_buffer_bytes"].get<int>() < 0) {
+                std::cerr << "ConfigManager: receive_buffer_bytes must be a non-negative integer in Socket" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    if (config.contains("Logging")) {
+        const auto& loggingSection = config["Logging"];
+        if (loggingSection.contains("level")) {
+            const auto& level = loggingSection["level"];
+            if (!level.is_string() || (level != "debug" && level != "info" && level != "warn" && level != "error")) {
+                std::cerr << "ConfigManager: level must be one of debug, info, warn, error in Logging" << std::endl;
+                return false;
+            }
+        }
+        if (loggingSection.contains("access_log") && !loggingSection["access_log"].is_boolean()) {
+            std::cerr << "ConfigManager: Field must be boolean in Logging: access_log" << std::endl;
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool ConfigManager::validateCalculationConfig(const nlohmann::json& calcSection) const {
+    if (!calcSection.is_object()) {
+        std::cerr << "ConfigManager: Calculation section must be an object" << std::endl;
+        return false;
+    }
+    
+    if (calcSection.contains("matrix_size")) {
+        if (!calcSection["matrix_size"].is_number_integer() || calcSection["matrix_size"].get<int>() <= 0) {
+            std::cerr << "ConfigManager: matrix_size must be a positive integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("tile_size")) {
+        if (!calcSection["tile_size"].is_number_integer() || calcSection["tile_size"].get<int>() <= 0) {
+            std::cerr << "ConfigManager: tile_size must be a positive integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("tile_cache_tiles")) {
+        if (!calcSection["tile_cache_tiles"].is_number_integer() || calcSection["tile_cache_tiles"].get<int>() < 0) {
+            std::cerr << "ConfigManager: tile_cache_tiles must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("scratch_dir") && !calcSection["scratch_dir"].is_string()) {
+        std::cerr << "ConfigManager: Field must be string in Calculation: scratch_dir" << std::endl;
+        return false;
+    }
+    
+    if (calcSection.contains("workers")) {
+        if (!calcSection["workers"].is_number_integer() || calcSection["workers"].get<int>() < 0) {
+            std::cerr << "ConfigManager: workers must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("preempt_columns")) {
+        if (!calcSection["preempt_columns"].is_number_integer() || calcSection["preempt_columns"].get<int>() < 0) {
+            std::cerr << "ConfigManager: preempt_columns must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("service_workers")) {
+        if (!calcSection["service_workers"].is_number_integer() || calcSection["service_workers"].get<int>() < 0) {
+            std::cerr << "ConfigManager: service_workers must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("job_deadline_ms")) {
+        if (!calcSection["job_deadline_ms"].is_number_integer() || calcSection["job_deadline_ms"].get<int>() <= 0) {
+            std::cerr << "ConfigManager: job_deadline_ms must be a positive integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("worker_processes")) {
+        if (!calcSection["worker_processes"].is_number_integer() || calcSection["worker_processes"].get<int>() < 0) {
+            std::cerr << "ConfigManager: worker_processes must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("worker_binary") && !calcSection["worker_binary"].is_string()) {
+        std::cerr << "ConfigManager: Field must be string in Calculation: worker_binary" << std::endl;
+        return false;
+    }
+    
+    if (calcSection.contains("worker_cpus")) {
+        if (!calcSection["worker_cpus"].is_array()) {
+            std::cerr << "ConfigManager: Field must be array in Calculation: worker_cpus" << std::endl;
+            return false;
+        }
+        for (const auto& cpu : calcSection["worker_cpus"]) {
+            if (!cpu.is_number_integer() || cpu.get<int>() < 0) {
+                std::cerr << "ConfigManager: worker_cpus must hold non-negative integers in Calculation" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    if (calcSection.contains("distributed_nodes")) {
+        if (!calcSection["distributed_nodes"].is_array()) {
+            std::cerr << "ConfigManager: Field must be array in Calculation: distributed_nodes" << std::endl;
+            return false;
+        }
+        for (const auto& node : calcSection["distributed_nodes"]) {
+            if (!node.is_string() || node.get<std::string>().find(':') == std::string::npos) {
+                std::cerr << "ConfigManager: distributed_nodes must hold host:port strings in Calculation" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    if (calcSection.contains("distributed_loopback")) {
+        if (!calcSection["distributed_loopback"].is_number_integer() || calcSection["distributed_loopback"].get<int>() < 0) {
+            std::cerr << "ConfigManager: distributed_loopback must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("result_cache_mb")) {
+        if (!calcSection["result_cache_mb"].is_number_integer() || calcSection["result_cache_mb"].get<int>() < 0) {
+            std::cerr << "ConfigManager: result_cache_mb must be a non-negative integer in Calculation" << std::endl;
+            return false;
+        }
+    }
+    
+    for (const char* field : {"matrix_density", "sparse_threshold"}) {
+        if (calcSection.contains(field)) {
+            if (!calcSection[field].is_number() || calcSection[field].get<double>() < 0. ||
+                calcSection[field].get<double>() > 1.) {
+                std::cerr << "ConfigManager: " << field << " must be a number in [0, 1] in Calculation" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    if (calcSection.contains("autotune") && !calcSection["autotune"].is_boolean()) {
+        std::cerr << "ConfigManager: Field must be boolean in Calculation: autotune" << std::endl;
+        return false;
+    }
+    
+    if (calcSection.contains("perf_counters") && !calcSection["perf_counters"].is_boolean()) {
+        std::cerr << "ConfigManager: Field must be boolean in Calculation: perf_counters" << std::endl;
+        return false;
+    }
+    
+    if (calcSection.contains("engine")) {
+        if (!calcSection["engine"].is_string()) {
+            std::cerr << "ConfigManager: Field must be string in Calculation: engine" << std::endl;
+            return false;
+        }
+        
+        const std::string engine = calcSection["engine"].get<std::string>();
+        if (engine != "gauss_jordan" && engine != "in_place" && engine != "recursive" &&
+            engine != "newton_schulz" && engine != "out_of_core" &&
+            engine != "distributed") {
+            std::cerr << "ConfigManager: Unknown engine in Calculation: " << engine << std::endl;
+            return false;
+        }
+    }
+    
+    if (calcSection.contains("kernel_isa")) {
+        if (!calcSection["kernel_isa"].is_string()) {
+            std::cerr << "ConfigManager: Field must be string in Calculation: kernel_isa" << std::endl;
+            return false;
+        }
+        
+        const std::string isa = calcSection["kernel_isa"].get<std::string>();
+        if (isa != "auto" && isa != "baseline" && isa != "avx2" && isa != "avx512") {
+            std::cerr << "ConfigManager: Unknown kernel_isa in Calculation: " << isa << std::endl;
+            return false;
+        }
+    }
+    
+    // Only the in_place, recursive, newton_schulz and distributed engines ingest into CSR
+    const CalculationConfig defaults;
+    const std::string engine = calcSection.value("engine", defaults.engine);
+    const double density = calcSection.value("matrix_density", defaults.matrix_density);
+    const double sparseThreshold = calcSection.value("sparse_threshold", defaults.sparse_threshold);
+    if ((engine == "gauss_jordan" || engine == "out_of_core") && sparseThreshold > 0. && density <= sparseThreshold) {
+        std::cerr << "ConfigManager: Warning: Calculation.engine " << engine << " stays dense; "
+                  << "matrix_density " << density << " is within sparse_threshold " << sparseThreshold
+                  << " but only in_place, recursive, newton_schulz and distributed use the sparse LU path" << std::endl;
+    }
+    
     return true;
 } 
\ No newline at end of file
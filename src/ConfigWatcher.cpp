@@ -0,0 +1,94 @@
+#include "ConfigWatcher.h"
+#include "ConfigManager.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+ConfigWatcher::ConfigWatcher(ConfigManager &config, std::chrono::milliseconds settleTime)
+    : m_config(config), m_settleTime(settleTime)
+{
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+   stop();
+}
+
+void ConfigWatcher::start()
+{
+   if (m_thread.joinable())
+      return;
+
+   const std::filesystem::path file(m_config.getConfigFilePath());
+   const std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+   m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (m_inotify < 0)
+      throw std::runtime_error(std::string("ConfigWatcher: inotify unavailable: ") + strerror(errno));
+   // The directory, not the file: a rename-over replaces the file's inode
+   if (inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+   {
+      const int err = errno;
+      close(m_inotify);
+      m_inotify = -1;
+      throw std::runtime_error("ConfigWatcher: cannot watch " + directory + ": " + strerror(err));
+   }
+
+   m_stop = false;
+   m_thread = std::thread(&ConfigWatcher::watchLoop, this, file.filename().string());
+   std::cout << "ConfigWatcher: Watching " << file.string() << std::endl;
+}
+
+void ConfigWatcher::stop()
+{
+   m_stop = true;
+   if (m_thread.joinable())
+      m_thread.join();
+   if (m_inotify >= 0)
+      close(m_inotify);
+   m_inotify = -1;
+}
+
+void ConfigWatcher::watchLoop(std::string fileName)
+{
+   alignas(inotify_event) char buffer[4096];
+   bool pending = false;
+   auto due = std::chrono::steady_clock::now();
+
+   while (!m_stop)
+   {
+      pollfd pfd = {m_inotify, POLLIN, 0};
+      const int timeout = pending ? (int)m_settleTime.count() : 500;
+      if (poll(&pfd, 1, timeout) > 0)
+      {
+         ssize_t length;
+         while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+         {
+            for (char *p = buffer; p < buffer + length;)
+            {
+               const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+               if (event->len > 0 && fileName == event->name)
+               {
+                  pending = true;
+                  due = std::chrono::steady_clock::now() + m_settleTime;
+               }
+               p += sizeof(inotify_event) + event->len;
+            }
+         }
+      }
+
+      if (pending && std::chrono::steady_clock::now() >= due)
+      {
+         pending = false;
+         if (m_config.reload())
+            m_reloads++;
+         else
+            m_rejected++;
+      }
+      m_config.getLiveSnapshot().reclaim();
+   }
+}
@@ -0,0 +1,432 @@
+#include "DistributedInverter.h"
+#include "MatrixKernels.h"
+#include "Transport.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+   enum MessageKind : uint64_t
+   {
+      Control = 1,  // [n, tileSize] from the coordinator; n = 0 ends serve()
+      Scatter = 2,
+      Diagonal = 3, // [status, swap count, tileSize swap row pairs, D]
+      Column = 4,
+      Row = 5,
+      Gather = 6,
+      Stats = 7,
+      Panel = 8,    // Tile (i, k) to the diagonal owner, for pivoting
+      Swap = 9      // Rows moving between the owners of a tile column
+   };
+
+   uint64_t makeTag(MessageKind kind, int step, int index)
+   {
+      return (uint64_t(kind) << 56) | (uint64_t(step) << 28) | uint64_t(index);
+   }
+
+   using Clock = std::chrono::steady_clock;
+
+   double secondsSince(Clock::time_point start)
+   {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+   }
+
+   // Is there an index other than skip in [0, count) congruent to residue mod step?
+   bool hasOther(int residue, int step, int skip, int count)
+   {
+      int first = residue == skip ? residue + step : residue;
+      return first < count;
+   }
+}
+
+DistributedInverter::DistributedInverter(Transport &transport, int tileSize)
+    : m_transport(transport), m_tileSize(tileSize), m_tiles(0)
+{
+   // Squarest grid: pr the largest divisor of the node count not above its root
+   const int nodes = transport.size();
+   m_gridRows = 1;
+   for (int r = 1; r * r <= nodes; r++)
+      if (nodes % r == 0)
+         m_gridRows = r;
+   m_gridCols = nodes / m_gridRows;
+}
+
+int DistributedInverter::owner(int i, int j) const
+{
+   return (i % m_gridRows) * m_gridCols + (j % m_gridCols);
+}
+
+void DistributedInverter::sendTimed(int dest, uint64_t tag, const double *data, size_t count)
+{
+   const Clock::time_point start = Clock::now();
+   m_transport.send(dest, tag, data, count);
+   m_stats.commSeconds += secondsSince(start);
+}
+
+void DistributedInverter::receiveTimed(int source, uint64_t tag, double *data, size_t count)
+{
+   const Clock::time_point start = Clock::now();
+   m_transport.receive(source, tag, data, count);
+   m_stats.commSeconds += secondsSince(start);
+}
+
+int DistributedInverter::invert(double *A, int n)
+{
+   if (m_transport.rank() != 0)
+      throw std::logic_error("DistributedInverter: only rank 0 coordinates");
+   if (n <= 0 || m_tileSize <= 0)
+      throw std::invalid_argument("DistributedInverter: size and tile size must be positive");
+
+   const double control[2] = {double(n), double(m_tileSize)};
+   for (int r = 1; r < m_transport.size(); r++)
+      m_transport.send(r, makeTag(Control, 0, 0), control, 2);
+   return participate(n, m_tileSize, A, A) ? 0 : -1;
+}
+
+void DistributedInverter::serve()
+{
+   while (true)
+   {
+      double control[2];
+      m_transport.receive(0, makeTag(Control, 0, 0), control, 2);
+      if (control[0] <= 0.)
+         return;
+      participate((int)control[0], (int)control[1], nullptr, nullptr);
+   }
+}
+
+void DistributedInverter::shutdown()
+{
+   const double control[2] = {0., 0.};
+   for (int r = 1; r < m_transport.size(); r++)
+      m_transport.send(r, makeTag(Control, 0, 0), control, 2);
+}
+
+bool DistributedInverter::participate(int n, int tileSize, const double *A, double *result)
+{
+   const int me = m_transport.rank();
+   const uint64_t sentBefore = m_transport.bytesSent();
+   const uint64_t receivedBefore = m_transport.bytesReceived();
+   m_stats = NodeStats();
+   m_swaps.clear();
+   m_tileSize = tileSize;
+   m_tiles = (n + tileSize - 1) / tileSize;
+
+   const int T = m_tiles;
+   const int b = tileSize;
+   const size_t elems = (size_t)b * b;
+
+   // Scatter: the coordinator cuts out every tile, padding with the identity
+   std::vector<double> tile(elems);
+   for (int i = 0; i < T; i++)
+   {
+      for (int j = 0; j < T; j++)
+      {
+         const int dest = owner(i, j);
+         const int index = i * T + j;
+         if (me == 0)
+         {
+            for (int r = 0; r < b; r++)
+               for (int c = 0; c < b; c++)
+               {
+                  const int gi = i * b + r, gj = j * b + c;
+                  tile[(size_t)r * b + c] = gi < n && gj < n ? A[(size_t)gi * n + gj] : (gi == gj ? 1. : 0.);
+               }
+            if (dest == 0)
+               m_owned[index] = tile;
+            else
+               sendTimed(dest, makeTag(Scatter, 0, index), tile.data(), elems);
+         }
+         else if (dest == me)
+         {
+            std::vector<double> &mine = m_owned[index];
+            mine.resize(elems);
+            receiveTimed(0, makeTag(Scatter, 0, index), mine.data(), elems);
+         }
+      }
+   }
+   m_stats.tiles = (int)m_owned.size();
+
+   const bool ok = sweep() == 0;
+
+   // Gather: every owner returns its tiles to the coordinator
+   if (ok)
+   {
+      for (int i = 0; i < T; i++)
+      {
+         for (int j = 0; j < T; j++)
+         {
+            const int source = owner(i, j);
+            const int index = i * T + j;
+            if (me == 0)
+            {
+               if (source == 0)
+                  tile = m_owned[index];
+               else
+                  receiveTimed(source, makeTag(Gather, 0, index), tile.data(), elems);
+               for (int r = 0; r < b && i * b + r < n; r++)
+                  for (int c = 0; c < b && j * b + c < n; c++)
+                     result[(size_t)(i * b + r) * n + j * b + c] = tile[(size_t)r * b + c];
+            }
+            else if (source == me)
+               sendTimed(0, makeTag(Gather, 0, index), m_owned[index].data(), elems);
+         }
+      }
+      // A^-1 = (P A)^-1 P: the row interchanges in reverse, as column
+      // interchanges. Padding rows are never picked, so all of them are < n
+      if (me == 0)
+         for (size_t s = m_swaps.size(); s-- > 0;)
+            for (int i = 0; i < n; i++)
+               std::swap(result[(size_t)i * n + m_swaps[s].first], result[(size_t)i * n + m_swaps[s].second]);
+   }
+   m_owned.clear();
+
+   m_stats.bytesSent = m_transport.bytesSent() - sentBefore;
+   m_stats.bytesReceived = m_transport.bytesReceived() - receivedBefore;
+   double packed[5] = {m_stats.computeSeconds, m_stats.commSeconds, double(m_stats.bytesSent),
+                       double(m_stats.bytesReceived), double(m_stats.tiles)};
+   if (me == 0)
+   {
+      m_nodeStats.assign(m_transport.size(), NodeStats());
+      m_nodeStats[0] = m_stats;
+      for (int r = 1; r < m_transport.size(); r++)
+      {
+         m_transport.receive(r, makeTag(Stats, 0, 0), packed, 5);
+         m_nodeStats[r] = {packed[0], packed[1], uint64_t(packed[2]), uint64_t(packed[3]), int(packed[4])};
+      }
+   }
+   else
+      m_transport.send(0, makeTag(Stats, 0, 0), packed, 5);
+   return ok;
+}
+
+int DistributedInverter::sweep()
+{
+   const int me = m_transport.rank();
+   const int T = m_tiles;
+   const int b = m_tileSize;
+   const size_t elems = (size_t)b * b;
+
+   // [status, swap count, up to b swapped row pairs, D]
+   const size_t header = 2 + 2 * (size_t)b;
+   std::vector<double> diag(header + elems);
+   std::vector<double> tmp(elems);
+   std::vector<double> panel;
+   std::vector<int> pivots;
+   std::vector<std::pair<int, int>> swaps;
+   std::unordered_map<int, std::vector<double>> columnOld; // By tile row i
+   std::unordered_map<int, std::vector<double>> rowNew;    // By tile column j
+
+   for (int k = 0; k < T; k++)
+   {
+      columnOld.clear();
+      rowNew.clear();
+
+      // Tile column k from the diagonal down goes to the diagonal owner, which
+      // picks the pivot rows from all of it as pivoted Gauss-Jordan does
+      const int diagOwner = owner(k, k);
+      for (int i = k; i < T; i++)
+         if (owner(i, k) == me && me != diagOwner)
+            sendTimed(diagOwner, makeTag(Panel, k, i), m_owned[i * T + k].data(), elems);
+      if (me == diagOwner)
+      {
+         const int rows = (T - k) * b;
+         panel.resize((size_t)rows * b);
+         for (int i = k; i < T; i++)
+         {
+            double *into = panel.data() + (size_t)(i - k) * elems;
+            if (owner(i, k) == me)
+               std::copy(m_owned[i * T + k].begin(), m_owned[i * T + k].end(), into);
+            else
+               receiveTimed(owner(i, k), makeTag(Panel, k, i), into, elems);
+         }
+
+         // D = the inverse of the pivoted diagonal tile, then to every node
+         // with the status and the row swaps in front
+         const Clock::time_point start = Clock::now();
+         int status = MatrixKernels::panelPivots(panel.data(), b, rows, b, pivots);
+         int count = 0;
+         if (status == 0)
+         {
+            for (int c = 0; c < b; c++)
+            {
+               if (pivots[c] == c)
+                  continue;
+               std::swap_ranges(panel.begin() + (size_t)c * b, panel.begin() + (size_t)(c + 1) * b,
+                                panel.begin() + (size_t)pivots[c] * b);
+               diag[2 + 2 * count] = k * b + c;
+               diag[3 + 2 * count] = k * b + pivots[c];
+               count++;
+            }
+            status = MatrixKernels::invertBase(panel.data(), b, b);
+         }
+         m_stats.computeSeconds += secondsSince(start);
+         diag[0] = status;
+         diag[1] = count;
+         std::copy(panel.begin(), panel.begin() + elems, diag.begin() + header);
+         for (int r = 0; r < m_transport.size(); r++)
+            if (r != me)
+               sendTimed(r, makeTag(Diagonal, k, 0), diag.data(), diag.size());
+      }
+      else
+         receiveTimed(diagOwner, makeTag(Diagonal, k, 0), diag.data(), diag.size());
+      if (diag[0] != 0.)
+         return -1;
+
+      swaps.clear();
+      for (int s = 0; s < (int)diag[1]; s++)
+         swaps.emplace_back((int)diag[2 + 2 * s], (int)diag[3 + 2 * s]);
+      swapRows(k, swaps);
+      m_swaps.insert(m_swaps.end(), swaps.begin(), swaps.end());
+      const double *D = diag.data() + header;
+      if (me == diagOwner)
+         std::copy(D, D + elems, m_owned[k * T + k].begin());
+
+      // Column k: old A_ik along the node row, then A_ik <- -A_ik D
+      for (int i = 0; i < T; i++)
+      {
+         if (i == k || owner(i, k) != me)
+            continue;
+         std::vector<double> &Aik = m_owned[i * T + k];
+         columnOld[i] = Aik;
+         for (int c = 0; c < m_gridCols; c++)
+         {
+            const int dest = (i % m_gridRows) * m_gridCols + c;
+            if (dest != me && hasOther(c, m_gridCols, k, T))
+               sendTimed(dest, makeTag(Column, k, i), Aik.data(), elems);
+         }
+         const Clock::time_point start = Clock::now();
+         MatrixKernels::multiplyParallel(0, b, b, b, -1., columnOld[i].data(), b, D, b, 0., Aik.data(), b);
+         m_stats.computeSeconds += secondsSince(start);
+      }
+
+      // Row k: A_kj <- D A_kj, then along the node column
+      for (int j = 0; j < T; j++)
+      {
+         if (j == k || owner(k, j) != me)
+            continue;
+         std::vector<double> &Akj = m_owned[k * T + j];
+         const Clock::time_point start = Clock::now();
+         MatrixKernels::multiplyParallel(0, b, b, b, 1., D, b, Akj.data(), b, 0., tmp.data(), b);
+         std::copy(tmp.begin(), tmp.end(), Akj.begin());
+         m_stats.computeSeconds += secondsSince(start);
+         rowNew[j] = Akj;
+         for (int r = 0; r < m_gridRows; r++)
+         {
+            const int dest = r * m_gridCols + j % m_gridCols;
+            if (dest != me && hasOther(r, m_gridRows, k, T))
+               sendTimed(dest, makeTag(Row, k, j), Akj.data(), elems);
+         }
+      }
+
+      // Trailing update of every owned tile off row and column k
+      for (int i = 0; i < T; i++)
+      {
+         if (i == k)
+            continue;
+         for (int j = 0; j < T; j++)
+         {
+            if (j == k || owner(i, j) != me)
+               continue;
+            if (!columnOld.count(i))
+            {
+               columnOld[i].resize(elems);
+               receiveTimed(owner(i, k), makeTag(Column, k, i), columnOld[i].data(), elems);
+            }
+            if (!rowNew.count(j))
+            {
+               rowNew[j].resize(elems);
+               receiveTimed(owner(k, j), makeTag(Row, k, j), rowNew[j].data(), elems);
+            }
+            const Clock::time_point start = Clock::now();
+            MatrixKernels::multiplyParallel(0, b, b, b, -1., columnOld[i].data(), b, rowNew[j].data(), b, 1.,
+                                            m_owned[i * T + j].data(), b);
+            m_stats.computeSeconds += secondsSince(start);
+         }
+      }
+   }
+   return 0;
+}
+
+void DistributedInverter::swapRows(int k, const std::vector<std::pair<int, int>> &swaps)
+{
+   if (swaps.empty())
+      return;
+   const int me = m_transport.rank();
+   const int T = m_tiles;
+   const int b = m_tileSize;
+
+   // Which original row each touched row holds once the swaps are applied in order
+   std::map<int, int> source;
+   for (const auto &swap : swaps)
+   {
+      source.emplace(swap.first, swap.first);
+      source.emplace(swap.second, swap.second);
+   }
+   for (const auto &swap : swaps)
+      std::swap(source[swap.first], source[swap.second]);
+
+   // Each tile column is moved by the owners of its tiles alone: rows for
+   // another node go out in one message per node, in destination row order
+   std::map<int, std::vector<double>> outgoing, incoming;
+   std::vector<std::pair<double *, std::vector<double>>> staged;
+   for (int j = me % m_gridCols; j < T; j += m_gridCols)
+   {
+      auto row = [&](int global)
+      { return m_owned[(global / b) * T + j].data() + (size_t)(global % b) * b; };
+      outgoing.clear();
+      incoming.clear();
+      for (const auto &move : source)
+      {
+         const int to = owner(move.first / b, j), from = owner(move.second / b, j);
+         if (move.first == move.second || to == from)
+            continue;
+         if (from == me)
+            outgoing[to].insert(outgoing[to].end(), row(move.second), row(move.second) + b);
+         else if (to == me)
+            incoming[from].resize(incoming[from].size() + b);
+      }
+      for (const auto &message : outgoing)
+         sendTimed(message.first, makeTag(Swap, k, j), message.second.data(), message.second.size());
+      for (auto &message : incoming)
+         receiveTimed(message.first, makeTag(Swap, k, j), message.second.data(), message.second.size());
+
+      // Staged before any row is written: a local move may read a row another one replaces
+      staged.clear();
+      std::map<int, size_t> consumed;
+      for (const auto &move : source)
+      {
+         const int to = owner(move.first / b, j), from = owner(move.second / b, j);
+         if (move.first == move.second || to != me)
+            continue;
+         if (from == me)
+            staged.emplace_back(row(move.first), std::vector<double>(row(move.second), row(move.second) + b));
+         else
+         {
+            const double *data = incoming[from].data() + consumed[from];
+            consumed[from] += b;
+            staged.emplace_back(row(move.first), std::vector<double>(data, data + b));
+         }
+      }
+      for (const auto &write : staged)
+         std::copy(write.second.begin(), write.second.end(), write.first);
+   }
+}
+
+void DistributedInverter::printReport() const
+{
+   std::cout << "DistributedInverter: " << m_transport.size() << " nodes as a " << m_gridRows << "x" << m_gridCols
+             << " grid, " << m_tiles << "x" << m_tiles << " tiles of " << m_tileSize << std::endl;
+   for (size_t r = 0; r < m_nodeStats.size(); r++)
+   {
+      const NodeStats &s = m_nodeStats[r];
+      std::cout << "DistributedInverter: Node " << r << ": " << s.tiles << " tiles, compute " << std::fixed
+                << std::setprecision(4) << s.computeSeconds << " s, communication " << s.commSeconds
+                << " s, sent " << std::setprecision(2) << s.bytesSent / 1e6 << " MB, received "
+                << s.bytesReceived / 1e6 << " MB" << std::endl;
+   }
+}
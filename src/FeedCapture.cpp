@@ -0,0 +1,78 @@
+#include "FeedCapture.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace
+{
+   const size_t kBufferBytes = 1 << 20;
+}
+
+FeedCapture::FeedCapture(const std::string &path) : m_path(path)
+{
+   open();
+}
+
+FeedCapture::~FeedCapture()
+{
+   if (m_file)
+      fclose(m_file);
+}
+
+void FeedCapture::open()
+{
+   m_file = fopen(m_path.c_str(), "a");
+   if (!m_file)
+      throw std::runtime_error("FeedCapture: cannot open " + m_path + ": " + strerror(errno));
+   setvbuf(m_file, nullptr, _IOFBF, kBufferBytes);
+}
+
+void FeedCapture::roll()
+{
+   fclose(m_file);
+   m_file = nullptr;
+
+   char suffix[32];
+   const time_t now = time(nullptr);
+   std::tm utc;
+   gmtime_r(&now, &utc);
+   strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &utc);
+   // link() refuses an existing name, so a second roll within the same second gets ".1", ".2", ...
+   const std::string stamped = m_path + suffix;
+   std::string rolled = stamped;
+   int status;
+   for (int n = 1; (status = link(m_path.c_str(), rolled.c_str())) != 0 && errno == EEXIST; n++)
+      rolled = stamped + "." + std::to_string(n);
+   if (status != 0)
+      std::cerr << "FeedCapture: cannot roll " << m_path << " to " << rolled << ": " << strerror(errno) << std::endl;
+   else if (unlink(m_path.c_str()) != 0)
+      std::cerr << "FeedCapture: cannot unlink " << m_path << " after linking " << rolled << ": " << strerror(errno) << std::endl;
+   else
+      std::cout << "FeedCapture: Rolled to " << rolled << std::endl;
+
+   try
+   {
+      open();
+      m_rolls.store(m_rolls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+   }
+   catch (const std::exception &e)
+   {
+      std::cerr << e.what() << "; capture stopped" << std::endl;
+   }
+}
+
+void FeedCapture::record(int64_t receivedNs, const std::string &payload)
+{
+   if (m_rollRequested.load(std::memory_order_relaxed) && m_rollRequested.exchange(false, std::memory_order_acquire) && m_file)
+      roll();
+   if (!m_file)
+      return;
+
+   fprintf(m_file, "%lld ", (long long)receivedNs);
+   fwrite(payload.data(), 1, payload.size(), m_file);
+   fputc('\n', m_file);
+   m_records.store(m_records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
@@ -0,0 +1,271 @@
+#include "KernelTuner.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+   // Best-of-N wall time of fn in seconds
+   template <typename F>
+   double bestOf(int repeats, F &&fn)
+   {
+      double best = 1e300;
+      for (int r = 0; r < repeats; r++)
+      {
+         auto start = std::chrono::steady_clock::now();
+         fn();
+         std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+         best = std::min(best, elapsed.count());
+      }
+      return best;
+   }
+
+   // A local generator: the global rand() sequence belongs to the calculation thread
+   std::vector<double> randomMatrix(int n, unsigned int seed)
+   {
+      std::minstd_rand random(seed);
+      std::vector<double> m((size_t)n * n);
+      for (auto &v : m)
+         v = double(random() % 10000) / double(1000);
+      // Diagonal dominance keeps the inversion samples well conditioned
+      for (int i = 0; i < n; i++)
+         m[(size_t)i * n + i] += 10. * n;
+      return m;
+   }
+
+   // Why a tuning read from a cache cannot be used, or empty if it can
+   std::string rangeError(const MatrixKernels::Tuning &tuning)
+   {
+      if (tuning.gemmBlock < 8 || tuning.gemmBlock > 1024)
+         return "gemm_block must be from 8 to 1024";
+      if (tuning.gemmUnroll != 1 && tuning.gemmUnroll != 2 && tuning.gemmUnroll != 4)
+         return "gemm_unroll must be 1, 2 or 4";
+      if (tuning.gemmThreads < 0 || tuning.gemmThreads > (int)std::max(1u, std::thread::hardware_concurrency()))
+         return "gemm_threads must be from 0 to the core count";
+      if (tuning.recursiveBase < 1 || tuning.recursiveBase > 4096)
+         return "recursive_base must be from 1 to 4096";
+      if (tuning.strassenCrossover < 1)
+         return "strassen_crossover must be positive";
+      return std::string();
+   }
+}
+
+KernelTuner::KernelTuner(int sampleSize) : m_sampleSize(sampleSize < 64 ? 64 : sampleSize)
+{
+}
+
+MatrixKernels::Tuning KernelTuner::tune() const
+{
+   const MatrixKernels::Tuning saved = MatrixKernels::tuning();
+   MatrixKernels::Tuning best = saved;
+   MatrixKernels::Tuning trial = saved;
+   const int n = m_sampleSize;
+
+   std::vector<double> A = randomMatrix(n, 1), B = randomMatrix(n, 2), C((size_t)n * n);
+
+   // GEMM tile edge and k-unroll, single task
+   double bestTime = 1e300;
+   for (int block : {32, 64, 128, 256})
+   {
+      for (int unroll : {1, 2, 4})
+      {
+         trial.gemmBlock = block;
+         trial.gemmUnroll = unroll;
+         MatrixKernels::setTuning(trial);
+         double t = bestOf(3, [&]()
+                           { MatrixKernels::multiply(n, n, n, 1., A.data(), n, B.data(), n, 0., C.data(), n); });
+         if (t < bestTime)
+         {
+            bestTime = t;
+            best.gemmBlock = block;
+            best.gemmUnroll = unroll;
+         }
+      }
+   }
+   trial.gemmBlock = best.gemmBlock;
+   trial.gemmUnroll = best.gemmUnroll;
+
+   // GEMM task count
+   const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+   bestTime = 1e300;
+   for (int threads = 1; threads <= cores; threads *= 2)
+   {
+      trial.gemmThreads = threads;
+      MatrixKernels::setTuning(trial);
+      double t = bestOf(3, [&]()
+                        { MatrixKernels::multiplyParallel(0, n, n, n, 1., A.data(), n, B.data(), n, 0., C.data(), n); });
+      if (t < bestTime)
+      {
+         bestTime = t;
+         best.gemmThreads = threads;
+      }
+   }
+   trial.gemmThreads = best.gemmThreads;
+
+   // Recursive inversion base case
+   bestTime = 1e300;
+   for (int base : {32, 64, 128})
+   {
+      trial.recursiveBase = base;
+      MatrixKernels::setTuning(trial);
+      double t = bestOf(2, [&]()
+                        { C = A; MatrixKernels::invertRecursive(C.data(), n, n); });
+      if (t < bestTime)
+      {
+         bestTime = t;
+         best.recursiveBase = base;
+      }
+   }
+   trial.recursiveBase = best.recursiveBase;
+   MatrixKernels::setTuning(trial);
+
+   // Strassen crossover: the smallest size at which one Strassen level
+   // beats the blocked GEMM.
+   best.strassenCrossover = 1024;
+   for (int size : {256, 512, 1024})
+   {
+      std::vector<double> L = randomMatrix(size, 1), R = randomMatrix(size, 2), P((size_t)size * size);
+      double gemm = bestOf(2, [&]()
+                           { MatrixKernels::multiplyParallel(0, size, size, size, 1., L.data(), size, R.data(), size, 0., P.data(), size); });
+      double strassen = bestOf(2, [&]()
+                               { MatrixKernels::multiplyStrassen(size, L.data(), size, R.data(), size, P.data(), size, size / 2); });
+      if (strassen < gemm)
+      {
+         best.strassenCrossover = size / 2;
+         break;
+      }
+   }
+
+   MatrixKernels::setTuning(saved);
+   return best;
+}
+
+std::string KernelTuner::hostName()
+{
+   char name[256] = {0};
+   if (gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0')
+      return "localhost";
+   return name;
+}
+
+std::string KernelTuner::cpuModel()
+{
+   std::ifstream cpuinfo("/proc/cpuinfo");
+   std::string line;
+   while (std::getline(cpuinfo, line))
+   {
+      if (line.rfind("model name", 0) == 0)
+      {
+         size_t colon = line.find(':');
+         if (colon != std::string::npos)
+            return line.substr(line.find_first_not_of(' ', colon + 1));
+      }
+   }
+   return "unknown";
+}
+
+std::string KernelTuner::cachePath(const std::string &configDir)
+{
+   std::string dir = configDir;
+   if (!dir.empty() && dir.back() != '/')
+      dir += '/';
+   return dir + "tuning-" + hostName() + ".json";
+}
+
+bool KernelTuner::loadCache(const std::string &path, MatrixKernels::Tuning &tuning)
+{
+   std::ifstream file(path);
+   if (!file.is_open())
+      return false;
+
+   try
+   {
+      nlohmann::json cache;
+      file >> cache;
+      if (cache.value("cpu", "") != cpuModel() ||
+          cache.value("cores", 0u) != std::thread::hardware_concurrency() ||
+          cache.value("isa", "") != MatrixKernels::isaName(MatrixKernels::isa()))
+      {
+         std::cerr << "KernelTuner: Ignoring " << path << " recorded on different hardware or kernels" << std::endl;
+         return false;
+      }
+
+      MatrixKernels::Tuning loaded;
+      loaded.gemmBlock = cache.at("gemm_block").get<int>();
+      loaded.gemmUnroll = cache.at("gemm_unroll").get<int>();
+      loaded.gemmThreads = cache.at("gemm_threads").get<int>();
+      loaded.recursiveBase = cache.at("recursive_base").get<int>();
+      loaded.strassenCrossover = cache.at("strassen_crossover").get<int>();
+      const std::string error = rangeError(loaded);
+      if (!error.empty())
+      {
+         std::cerr << "KernelTuner: Ignoring " << path << ": " << error << std::endl;
+         return false;
+      }
+      tuning = loaded;
+   }
+   catch (const nlohmann::json::exception &e)
+   {
+      std::cerr << "KernelTuner: Failed to parse " << path << ": " << e.what() << std::endl;
+      return false;
+   }
+   return true;
+}
+
+void KernelTuner::saveCache(const std::string &path, const MatrixKernels::Tuning &tuning)
+{
+   nlohmann::json cache = {
+       {"host", hostName()},
+       {"cpu", cpuModel()},
+       {"cores", std::thread::hardware_concurrency()},
+       {"isa", MatrixKernels::isaName(MatrixKernels::isa())},
+       {"gemm_block", tuning.gemmBlock},
+       {"gemm_unroll", tuning.gemmUnroll},
+       {"gemm_threads", tuning.gemmThreads},
+       {"recursive_base", tuning.recursiveBase},
+       {"strassen_crossover", tuning.strassenCrossover}};
+
+   std::ofstream file(path);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to write tuning cache: " + path);
+   }
+   file << cache.dump(2) << std::endl;
+}
+
+MatrixKernels::Tuning KernelTuner::loadOrTune(const std::string &configDir, bool allowTuning)
+{
+   const std::string path = cachePath(configDir);
+   MatrixKernels::Tuning tuning;
+   if (loadCache(path, tuning))
+   {
+      std::cout << "KernelTuner: Loaded tuning from " << path << std::endl;
+      return tuning;
+   }
+
+   if (!allowTuning)
+      return MatrixKernels::tuning();
+
+   std::cout << "KernelTuner: Tuning kernels for " << cpuModel() << "..." << std::endl;
+   tuning = KernelTuner().tune();
+   std::cout << "KernelTuner: gemm_block=" << tuning.gemmBlock << " gemm_unroll=" << tuning.gemmUnroll
+             << " gemm_threads=" << tuning.gemmThreads << " recursive_base=" << tuning.recursiveBase
+             << " strassen_crossover=" << tuning.strassenCrossover << std::endl;
+   try
+   {
+      saveCache(path, tuning);
+   }
+   catch (const std::exception &e)
+   {
+      std::cerr << "KernelTuner: " << e.what() << std::endl;
+   }
+   return tuning;
+}
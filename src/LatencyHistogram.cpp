@@ -0,0 +1,61 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+   int bucketOf(uint64_t value)
+   {
+      const int bits = value ? 64 - __builtin_clzll(value) : 0;
+      return bits < LatencyHistogram::kBuckets ? bits : LatencyHistogram::kBuckets - 1;
+   }
+
+   // Single writer: plain load + store instead of a locked add
+   void bump(std::atomic<uint64_t> &counter, uint64_t by)
+   {
+      counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+   }
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+   bump(m_buckets[bucketOf(value)], 1);
+   bump(m_sum, value);
+   if (value > m_max.load(std::memory_order_relaxed))
+      m_max.store(value, std::memory_order_relaxed);
+   bump(m_count, 1);
+}
+
+double LatencyHistogram::mean() const
+{
+   const uint64_t n = count();
+   return n ? double(m_sum.load(std::memory_order_relaxed)) / n : 0.;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const
+{
+   uint64_t total = 0;
+   for (const auto &bucket : m_buckets)
+      total += bucket.load(std::memory_order_relaxed);
+   if (total == 0)
+      return 0;
+
+   const uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+   uint64_t seen = 0;
+   for (int b = 0; b < kBuckets; b++)
+   {
+      seen += m_buckets[b].load(std::memory_order_relaxed);
+      if (seen >= rank)
+         return b == 0 ? 0 : std::min<uint64_t>((uint64_t(1) << b) - 1, max());
+   }
+   return max();
+}
+
+std::string LatencyHistogram::summary(const char *unit) const
+{
+   std::ostringstream out;
+   out << "count " << count() << " mean " << (uint64_t)mean() << " p50 " << percentile(0.5) << " p90 "
+       << percentile(0.9) << " p99 " << percentile(0.99) << " p99.9 " << percentile(0.999) << " max " << max()
+       << " " << unit;
+   return out.str();
+}
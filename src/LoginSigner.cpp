@@ -0,0 +1,88 @@
+#include "LoginSigner.h"
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+
+namespace
+{
+   const char kVerifyRequest[] = "GET/users/self/verify";
+
+   // Credentials are opaque strings; keep a quote or backslash from ending the JSON string
+   void appendEscaped(std::string &out, const std::string &value)
+   {
+      for (const char c : value)
+      {
+         if (c == '"' || c == '\\')
+            out += '\\';
+         out += c;
+      }
+   }
+}
+
+LoginSigner::LoginSigner(const std::string &secret)
+{
+   if (secret.empty())
+      throw std::runtime_error("LoginSigner: empty API secret");
+   EVP_MAC *mac = EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr);
+   if (mac)
+      m_ctx = EVP_MAC_CTX_new(mac);
+   EVP_MAC_free(mac);  // The context keeps its own reference
+
+   char digest[] = "SHA256";
+   const OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0), OSSL_PARAM_construct_end()};
+   if (!m_ctx || EVP_MAC_init(m_ctx, reinterpret_cast<const unsigned char *>(secret.data()), secret.size(), params) != 1)
+   {
+      EVP_MAC_CTX_free(m_ctx);
+      m_ctx = nullptr;
+      throw std::runtime_error("LoginSigner: HMAC-SHA256 unavailable");
+   }
+}
+
+LoginSigner::~LoginSigner()
+{
+   EVP_MAC_CTX_free(m_ctx);
+}
+
+bool LoginSigner::sign(long long timestamp, char (&signature)[kSignatureSize])
+{
+   signature[0] = '\0';
+   char message[32 + sizeof(kVerifyRequest)];
+   const auto digits = std::to_chars(message, message + 32, timestamp);
+   memcpy(digits.ptr, kVerifyRequest, sizeof(kVerifyRequest) - 1);
+   const size_t length = (digits.ptr - message) + sizeof(kVerifyRequest) - 1;
+
+   // A null key re-initializes with the key given to the constructor
+   unsigned char mac[32];
+   size_t macLength = 0;
+   if (EVP_MAC_init(m_ctx, nullptr, 0, nullptr) != 1 ||
+       EVP_MAC_update(m_ctx, reinterpret_cast<const unsigned char *>(message), length) != 1 ||
+       EVP_MAC_final(m_ctx, mac, &macLength, sizeof(mac)) != 1 || macLength != sizeof(mac))
+      return false;
+   EVP_EncodeBlock(reinterpret_cast<unsigned char *>(signature), mac, sizeof(mac));
+   return true;
+}
+
+std::string LoginSigner::loginFrame(const std::string &apiKey, const std::string &passphrase)
+{
+   const long long now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+   char signature[kSignatureSize];
+   if (!sign(now, signature))
+      throw std::runtime_error("LoginSigner: signing failed");
+
+   std::string frame;
+   frame.reserve(96 + apiKey.size() + passphrase.size());
+   frame += R"({"op":"login","args":[{"apiKey":")";
+   appendEscaped(frame, apiKey);
+   frame += R"(","passphrase":")";
+   appendEscaped(frame, passphrase);
+   frame += R"(","timestamp":")";
+   frame += std::to_string(now);
+   frame += R"(","sign":")";
+   frame += signature;
+   frame += R"("}]})";
+   return frame;
+}
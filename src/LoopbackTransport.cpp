@@ -0,0 +1,23 @@
+#include "LoopbackTransport.h"
+
+LoopbackTransport::LoopbackTransport(int rank, int size, std::shared_ptr<std::vector<LoopbackTransport *>> group)
+    : Transport(rank, size), m_group(std::move(group))
+{
+}
+
+std::vector<std::unique_ptr<LoopbackTransport>> LoopbackTransport::createGroup(int size)
+{
+   auto group = std::make_shared<std::vector<LoopbackTransport *>>(size, nullptr);
+   std::vector<std::unique_ptr<LoopbackTransport>> endpoints;
+   for (int rank = 0; rank < size; rank++)
+   {
+      endpoints.emplace_back(new LoopbackTransport(rank, size, group));
+      (*group)[rank] = endpoints.back().get();
+   }
+   return endpoints;
+}
+
+void LoopbackTransport::transmit(int dest, uint64_t tag, const double *data, size_t count)
+{
+   (*m_group)[dest]->deliver(rank(), tag, std::vector<double>(data, data + count));
+}
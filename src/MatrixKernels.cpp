@@ -0,0 +1,755 @@
+#include "MatrixKernels.h"
+#include "PreemptionGate.h"
+#include <cmath>
+#include <future>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATRIX_KERNELS_X86 1
+#endif
+
+#define KERNEL_INLINE inline __attribute__((always_inline))
+
+namespace
+{
+   // c[j] += sum_u a[u] * b[u][j] for j in [from, to), W doubles per vector.
+   // GCC vector extensions keep the width explicit, so each variant uses its
+   // full register width whatever the optimisation level.
+   template <int W, int U>
+   KERNEL_INLINE void rowUpdate(int from, int to, const double *a, const double *const *b, double *__restrict c)
+   {
+      typedef double Vec __attribute__((vector_size(W * sizeof(double))));
+      Vec va[U];
+      for (int u = 0; u < U; u++)
+         va[u] = Vec{} + a[u];
+
+      int j = from;
+      for (; j + W <= to; j += W)
+      {
+         Vec acc, vb;
+         memcpy(&acc, c + j, sizeof(Vec));
+         for (int u = 0; u < U; u++)
+         {
+            memcpy(&vb, b[u] + j, sizeof(Vec));
+            acc += va[u] * vb;
+         }
+         memcpy(c + j, &acc, sizeof(Vec));
+      }
+      for (; j < to; j++)
+      {
+         double sum = c[j];
+         for (int u = 0; u < U; u++)
+            sum += a[u] * b[u][j];
+         c[j] = sum;
+      }
+   }
+
+   // i-k-j order inside each tile keeps the innermost loop unit-stride in
+   // both B and C. Unrolling over k trades fewer passes over the C row for
+   // more live B rows.
+   template <int W>
+   KERNEL_INLINE void gemmBody(int m, int k, int n, double alpha, const double *A, int lda,
+                               const double *B, int ldb, double *C, int ldc, int block, int unroll)
+   {
+      for (int ii = 0; ii < m; ii += block)
+      {
+         const int iEnd = std::min(ii + block, m);
+         for (int kk = 0; kk < k; kk += block)
+         {
+            const int kEnd = std::min(kk + block, k);
+            for (int jj = 0; jj < n; jj += block)
+            {
+               const int jEnd = std::min(jj + block, n);
+               for (int i = ii; i < iEnd; i++)
+               {
+                  double *c = C + i * ldc;
+                  const double *a = A + i * lda;
+                  double scaled[4];
+                  const double *rows[4];
+                  int p = kk;
+                  if (unroll >= 4)
+                  {
+                     for (; p + 3 < kEnd; p += 4)
+                     {
+                        for (int u = 0; u < 4; u++)
+                        {
+                           scaled[u] = alpha * a[p + u];
+                           rows[u] = B + (p + u) * ldb;
+                        }
+                        rowUpdate<W, 4>(jj, jEnd, scaled, rows, c);
+                     }
+                  }
+                  if (unroll >= 2)
+                  {
+                     for (; p + 1 < kEnd; p += 2)
+                     {
+                        for (int u = 0; u < 2; u++)
+                        {
+                           scaled[u] = alpha * a[p + u];
+                           rows[u] = B + (p + u) * ldb;
+                        }
+                        rowUpdate<W, 2>(jj, jEnd, scaled, rows, c);
+                     }
+                  }
+                  for (; p < kEnd; p++)
+                  {
+                     scaled[0] = alpha * a[p];
+                     rows[0] = B + p * ldb;
+                     rowUpdate<W, 1>(jj, jEnd, scaled, rows, c);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   struct KernelTable
+   {
+      void (*gemm)(int m, int k, int n, double alpha, const double *A, int lda,
+                   const double *B, int ldb, double *C, int ldc, int block, int unroll);
+      void (*axpy)(int n, double alpha, const double *x, double *y);
+   };
+
+   // One instance of every kernel body per instruction set; target may be
+   // empty for the baseline.
+#define MATRIX_KERNELS_VARIANT(name, width, target)                                                   \
+   __attribute__((target)) void gemm##name(int m, int k, int n, double alpha, const double *A, int lda, \
+                                           const double *B, int ldb, double *C, int ldc,              \
+                                           int block, int unroll)                                     \
+   {                                                                                                  \
+      gemmBody<width>(m, k, n, alpha, A, lda, B, ldb, C, ldc, block, unroll);                         \
+   }                                                                                                  \
+   __attribute__((target)) void axpy##name(int n, double alpha, const double *x, double *y)          \
+   {                                                                                                  \
+      rowUpdate<width, 1>(0, n, &alpha, &x, y);                                                       \
+   }
+
+   MATRIX_KERNELS_VARIANT(Baseline, 2, )
+#ifdef MATRIX_KERNELS_X86
+   MATRIX_KERNELS_VARIANT(Avx2, 4, target("avx2,fma"))
+   MATRIX_KERNELS_VARIANT(Avx512, 8, target("avx512f"))
+
+   // Indexed by MatrixKernels::Isa
+   const KernelTable kKernels[] = {
+       {gemmBaseline, axpyBaseline},
+       {gemmAvx2, axpyAvx2},
+       {gemmAvx512, axpyAvx512}};
+#else
+   const KernelTable kKernels[] = {
+       {gemmBaseline, axpyBaseline},
+       {gemmBaseline, axpyBaseline},
+       {gemmBaseline, axpyBaseline}};
+#endif
+#undef MATRIX_KERNELS_VARIANT
+
+   // Runs two independent pieces of work, the first on a separate task when
+   // parallel is set.
+   template <typename F1, typename F2>
+   void runPair(bool parallel, F1 &&first, F2 &&second)
+   {
+      if (!parallel)
+      {
+         first();
+         second();
+         return;
+      }
+      auto pending = std::async(std::launch::async, std::forward<F1>(first));
+      second();
+      pending.get();
+   }
+
+   // C = alpha * A * B + beta * C with the rows of C split across two tasks.
+   void multiplySplit(bool parallel, int m, int k, int n, double alpha,
+                      const double *A, int lda, const double *B, int ldb,
+                      double beta, double *C, int ldc)
+   {
+      if (!parallel || m < 2)
+      {
+         MatrixKernels::multiply(m, k, n, alpha, A, lda, B, ldb, beta, C, ldc);
+         return;
+      }
+      int m1 = m / 2;
+      runPair(true,
+              [&]()
+              { MatrixKernels::multiply(m1, k, n, alpha, A, lda, B, ldb, beta, C, ldc); },
+              [&]()
+              { MatrixKernels::multiply(m - m1, k, n, alpha, A + m1 * lda, lda, B, ldb, beta, C + m1 * ldc, ldc); });
+   }
+
+   // C = A + sign * B for h x h blocks
+   void addBlocks(int h, const double *A, int lda, const double *B, int ldb,
+                  double sign, double *C, int ldc)
+   {
+      for (int i = 0; i < h; i++)
+         for (int j = 0; j < h; j++)
+            C[i * ldc + j] = A[i * lda + j] + sign * B[i * ldb + j];
+   }
+
+   void strassenImpl(int n, const double *A, int lda, const double *B, int ldb,
+                     double *C, int ldc, int crossover, int depth)
+   {
+      if (n <= crossover || n < 2)
+      {
+         MatrixKernels::multiply(n, n, n, 1., A, lda, B, ldb, 0., C, ldc);
+         return;
+      }
+
+      if (n % 2)
+      {
+         // Even leading part by Strassen, then the peeled row and column.
+         const int m = n - 1;
+         strassenImpl(m, A, lda, B, ldb, C, ldc, crossover, depth);
+         MatrixKernels::multiply(m, 1, m, 1., A + m, lda, B + m * ldb, ldb, 1., C, ldc);
+         MatrixKernels::multiply(m, n, 1, 1., A, lda, B + m, ldb, 0., C + m, ldc);
+         MatrixKernels::multiply(1, n, n, 1., A + m * lda, lda, B, ldb, 0., C + m * ldc, ldc);
+         return;
+      }
+
+      const int h = n / 2;
+      const size_t hh = (size_t)h * h;
+      const double *A11 = A, *A12 = A + h, *A21 = A + h * lda, *A22 = A + h * lda + h;
+      const double *B11 = B, *B12 = B + h, *B21 = B + h * ldb, *B22 = B + h * ldb + h;
+
+      std::vector<double> M(7 * hh);
+      auto product = [&](int idx, const double *L1, const double *L2, double ls,
+                         const double *R1, const double *R2, double rs)
+      {
+         // M_idx = (L1 + ls * L2) * (R1 + rs * R2); a null second operand means none
+         std::vector<double> left, right;
+         const double *L = L1, *R = R1;
+         int ldl = lda, ldr = ldb;
+         if (L2)
+         {
+            left.resize(hh);
+            addBlocks(h, L1, lda, L2, lda, ls, left.data(), h);
+            L = left.data();
+            ldl = h;
+         }
+         if (R2)
+         {
+            right.resize(hh);
+            addBlocks(h, R1, ldb, R2, ldb, rs, right.data(), h);
+            R = right.data();
+            ldr = h;
+         }
+         strassenImpl(h, L, ldl, R, ldr, M.data() + idx * hh, h, crossover, depth - 1);
+      };
+
+      std::vector<std::function<void()>> products = {
+          [&]() { product(0, A11, A22, 1., B11, B22, 1.); },
+          [&]() { product(1, A21, A22, 1., B11, nullptr, 0.); },
+          [&]() { product(2, A11, nullptr, 0., B12, B22, -1.); },
+          [&]() { product(3, A22, nullptr, 0., B21, B11, -1.); },
+          [&]() { product(4, A11, A12, 1., B22, nullptr, 0.); },
+          [&]() { product(5, A21, A11, -1., B11, B12, 1.); },
+          [&]() { product(6, A12, A22, -1., B21, B22, 1.); }};
+
+      if (depth > 0)
+      {
+         std::vector<std::future<void>> pending;
+         for (size_t p = 1; p < products.size(); p++)
+            pending.push_back(std::async(std::launch::async, products[p]));
+         products[0]();
+         for (auto &task : pending)
+            task.get();
+      }
+      else
+      {
+         for (auto &task : products)
+            task();
+      }
+
+      const double *M1 = M.data(), *M2 = M1 + hh, *M3 = M2 + hh, *M4 = M3 + hh;
+      const double *M5 = M4 + hh, *M6 = M5 + hh, *M7 = M6 + hh;
+      for (int i = 0; i < h; i++)
+      {
+         double *c11 = C + i * ldc, *c12 = c11 + h;
+         double *c21 = C + (i + h) * ldc, *c22 = c21 + h;
+         for (int j = 0; j < h; j++)
+         {
+            const size_t q = (size_t)i * h + j;
+            c11[j] = M1[q] + M4[q] - M5[q] + M7[q];
+            c12[j] = M3[q] + M5[q];
+            c21[j] = M2[q] + M4[q];
+            c22[j] = M1[q] - M2[q] + M3[q] + M6[q];
+         }
+      }
+   }
+
+   // pivoted: the rows are already in partial-pivoting order for the leading
+   // columns, as A11 is once its parent has pivoted
+   int invertRecursiveImpl(double *A, int lda, int n, int baseSize, int depth, bool pivoted, PreemptionGate *gate)
+   {
+      if (n <= baseSize)
+         return MatrixKernels::invertBase(A, lda, n);
+      // Preemption point: once per block, on the thread that drives the recursion
+      if (gate)
+         gate->yieldIfPending();
+
+      const int n1 = n / 2;
+      const int n2 = n - n1;
+      const bool parallel = depth > 0;
+
+      // Block pivoting: invert P A, whose A11 and Schur complement are the
+      // blocks partial pivoting would produce, then A^-1 = (P A)^-1 P
+      std::vector<int> piv;
+      if (!pivoted)
+      {
+         if (MatrixKernels::panelPivots(A, lda, n, n1, piv) != 0)
+            return -1;
+         for (int k = 0; k < n1; k++)
+            if (piv[k] != k)
+               std::swap_ranges(A + (size_t)k * lda, A + (size_t)k * lda + n, A + (size_t)piv[k] * lda);
+      }
+
+      double *A11 = A;
+      double *A12 = A + n1;
+      double *A21 = A + n1 * lda;
+      double *A22 = A + n1 * lda + n1;
+
+      if (invertRecursiveImpl(A11, lda, n1, baseSize, depth - 1, true, gate) != 0)
+         return -1;
+
+      // T12 = A11^-1 * A12, T21 = A21 * A11^-1
+      std::vector<double> T12((size_t)n1 * n2);
+      std::vector<double> T21((size_t)n2 * n1);
+      runPair(parallel,
+              [&]()
+              { MatrixKernels::multiply(n1, n1, n2, 1., A11, lda, A12, lda, 0., T12.data(), n2); },
+              [&]()
+              { MatrixKernels::multiply(n2, n1, n1, 1., A21, lda, A11, lda, 0., T21.data(), n1); });
+
+      // Schur complement S = A22 - A21 * T12, inverted in place
+      multiplySplit(parallel, n2, n1, n2, -1., A21, lda, T12.data(), n2, 1., A22, lda);
+      if (invertRecursiveImpl(A22, lda, n2, baseSize, depth - 1, false, gate) != 0)
+         return -1;
+
+      // A12 = -T12 * S^-1, A21 = -S^-1 * T21
+      runPair(parallel,
+              [&]()
+              { MatrixKernels::multiply(n1, n2, n2, -1., T12.data(), n2, A22, lda, 0., A12, lda); },
+              [&]()
+              { MatrixKernels::multiply(n2, n2, n1, -1., A22, lda, T21.data(), n1, 0., A21, lda); });
+
+      // A11 = A11^-1 + T12 * S^-1 * T21 = A11^-1 - A12 * T21
+      multiplySplit(parallel, n1, n2, n1, -1., A12, lda, T21.data(), n1, 1., A11, lda);
+
+      for (int k = (int)piv.size() - 1; k >= 0; k--)
+         if (piv[k] != k)
+            for (int i = 0; i < n; i++)
+               std::swap(A[(size_t)i * lda + k], A[(size_t)i * lda + piv[k]]);
+      return 0;
+   }
+}
+
+MatrixKernels::Tuning MatrixKernels::s_tuning;
+MatrixKernels::Isa MatrixKernels::s_isa = MatrixKernels::detectIsa();
+thread_local int MatrixKernels::s_threadBudget = 0;
+
+void MatrixKernels::setTuning(const Tuning &tuning)
+{
+   s_tuning = tuning;
+}
+
+void MatrixKernels::setThreadBudget(int threads)
+{
+   s_threadBudget = threads < 0 ? 0 : threads;
+}
+
+MatrixKernels::Isa MatrixKernels::detectIsa()
+{
+#ifdef MATRIX_KERNELS_X86
+   // cpuid, including the XGETBV check that the OS saves the wide registers
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f"))
+      return Isa::AVX512;
+   if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return Isa::AVX2;
+#endif
+   return Isa::Baseline;
+}
+
+MatrixKernels::Isa MatrixKernels::setIsa(Isa isa)
+{
+   const Isa best = detectIsa();
+   s_isa = isa > best ? best : isa;
+   return s_isa;
+}
+
+MatrixKernels::Isa MatrixKernels::isaFromString(const std::string &name)
+{
+   if (name == "baseline")
+      return Isa::Baseline;
+   if (name == "avx2")
+      return Isa::AVX2;
+   if (name == "avx512")
+      return Isa::AVX512;
+   throw std::invalid_argument("Unknown kernel instruction set: " + name);
+}
+
+const char *MatrixKernels::isaName(Isa isa)
+{
+   switch (isa)
+   {
+   case Isa::AVX2:
+      return "avx2";
+   case Isa::AVX512:
+      return "avx512";
+   case Isa::Baseline:
+   default:
+      return "baseline";
+   }
+}
+
+void MatrixKernels::axpy(int n, double alpha, const double *x, double *y)
+{
+   kKernels[(int)s_isa].axpy(n, alpha, x, y);
+}
+
+void MatrixKernels::multiply(int m, int k, int n, double alpha,
+                             const double *A, int lda,
+                             const double *B, int ldb,
+                             double beta, double *C, int ldc)
+{
+   for (int i = 0; i < m; i++)
+   {
+      double *__restrict c = C + i * ldc;
+      if (beta == 0.)
+         std::fill(c, c + n, 0.);
+      else if (beta != 1.)
+         for (int j = 0; j < n; j++)
+            c[j] *= beta;
+   }
+
+   const int block = s_tuning.gemmBlock > 0 ? s_tuning.gemmBlock : 64;
+   kKernels[(int)s_isa].gemm(m, k, n, alpha, A, lda, B, ldb, C, ldc, block, s_tuning.gemmUnroll);
+}
+
+void MatrixKernels::multiplyParallel(int threads, int m, int k, int n, double alpha,
+                                     const double *A, int lda,
+                                     const double *B, int ldb,
+                                     double beta, double *C, int ldc)
+{
+   if (threads <= 0)
+      threads = s_tuning.gemmThreads;
+   if (threads <= 0)
+      threads = (int)std::thread::hardware_concurrency();
+   if (s_threadBudget > 0 && threads > s_threadBudget)
+      threads = s_threadBudget;
+   if (threads > m)
+      threads = m;
+   if (threads <= 1)
+   {
+      multiply(m, k, n, alpha, A, lda, B, ldb, beta, C, ldc);
+      return;
+   }
+
+   std::vector<std::future<void>> pending;
+   const int rows = (m + threads - 1) / threads;
+   for (int first = rows; first < m; first += rows)
+   {
+      const int count = std::min(rows, m - first);
+      pending.push_back(std::async(std::launch::async, [=]()
+                                   { multiply(count, k, n, alpha, A + first * lda, lda, B, ldb, beta, C + first * ldc, ldc); }));
+   }
+   multiply(rows, k, n, alpha, A, lda, B, ldb, beta, C, ldc);
+   for (auto &task : pending)
+      task.get();
+}
+
+void MatrixKernels::multiplyStrassen(int n, const double *A, int lda,
+                                     const double *B, int ldb,
+                                     double *C, int ldc,
+                                     int crossover, int parallelDepth)
+{
+   if (crossover <= 0)
+      crossover = s_tuning.strassenCrossover;
+   // A parallel level runs the seven products side by side
+   if (s_threadBudget > 0 && s_threadBudget < 7)
+      parallelDepth = 0;
+   strassenImpl(n, A, lda, B, ldb, C, ldc, crossover < 1 ? 1 : crossover, parallelDepth);
+}
+
+bool MatrixKernels::multiplyFast(int n, const double *A, int lda,
+                                 const double *B, int ldb,
+                                 double *C, int ldc)
+{
+   if (n < kStrassenThreshold)
+   {
+      multiplyParallel(0, n, n, n, 1., A, lda, B, ldb, 0., C, ldc);
+      return false;
+   }
+
+   multiplyStrassen(n, A, lda, B, ldb, C, ldc);
+
+   // Accuracy guard: compare sampled entries with exact dot products,
+   // relative to the magnitude of the terms that went into them. A local
+   // generator leaves the caller's rand() sequence alone and is safe on pool
+   // workers.
+   std::minstd_rand sampler((unsigned)n);
+   std::uniform_int_distribution<int> index(0, n - 1);
+   for (int s = 0; s < 32; s++)
+   {
+      const int i = index(sampler);
+      const int j = index(sampler);
+      double exact = 0., scale = 0.;
+      for (int p = 0; p < n; p++)
+      {
+         exact += A[i * lda + p] * B[p * ldb + j];
+         scale += fabs(A[i * lda + p] * B[p * ldb + j]);
+      }
+      if (scale > 0. && fabs(C[i * ldc + j] - exact) > kStrassenGuard * scale)
+      {
+         multiplyParallel(0, n, n, n, 1., A, lda, B, ldb, 0., C, ldc);
+         return false;
+      }
+   }
+   return true;
+}
+
+int MatrixKernels::panelPivots(const double *A, int lda, int rows, int cols, std::vector<int> &pivots)
+{
+   // Eliminated on a copy, so A keeps its original rows
+   std::vector<double> P((size_t)rows * cols);
+   for (int i = 0; i < rows; i++)
+      std::copy(A + (size_t)i * lda, A + (size_t)i * lda + cols, P.begin() + (size_t)i * cols);
+
+   pivots.resize(cols);
+   for (int k = 0; k < cols; k++)
+   {
+      int max_row = k;
+      for (int i = k + 1; i < rows; i++)
+         if (fabs(P[(size_t)i * cols + k]) > fabs(P[(size_t)max_row * cols + k]))
+            max_row = i;
+      if (fabs(P[(size_t)max_row * cols + k]) < 1.e-20)
+         return -1;
+
+      pivots[k] = max_row;
+      if (max_row != k)
+         std::swap_ranges(P.begin() + (size_t)k * cols, P.begin() + (size_t)(k + 1) * cols, P.begin() + (size_t)max_row * cols);
+      const double *pivotRow = P.data() + (size_t)k * cols;
+      for (int i = k + 1; i < rows; i++)
+      {
+         double *row = P.data() + (size_t)i * cols;
+         axpy(cols - k - 1, -row[k] / pivotRow[k], pivotRow + k + 1, row + k + 1);
+      }
+   }
+   return 0;
+}
+
+int MatrixKernels::invertBase(double *A, int lda, int n)
+{
+   std::vector<int> perm(n);
+   int i, j, k, max_row;
+   double temp, max_element;
+
+   for (k = 0; k < n; k++)
+   {
+      max_element = fabs(A[k * lda + k]);
+      max_row = k;
+      for (i = k + 1; i < n; i++)
+      {
+         if (max_element < fabs(A[i * lda + k]))
+         {
+            max_element = fabs(A[i * lda + k]);
+            max_row = i;
+         }
+      }
+
+      if (max_element < 1.e-20)
+         return -1;
+
+      perm[k] = max_row;
+      if (max_row != k)
+         for (j = 0; j < n; j++)
+            std::swap(A[k * lda + j], A[max_row * lda + j]);
+
+      temp = 1. / A[k * lda + k];
+      A[k * lda + k] = 1.;
+      for (j = 0; j < n; j++)
+         A[k * lda + j] *= temp;
+
+      for (i = 0; i < n; i++)
+      {
+         if (i == k)
+            continue;
+         temp = A[i * lda + k];
+         A[i * lda + k] = 0.;
+         axpy(n, -temp, A + k * lda, A + i * lda);
+      }
+   }
+
+   for (k = n - 1; k >= 0; k--)
+      if (perm[k] != k)
+         for (i = 0; i < n; i++)
+            std::swap(A[i * lda + k], A[i * lda + perm[k]]);
+   return 0;
+}
+
+int MatrixKernels::solve(double *A, int n, double *B, int nrhs)
+{
+   int i, j, k, max_row;
+   double temp, max_element;
+
+   for (k = 0; k < n; k++)
+   {
+      max_element = fabs(A[k * n + k]);
+      max_row = k;
+      for (i = k + 1; i < n; i++)
+      {
+         if (max_element < fabs(A[i * n + k]))
+         {
+            max_element = fabs(A[i * n + k]);
+            max_row = i;
+         }
+      }
+
+      if (max_element < 1.e-20)
+         return -1;
+
+      if (max_row != k)
+      {
+         for (j = k; j < n; j++)
+            std::swap(A[k * n + j], A[max_row * n + j]);
+         for (j = 0; j < nrhs; j++)
+            std::swap(B[k * nrhs + j], B[max_row * nrhs + j]);
+      }
+
+      for (i = k + 1; i < n; i++)
+      {
+         temp = A[i * n + k] / A[k * n + k];
+         axpy(n - k - 1, -temp, A + k * n + k + 1, A + i * n + k + 1);
+         axpy(nrhs, -temp, B + k * nrhs, B + i * nrhs);
+      }
+   }
+
+   for (k = n - 1; k >= 0; k--)
+   {
+      for (j = 0; j < nrhs; j++)
+      {
+         temp = B[k * nrhs + j];
+         for (i = k + 1; i < n; i++)
+            temp -= A[k * n + i] * B[i * nrhs + j];
+         B[k * nrhs + j] = temp / A[k * n + k];
+      }
+   }
+   return 0;
+}
+
+int MatrixKernels::invertRecursive(double *A, int lda, int n, int baseSize, int parallelDepth, PreemptionGate *gate)
+{
+   if (baseSize <= 0)
+      baseSize = s_tuning.recursiveBase;
+   // Each parallel level doubles the tasks in flight
+   if (s_threadBudget > 0)
+      for (int depth = 0; depth < parallelDepth; depth++)
+         if ((2 << depth) > s_threadBudget)
+            parallelDepth = depth;
+   return invertRecursiveImpl(A, lda, n, baseSize < 1 ? 1 : baseSize, parallelDepth, false, gate);
+}
+
+int MatrixKernels::invertNewtonSchulz(const double *A, int n, double *X, bool warmStart,
+                                      double tolerance, int maxIterations,
+                                      NewtonSchulzStats *stats, PreemptionGate *gate)
+{
+   const size_t nn = (size_t)n * n;
+   std::vector<double> R(nn), next(nn);
+   double *cur = X;
+   double *nxt = next.data();
+
+   // R = I - A * X, returns ||R||_F
+   auto residual = [&](const double *guess)
+   {
+      multiplyFast(n, A, n, guess, n, R.data(), n);
+      double norma = 0.;
+      for (int i = 0; i < n; i++)
+      {
+         for (int j = 0; j < n; j++)
+         {
+            double &r = R[(size_t)i * n + j];
+            r = (i == j ? 1. : 0.) - r;
+            norma += r * r;
+         }
+      }
+      return sqrt(norma);
+   };
+
+   double r = warmStart ? residual(cur) : 0.;
+   const bool warmUsable = warmStart && r < 1.;
+   if (!warmUsable)
+   {
+      // X0 = A^T / (||A||_1 * ||A||_inf) guarantees ||I - A X0||_2 < 1
+      double norm1 = 0., normInf = 0.;
+      for (int j = 0; j < n; j++)
+      {
+         double col = 0.;
+         for (int i = 0; i < n; i++)
+            col += fabs(A[(size_t)i * n + j]);
+         norm1 = std::max(norm1, col);
+      }
+      for (int i = 0; i < n; i++)
+      {
+         double row = 0.;
+         for (int j = 0; j < n; j++)
+            row += fabs(A[(size_t)i * n + j]);
+         normInf = std::max(normInf, row);
+      }
+      const double scale = 1. / (norm1 * normInf);
+      for (int i = 0; i < n; i++)
+         for (int j = 0; j < n; j++)
+            cur[(size_t)i * n + j] = scale * A[(size_t)j * n + i];
+      r = residual(cur);
+   }
+
+   int iterations = 0;
+   double previous = r;
+   int status = -1;
+   while (true)
+   {
+      if (r <= tolerance)
+      {
+         status = 0;
+         break;
+      }
+      // Stalled at the rounding floor above the tolerance: the caller decides
+      // whether the iterate is good enough or a direct engine should take over
+      if (iterations > 0 && r < 1. && r >= previous)
+      {
+         status = -2;
+         break;
+      }
+      if (iterations >= maxIterations)
+         break;
+
+      if (gate)
+         gate->yieldIfPending();
+
+      // X_next = X + X * (I - A X)
+      multiplyFast(n, cur, n, R.data(), n, nxt, n);
+      for (size_t q = 0; q < nn; q++)
+         nxt[q] += cur[q];
+      std::swap(cur, nxt);
+      iterations++;
+
+      previous = r;
+      r = residual(cur);
+   }
+
+   if (cur != X)
+      std::copy(cur, cur + nn, X);
+
+   if (stats)
+   {
+      stats->iterations = iterations;
+      stats->residual = r;
+      stats->warmStarted = warmUsable;
+   }
+   return status;
+}
@@ -0,0 +1,384 @@
+#include "OrderGateway.h"
+#include "PrivateChannel.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+   // Slot widths include the quotes
+   const size_t kSideWidth = 6;       // "sell"
+   const size_t kNumberWidth = 26;    // Prices and sizes, fixed point
+   const size_t kClientIdWidth = 34;  // OKX client order ids: up to 32 alphanumerics
+   const size_t kMaxPrefix = 8;
+
+   long long nowNs()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+   }
+
+   void fillSlot(char *frame, size_t offset, size_t width, const char *value, size_t length)
+   {
+      char *at = frame + offset;
+      at[0] = '"';
+      memcpy(at + 1, value, length);
+      at[length + 1] = '"';
+      memset(at + length + 2, ' ', width - length - 2);
+   }
+
+   // value rounded to decimals places, without exponent or locale; 0 if it does not fit
+   size_t formatDecimal(char *out, size_t capacity, double value, int decimals)
+   {
+      static const double kScale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12};
+      const double scaled = value * kScale[decimals];
+      if (!(scaled >= 0) || scaled >= 1e17)
+         return 0;
+      char digits[24];
+      const long long units = std::llround(scaled);
+      size_t count = std::to_chars(digits, digits + sizeof(digits), units).ptr - digits;
+      const size_t whole = count > (size_t)decimals ? count - decimals : 0;
+      const size_t length = (whole ? whole : 1) + (decimals ? decimals + 1 : 0);
+      if (length > capacity)
+         return 0;
+
+      char *at = out;
+      if (whole)
+      {
+         memcpy(at, digits, whole);
+         at += whole;
+      }
+      else
+         *at++ = '0';
+      if (decimals)
+      {
+         *at++ = '.';
+         // Leading zeros of the fraction, then its digits
+         const size_t fraction = count - whole;
+         memset(at, '0', decimals - fraction);
+         memcpy(at + decimals - fraction, digits + whole, fraction);
+      }
+      return length;
+   }
+}
+
+OrderGateway::OrderGateway(PrivateChannel &channel, const ConfigManager::OrdersConfig &config)
+    : m_channel(channel), m_config(config)
+{
+   const std::string &prefix = m_config.client_id_prefix;
+   if (prefix.size() > kMaxPrefix || prefix.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789") != std::string::npos)
+      throw std::invalid_argument("OrderGateway: client_id_prefix must be up to 8 letters or digits");
+   m_config.batch_limit = std::max(1, std::min(m_config.batch_limit, kMaxBatch));
+   size_t longest = 0;
+   for (const Op op : {Op::Place, Op::Amend, Op::Cancel})
+   {
+      m_templates[(int)op] = buildTemplate(op);
+      longest = std::max(longest, m_templates[(int)op].args.size());
+   }
+   m_batch.args.reserve(kMaxBatch * (longest + 1));
+   m_frame.reserve(m_batch.args.capacity() + 64);
+   // Start from the clock so a restarted process does not reuse the previous run's ids
+   m_nextClientId = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count() * 1000;
+}
+
+const char *OrderGateway::opName(Op op, bool batch)
+{
+   switch (op)
+   {
+   case Op::Place:
+      return batch ? "batch-orders" : "order";
+   case Op::Amend:
+      return batch ? "batch-amend-orders" : "amend-order";
+   case Op::Cancel:
+      return batch ? "batch-cancel-orders" : "cancel-order";
+   }
+   return "";
+}
+
+OrderGateway::Template OrderGateway::buildTemplate(Op op) const
+{
+   Template frame;
+   auto slot = [&frame](Slot &into, size_t width)
+   {
+      into.offset = frame.args.size();
+      into.width = width;
+      frame.args.append(width, ' ');
+   };
+   // Settings are quoted through the JSON library once, here; slots are patched later
+   auto quoted = [](const std::string &value)
+   { return nlohmann::json(value).dump(); };
+
+   frame.args = R"({"instId":)" + quoted(m_config.inst_id);
+   if (op == Op::Place)
+   {
+      frame.args += R"(,"tdMode":)" + quoted(m_config.td_mode) + R"(,"ordType":)" + quoted(m_config.ord_type) + R"(,"side":)";
+      slot(frame.side, kSideWidth);
+   }
+   if (op != Op::Cancel)
+   {
+      frame.args += op == Op::Place ? R"(,"px":)" : R"(,"newPx":)";
+      slot(frame.price, kNumberWidth);
+      frame.args += op == Op::Place ? R"(,"sz":)" : R"(,"newSz":)";
+      slot(frame.size, kNumberWidth);
+   }
+   frame.args += R"(,"clOrdId":)";
+   slot(frame.clientId, kClientIdWidth);
+   frame.args += "}";
+   return frame;
+}
+
+char *OrderGateway::writeClientId(char *out, uint64_t clientId) const
+{
+   const std::string &prefix = m_config.client_id_prefix;
+   memcpy(out, prefix.data(), prefix.size());
+   return std::to_chars(out + prefix.size(), out + prefix.size() + 20, clientId).ptr;
+}
+
+uint64_t OrderGateway::parseClientId(const std::string &text) const
+{
+   const std::string &prefix = m_config.client_id_prefix;
+   if (text.size() <= prefix.size() || text.compare(0, prefix.size(), prefix) != 0)
+      return 0;
+   uint64_t clientId = 0;
+   const auto parsed = std::from_chars(text.data() + prefix.size(), text.data() + text.size(), clientId);
+   return parsed.ec == std::errc() && parsed.ptr == text.data() + text.size() ? clientId : 0;
+}
+
+bool OrderGateway::submit(Op op, uint64_t clientId, Side side, double price, double size,
+                          std::chrono::steady_clock::time_point tick)
+{
+   const Template &args = m_templates[(int)op];
+   char px[kNumberWidth], sz[kNumberWidth];
+   size_t pxLength = 0, szLength = 0;
+   if (args.price.width)
+   {
+      pxLength = formatDecimal(px, kNumberWidth - 2, price, m_config.px_decimals);
+      szLength = formatDecimal(sz, kNumberWidth - 2, size, m_config.sz_decimals);
+      if (!pxLength || !szLength)
+         return false;
+   }
+
+   bool sent = true;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_channel.loggedIn())
+         return false;
+      // Another kind of operation goes out after what is queued
+      if (m_batch.count && m_batch.op != op)
+         sendBatchLocked();
+
+      if (m_batch.count)
+         m_batch.args += ',';
+      const size_t start = m_batch.args.size();
+      m_batch.args += args.args;  // Within the reserved capacity: no allocation
+      char *out = &m_batch.args[start];
+      if (args.price.width)
+      {
+         fillSlot(out, args.price.offset, args.price.width, px, pxLength);
+         fillSlot(out, args.size.offset, args.size.width, sz, szLength);
+      }
+      if (args.side.width && side == Side::Buy)
+         fillSlot(out, args.side.offset, args.side.width, "buy", 3);
+      else if (args.side.width)
+         fillSlot(out, args.side.offset, args.side.width, "sell", 4);
+      char value[40];
+      fillSlot(out, args.clientId.offset, args.clientId.width, value, writeClientId(value, clientId) - value);
+
+      if (!m_batch.count)
+      {
+         m_batch.op = op;
+         m_batch.opened = std::chrono::steady_clock::now();
+      }
+      if (m_onSubmit)
+         m_onSubmit({op, clientId, side, price, size});
+      m_batch.clientIds[m_batch.count] = clientId;
+      m_batch.ticks[m_batch.count] = tick;
+      m_batch.count++;
+      if (m_config.batch_window_us == 0 || m_batch.count >= m_config.batch_limit)
+         sent = sendBatchLocked();
+      else if (m_batch.count == 1)
+         m_wake.notify_one();
+   }
+   return sent;
+}
+
+bool OrderGateway::sendBatchLocked()
+{
+   if (!m_batch.count)
+      return true;
+   const int count = m_batch.count;
+   const uint64_t requestId = m_nextRequestId++;
+   char digits[24];
+   m_frame.assign(R"({"id":")");
+   m_frame.append(digits, std::to_chars(digits, digits + sizeof(digits), requestId).ptr - digits);
+   m_frame += R"(","op":")";
+   m_frame += opName(m_batch.op, count > 1);
+   m_frame += R"(","args":[)";
+   m_frame += m_batch.args;
+   m_frame += "]}";
+
+   InFlight &inFlight = m_inFlight[requestId % kInFlight];
+   inFlight.op = m_batch.op;
+   inFlight.count = count;
+   std::copy(m_batch.clientIds, m_batch.clientIds + count, inFlight.clientIds);
+   inFlight.sentNs.store(nowNs(), std::memory_order_release);
+   const bool sent = m_channel.send(m_frame);
+   if (sent)
+   {
+      const auto now = std::chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
+         if (m_batch.ticks[i] != std::chrono::steady_clock::time_point())
+            m_tickToOrder.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_batch.ticks[i]).count());
+      m_batchSizes.record(count);
+      m_sent += count;
+      m_frames++;
+   }
+   else
+   {
+      inFlight.sentNs.store(0, std::memory_order_relaxed);
+      // Reported under the lock that refused them, so nothing has to be stored
+      Ack ack;
+      ack.op = m_batch.op;
+      ack.batchSize = count;
+      ack.message = "not sent";
+      for (int i = 0; i < count; i++)
+      {
+         ack.clientId = m_batch.clientIds[i];
+         deliver(ack);
+      }
+   }
+   m_batch.count = 0;
+   m_batch.args.clear();
+   return sent;
+}
+
+void OrderGateway::deliver(const Ack &ack)
+{
+   (ack.accepted ? m_accepted : m_rejected)++;
+   if (m_onAck)
+      m_onAck(ack);
+}
+
+uint64_t OrderGateway::placeOrder(Side side, double price, double size, std::chrono::steady_clock::time_point tick)
+{
+   uint64_t clientId;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      clientId = m_nextClientId++;
+   }
+   return submit(Op::Place, clientId, side, price, size, tick) ? clientId : 0;
+}
+
+bool OrderGateway::amendOrder(uint64_t clientId, double price, double size, std::chrono::steady_clock::time_point tick)
+{
+   return submit(Op::Amend, clientId, Side::Buy, price, size, tick);
+}
+
+bool OrderGateway::cancelOrder(uint64_t clientId, std::chrono::steady_clock::time_point tick)
+{
+   return submit(Op::Cancel, clientId, Side::Buy, 0, 0, tick);
+}
+
+void OrderGateway::flush()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   sendBatchLocked();
+}
+
+void OrderGateway::run(std::atomic<bool> &flag)
+{
+   const auto window = std::chrono::microseconds(m_config.batch_window_us);
+   std::unique_lock<std::mutex> lock(m_mutex);
+   while (!flag)
+   {
+      if (!m_batch.count)
+      {
+         m_wake.wait_for(lock, std::chrono::milliseconds(50));
+         continue;
+      }
+      const auto due = m_batch.opened + window;
+      if (std::chrono::steady_clock::now() < due)
+      {
+         m_wake.wait_until(lock, due);
+         continue;
+      }
+      sendBatchLocked();
+   }
+   lock.unlock();
+   flush();
+}
+
+bool OrderGateway::onMessage(const std::string &payload)
+{
+   // Order replies lead with the id we sent; everything else belongs to other handlers
+   if (payload.compare(0, 6, R"({"id":)") != 0)
+      return false;
+   const nlohmann::json reply = nlohmann::json::parse(payload, nullptr, false);
+   if (!reply.is_object())
+      return false;
+
+   const std::string op = reply.value("op", "");
+   Ack ack;
+   bool known = false;
+   for (const Op candidate : {Op::Place, Op::Amend, Op::Cancel})
+      if (op == opName(candidate) || op == opName(candidate, true))
+      {
+         ack.op = candidate;
+         known = true;
+      }
+   if (!known)
+      return false;
+   const std::string id = reply.value("id", "");
+   std::from_chars(id.data(), id.data() + id.size(), ack.requestId);
+
+   // What was sent under this id; the slot is freed so a repeated reply is not counted twice
+   int count = 0;
+   uint64_t clientIds[kMaxBatch];
+   if (ack.requestId)
+   {
+      InFlight &inFlight = m_inFlight[ack.requestId % kInFlight];
+      const long long sentNs = inFlight.sentNs.exchange(0, std::memory_order_acquire);
+      if (sentNs)
+      {
+         count = inFlight.count;
+         std::copy(inFlight.clientIds, inFlight.clientIds + count, clientIds);
+         m_ackLatency.record((nowNs() - sentNs) / 1000);
+      }
+   }
+
+   const auto data = reply.find("data");
+   if (data == reply.end() || !data->is_array() || data->empty())
+   {
+      // Rejected as a whole: every operation in the request gets the request's code
+      ack.code = reply.value("code", "");
+      ack.message = reply.value("msg", "");
+      ack.accepted = ack.code == "0";
+      ack.batchSize = std::max(count, 1);
+      for (int i = 0; i < ack.batchSize; i++)
+      {
+         ack.clientId = count ? clientIds[i] : 0;
+         deliver(ack);
+      }
+      return true;
+   }
+   ack.batchSize = count ? count : (int)data->size();
+   for (size_t i = 0; i < data->size(); i++)
+   {
+      const auto &result = (*data)[i];
+      if (!result.is_object())
+         continue;
+      // Results come in request order; clOrdId decides when present
+      ack.clientId = parseClientId(result.value("clOrdId", ""));
+      if (!ack.clientId && i < (size_t)count)
+         ack.clientId = clientIds[i];
+      ack.code = result.value("sCode", "");
+      ack.message = result.value("sMsg", "");
+      ack.orderId = result.value("ordId", "");
+      ack.accepted = ack.code == "0";
+      deliver(ack);
+   }
+   return true;
+}
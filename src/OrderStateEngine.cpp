@@ -0,0 +1,320 @@
+#include "OrderStateEngine.h"
+#include <charconv>
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+   uint8_t bit(OrderGateway::Op op)
+   {
+      return (uint8_t)(1u << (int)op);
+   }
+
+   double number(const nlohmann::json &entry, const char *field)
+   {
+      const auto value = entry.find(field);
+      return value != entry.end() && value->is_string() ? std::strtod(value->get_ref<const std::string &>().c_str(), nullptr) : 0;
+   }
+
+   bool resting(OrderStateEngine::State state)
+   {
+      return state == OrderStateEngine::State::Live || state == OrderStateEngine::State::PartiallyFilled;
+   }
+}
+
+OrderStateEngine::OrderStateEngine(size_t maxOpen, const std::string &clientIdPrefix)
+    : m_maxOpen(maxOpen), m_prefix(clientIdPrefix)
+{
+   // At most half full, so probe runs stay short
+   size_t capacity = 16;
+   m_shift = 60;
+   while (capacity < 2 * maxOpen)
+   {
+      capacity *= 2;
+      m_shift--;
+   }
+   m_slots.resize(capacity);
+   m_mask = capacity - 1;
+}
+
+size_t OrderStateEngine::home(uint64_t clientId) const
+{
+   // Client ids are consecutive; the multiply spreads them over the table
+   return (size_t)((clientId * 0x9E3779B97F4A7C15ull) >> m_shift);
+}
+
+OrderStateEngine::Order *OrderStateEngine::findLocked(uint64_t clientId)
+{
+   if (!clientId)
+      return nullptr;
+   for (size_t i = home(clientId);; i = (i + 1) & m_mask)
+   {
+      if (m_slots[i].clientId == clientId)
+         return &m_slots[i];
+      if (m_slots[i].clientId == 0)
+         return nullptr;
+   }
+}
+
+OrderStateEngine::Order *OrderStateEngine::insertLocked(uint64_t clientId)
+{
+   size_t i = home(clientId);
+   while (m_slots[i].clientId != 0)
+      i = (i + 1) & m_mask;
+   m_slots[i] = Order();
+   m_slots[i].clientId = clientId;
+   m_size++;
+   return &m_slots[i];
+}
+
+void OrderStateEngine::eraseLocked(Order *order)
+{
+   // Backward shift: pull later entries of the run into the hole unless that
+   // would move them before their home slot, so lookups never need tombstones
+   size_t hole = order - m_slots.data();
+   for (size_t next = (hole + 1) & m_mask; m_slots[next].clientId != 0; next = (next + 1) & m_mask)
+   {
+      const size_t want = home(m_slots[next].clientId);
+      const bool stays = hole <= next ? (hole < want && want <= next) : (hole < want || want <= next);
+      if (stays)
+         continue;
+      m_slots[hole] = m_slots[next];
+      hole = next;
+   }
+   m_slots[hole] = Order();
+   m_size--;
+}
+
+void OrderStateEngine::finishLocked(Order *order, State state)
+{
+   if (state == State::Filled)
+      m_counters.filled++;
+   else if (state == State::Canceled)
+      m_counters.canceled++;
+   else
+      m_counters.rejected++;
+   eraseLocked(order);
+}
+
+void OrderStateEngine::onSubmit(const OrderGateway::Submit &submit)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if (submit.op == OrderGateway::Op::Place)
+   {
+      if (findLocked(submit.clientId))
+      {
+         m_counters.duplicates++;
+         return;
+      }
+      if (m_size >= m_maxOpen)
+      {
+         m_counters.tableFull++;
+         return;
+      }
+      Order *order = insertLocked(submit.clientId);
+      order->side = submit.side;
+      order->price = submit.price;
+      order->size = submit.size;
+      order->awaiting = bit(submit.op);
+      order->requested = std::chrono::steady_clock::now();
+      m_counters.inserted++;
+      return;
+   }
+
+   // Not ours to track: its ack will count as unknown
+   Order *order = findLocked(submit.clientId);
+   if (!order)
+      return;
+   order->awaiting |= bit(submit.op);
+   order->requested = std::chrono::steady_clock::now();
+   if (resting(order->state))
+      order->resting = order->state;
+   if (submit.op == OrderGateway::Op::Cancel && order->state != State::PendingNew)
+      order->state = State::PendingCancel;
+   else if (submit.op == OrderGateway::Op::Amend && resting(order->state))
+      order->state = State::PendingAmend;
+}
+
+void OrderStateEngine::onAck(const OrderGateway::Ack &ack)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   Order *order = findLocked(ack.clientId);
+   if (!order)
+   {
+      m_counters.unknownAcks++;
+      return;
+   }
+   if (!(order->awaiting & bit(ack.op)))
+   {
+      m_counters.staleAcks++;
+      return;
+   }
+   order->awaiting &= ~bit(ack.op);
+
+   switch (ack.op)
+   {
+   case OrderGateway::Op::Place:
+      if (ack.accepted)
+      {
+         std::from_chars(ack.orderId.data(), ack.orderId.data() + ack.orderId.size(), order->orderId);
+         if (order->state == State::PendingNew)
+            order->state = State::Live;
+      }
+      else if (order->state == State::PendingNew)
+         finishLocked(order, State::Rejected);
+      break;
+   case OrderGateway::Op::Amend:
+      // Accepted or not, the new price and size arrive on the channel
+      if (order->state == State::PendingAmend)
+         order->state = order->resting;
+      break;
+   case OrderGateway::Op::Cancel:
+      // An accepted cancel completes when the channel reports the order canceled
+      if (!ack.accepted && order->state == State::PendingCancel)
+         order->state = order->awaiting & bit(OrderGateway::Op::Amend) ? State::PendingAmend : order->resting;
+      break;
+   }
+}
+
+void OrderStateEngine::onLogin(std::chrono::steady_clock::time_point loginSent)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   // Erasing shifts a later entry into slot i, so i only advances past a kept slot
+   for (size_t i = 0; i < m_slots.size();)
+   {
+      Order &order = m_slots[i];
+      if (!order.clientId || !order.awaiting || order.requested >= loginSent)
+      {
+         i++;
+         continue;
+      }
+      for (uint8_t pending = order.awaiting; pending; pending &= pending - 1)
+         m_counters.expiredRequests++;
+      order.awaiting = 0;
+      if (order.state == State::PendingNew)
+      {
+         m_counters.expired++;
+         eraseLocked(&order);
+         continue;
+      }
+      if (order.state == State::PendingAmend || order.state == State::PendingCancel)
+         order.state = order.resting;
+      i++;
+   }
+}
+
+const char *OrderStateEngine::subscribeFrame()
+{
+   return R"({"op":"subscribe","args":[{"channel":"orders","instType":"ANY"}]})";
+}
+
+bool OrderStateEngine::onMessage(const std::string &payload)
+{
+   static const std::string kPrefix = R"({"arg":{"channel":"orders")";
+   if (payload.compare(0, kPrefix.size(), kPrefix) != 0)
+      return false;
+   const nlohmann::json message = nlohmann::json::parse(payload, nullptr, false);
+   const auto data = message.is_object() ? message.find("data") : message.end();
+   if (!message.is_object() || data == message.end() || !data->is_array())
+      return true;
+
+   for (const auto &entry : *data)
+   {
+      if (!entry.is_object())
+         continue;
+      const std::string clOrdId = entry.value("clOrdId", "");
+      uint64_t clientId = 0;
+      if (clOrdId.size() > m_prefix.size() && clOrdId.compare(0, m_prefix.size(), m_prefix) == 0)
+         std::from_chars(clOrdId.data() + m_prefix.size(), clOrdId.data() + clOrdId.size(), clientId);
+      const std::string state = entry.value("state", "");
+      const long long updateMs = std::atoll(entry.value("uTime", "0").c_str());
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      Order *order = findLocked(clientId);
+      if (!order)
+      {
+         m_counters.unknownUpdates++;
+         continue;
+      }
+      if (updateMs < order->updateMs)
+      {
+         m_counters.staleUpdates++;
+         continue;
+      }
+      order->updateMs = updateMs;
+      const std::string ordId = entry.value("ordId", "");
+      std::from_chars(ordId.data(), ordId.data() + ordId.size(), order->orderId);
+      order->price = number(entry, "px");
+      order->size = number(entry, "sz");
+      order->filled = number(entry, "accFillSz");
+
+      if (state == "filled")
+         finishLocked(order, State::Filled);
+      else if (state == "canceled" || state == "mmp_canceled")
+         finishLocked(order, State::Canceled);
+      else if (state == "live" || state == "partially_filled")
+      {
+         // A pending amend or cancel stays pending; it returns to this state if it fails
+         order->resting = state == "live" ? State::Live : State::PartiallyFilled;
+         if (order->state == State::PendingNew || resting(order->state))
+            order->state = order->resting;
+      }
+   }
+   return true;
+}
+
+bool OrderStateEngine::find(uint64_t clientId, Order &order) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   const Order *found = const_cast<OrderStateEngine *>(this)->findLocked(clientId);
+   if (found)
+      order = *found;
+   return found != nullptr;
+}
+
+size_t OrderStateEngine::openOrders() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_size;
+}
+
+std::vector<OrderStateEngine::Order> OrderStateEngine::orders() const
+{
+   std::vector<Order> open;
+   std::lock_guard<std::mutex> lock(m_mutex);
+   open.reserve(m_size);
+   for (const auto &slot : m_slots)
+      if (slot.clientId)
+         open.push_back(slot);
+   return open;
+}
+
+OrderStateEngine::Counters OrderStateEngine::counters() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_counters;
+}
+
+const char *OrderStateEngine::stateName(State state)
+{
+   switch (state)
+   {
+   case State::PendingNew:
+      return "pending_new";
+   case State::Live:
+      return "live";
+   case State::PartiallyFilled:
+      return "partially_filled";
+   case State::PendingAmend:
+      return "pending_amend";
+   case State::PendingCancel:
+      return "pending_cancel";
+   case State::Filled:
+      return "filled";
+   case State::Canceled:
+      return "canceled";
+   case State::Rejected:
+      return "rejected";
+   }
+   return "unknown";
+}
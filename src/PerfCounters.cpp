@@ -0,0 +1,150 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+   struct EventSpec
+   {
+      uint32_t type;
+      uint64_t config;
+      const char *name;
+   };
+
+   // Indexed by PerfCounters::Event
+   const EventSpec kEvents[PerfCounters::EventCount] = {
+       {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+       {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+       {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC misses"},
+       {PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        "dTLB misses"}};
+
+   int openEvent(const EventSpec &spec)
+   {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = spec.type;
+      attr.config = spec.config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.inherit = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+   }
+
+   std::string humanCount(double value)
+   {
+      std::ostringstream out;
+      out << std::fixed << std::setprecision(2);
+      if (value >= 1e9)
+         out << value / 1e9 << "G";
+      else if (value >= 1e6)
+         out << value / 1e6 << "M";
+      else if (value >= 1e3)
+         out << value / 1e3 << "k";
+      else
+         out << std::setprecision(0) << value;
+      return out.str();
+   }
+}
+
+PerfCounters::PerfCounters()
+{
+   std::string refused;
+   for (int e = 0; e < EventCount; e++)
+   {
+      m_fd[e] = openEvent(kEvents[e]);
+      if (m_fd[e] < 0)
+         refused += std::string(refused.empty() ? "" : ", ") + kEvents[e].name + " (" + strerror(errno) + ")";
+   }
+   if (!refused.empty())
+      std::cerr << "PerfCounters: Not counting " << refused << std::endl;
+}
+
+PerfCounters::~PerfCounters()
+{
+   for (int e = 0; e < EventCount; e++)
+      if (m_fd[e] >= 0)
+         close(m_fd[e]);
+}
+
+bool PerfCounters::available() const
+{
+   for (int e = 0; e < EventCount; e++)
+      if (m_fd[e] >= 0)
+         return true;
+   return false;
+}
+
+bool PerfCounters::read(int event, Reading &reading) const
+{
+   uint64_t buffer[3];
+   if (m_fd[event] < 0 || ::read(m_fd[event], buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer))
+      return false;
+   reading.value = buffer[0];
+   reading.enabled = buffer[1];
+   reading.running = buffer[2];
+   return true;
+}
+
+void PerfCounters::start()
+{
+   // Counters run from construction; a sample is the difference of two reads.
+   for (int e = 0; e < EventCount; e++)
+      read(e, m_start[e]);
+   m_startTime = std::chrono::steady_clock::now();
+}
+
+PerfCounters::Sample PerfCounters::stop()
+{
+   Sample sample;
+   sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+   for (int e = 0; e < EventCount; e++)
+   {
+      Reading now;
+      if (!read(e, now))
+         continue;
+      const uint64_t running = now.running - m_start[e].running;
+      if (running == 0)
+         continue;
+      const double scale = double(now.enabled - m_start[e].enabled) / double(running);
+      sample.counts[e] = double(now.value - m_start[e].value) * scale;
+      sample.valid[e] = true;
+   }
+   return sample;
+}
+
+std::string PerfCounters::report(const Sample &sample, double flops)
+{
+   std::ostringstream out;
+   out << std::fixed << std::setprecision(2);
+   bool first = true;
+   auto field = [&]() -> std::ostringstream &
+   {
+      if (!first)
+         out << ", ";
+      first = false;
+      return out;
+   };
+
+   for (int e = 0; e < EventCount; e++)
+      if (sample.valid[e])
+         field() << humanCount(sample.counts[e]) << " " << kEvents[e].name;
+   if (sample.valid[Cycles] && sample.valid[Instructions] && sample.counts[Cycles] > 0)
+      field() << "IPC " << sample.counts[Instructions] / sample.counts[Cycles];
+   if (sample.seconds > 0)
+   {
+      field() << flops / sample.seconds / 1e9 << " GFLOP/s";
+      if (sample.valid[LlcMisses])
+         field() << sample.counts[LlcMisses] * 64. / sample.seconds / 1e9 << " GB/s from memory";
+   }
+   return out.str();
+}
@@ -0,0 +1,73 @@
+#include "PreemptionGate.h"
+#include <chrono>
+#include <thread>
+#include <poll.h>
+
+void PreemptionGate::enter()
+{
+   m_pending.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void PreemptionGate::leave()
+{
+   if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      m_clear.notify_all();
+}
+
+bool PreemptionGate::yieldIfPending()
+{
+   if (!pending())
+      return false;
+
+   auto start = std::chrono::steady_clock::now();
+   {
+      // leave() notifies without the mutex, so a wakeup can be missed;
+      // the short timeout bounds that to one re-check.
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (pending())
+         m_clear.wait_for(lock, std::chrono::microseconds(100));
+   }
+   auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+   m_yields.fetch_add(1, std::memory_order_relaxed);
+   m_yieldedMicros.fetch_add(waited.count(), std::memory_order_relaxed);
+   return true;
+}
+
+bool PreemptionGate::stillReadable(pollfd &readable) const
+{
+   readable.revents = 0;
+   return m_watchFd.load(std::memory_order_acquire) == readable.fd &&
+          poll(&readable, 1, 0) > 0 && (readable.revents & POLLIN);
+}
+
+void PreemptionGate::runWatcher(std::atomic<bool> &flag)
+{
+   while (!flag)
+   {
+      const int fd = m_watchFd.load(std::memory_order_acquire);
+      pollfd readable{fd, POLLIN, 0};
+      if (fd < 0 || poll(&readable, 1, 50) <= 0 || !(readable.revents & POLLIN))
+      {
+         // Not connected yet, closed or in error: nothing to wait on
+         if (fd < 0 || readable.revents)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+         continue;
+      }
+
+      // Held until the feed thread has drained the socket; its own Scope
+      // then covers handling the message
+      enter();
+      m_readable.fetch_add(1, std::memory_order_relaxed);
+      const auto start = std::chrono::steady_clock::now();
+      do
+      {
+         std::this_thread::sleep_for(std::chrono::microseconds(20));
+      } while (stillReadable(readable) && std::chrono::steady_clock::now() - start < std::chrono::microseconds(kMaxHoldMicros));
+      leave();
+
+      // The feed thread is not reading: let the calculation run until it does
+      while (!flag && stillReadable(readable))
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+}
@@ -0,0 +1,203 @@
+#include "PrivateChannel.h"
+#include <algorithm>
+#include <iostream>
+#include <boost/asio/ssl/host_name_verification.hpp>
+#include <nlohmann/json.hpp>
+#include <websocketpp/uri.hpp>
+
+namespace
+{
+   const ConfigManager::OKXConfig &requireCredentials(const ConfigManager::OKXConfig &config)
+   {
+      if (config.API_key.empty() || config.API_secret.empty())
+         throw std::runtime_error("PrivateChannel: API key and secret are required");
+      return config;
+   }
+}
+
+PrivateChannel::PrivateChannel(const ConfigManager::OKXConfig &config, const ConfigManager::SocketConfig &socket)
+    : m_config(requireCredentials(config)), m_socket(socket), m_signer(config.API_secret),
+      m_host(websocketpp::uri(config.url_private).get_host())
+{
+   m_client.clear_access_channels(websocketpp::log::alevel::all);
+   m_client.set_access_channels(websocketpp::log::alevel::connect | websocketpp::log::alevel::disconnect);
+   m_client.init_asio();
+
+   m_tlsContext = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
+   m_tlsContext->set_options(boost::asio::ssl::context::default_workarounds |
+                             boost::asio::ssl::context::no_sslv2 |
+                             boost::asio::ssl::context::no_sslv3 |
+                             boost::asio::ssl::context::single_dh_use);
+   // The credentials go to this peer: the chain must verify against the
+   // system roots and the certificate must name the configured host
+   m_tlsContext->set_verify_mode(boost::asio::ssl::verify_peer);
+   m_tlsContext->set_default_verify_paths();
+   m_tlsContext->set_verify_callback(boost::asio::ssl::host_name_verification(m_host));
+   m_client.set_tls_init_handler([this](websocketpp::connection_hdl)
+                                 { return m_tlsContext; });
+   m_client.set_socket_init_handler([this](websocketpp::connection_hdl, boost::asio::ssl::stream<boost::asio::ip::tcp::socket> &stream)
+                                    {
+      // SNI, so a shared front end presents the certificate for m_host
+      SSL_set_tlsext_host_name(stream.native_handle(), m_host.c_str());
+      boost::system::error_code ec;
+      stream.lowest_layer().set_option(boost::asio::ip::tcp::no_delay(m_socket.tcp_nodelay), ec); });
+   m_client.set_open_handler([this](websocketpp::connection_hdl hdl)
+                             { on_open(hdl); });
+   m_client.set_message_handler([this](websocketpp::connection_hdl, tls_client::message_ptr msg)
+                                { on_message(msg->get_payload()); });
+   auto closed = [this](websocketpp::connection_hdl)
+   {
+      m_loggedIn = false;
+      scheduleReconnect();
+   };
+   m_client.set_close_handler(closed);
+   // A certificate that fails verification fails the handshake and lands here
+   m_client.set_fail_handler([this, closed](websocketpp::connection_hdl hdl)
+                             {
+      websocketpp::lib::error_code ec;
+      tls_client::connection_ptr con = m_client.get_con_from_hdl(hdl, ec);
+      if (con)
+         std::cout << "PrivateChannel: Connection to " << m_host << " failed: " << con->get_ec().message() << std::endl;
+      closed(hdl); });
+}
+
+websocketpp::connection_hdl PrivateChannel::handle() const
+{
+   std::lock_guard<std::mutex> lock(m_hdlMutex);
+   return m_hdl;
+}
+
+void PrivateChannel::connect()
+{
+   websocketpp::lib::error_code ec;
+   tls_client::connection_ptr con = m_client.get_connection(m_config.url_private, ec);
+   if (ec)
+   {
+      std::cout << "PrivateChannel: could not create connection because: " << ec.message() << std::endl;
+      scheduleReconnect();
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(m_hdlMutex);
+      m_hdl = con->get_handle();
+   }
+   m_client.connect(con);
+}
+
+void PrivateChannel::scheduleReconnect()
+{
+   if (m_stopping)
+      return;
+   m_backoffMs = m_backoffMs == 0 ? 250 : std::min(m_backoffMs * 2, kMaxBackoffMs);
+   std::cout << "PrivateChannel: Reconnecting in " << m_backoffMs << " ms" << std::endl;
+   m_client.set_timer(m_backoffMs, [this](const websocketpp::lib::error_code &ec)
+                      {
+      if (ec || m_stopping)
+         return;
+      m_reconnects++;
+      connect(); });
+}
+
+void PrivateChannel::schedulePing()
+{
+   const auto hdl = handle();
+   m_client.set_timer(kPingIntervalMs, [this, hdl](const websocketpp::lib::error_code &ec)
+                      {
+      // A timer from an earlier connection stops here
+      const auto current = handle();
+      if (ec || m_stopping || !m_loggedIn || hdl.owner_before(current) || current.owner_before(hdl))
+         return;
+      websocketpp::lib::error_code sendError;
+      m_client.send(hdl, "ping", websocketpp::frame::opcode::text, sendError);
+      schedulePing(); });
+}
+
+void PrivateChannel::on_open(websocketpp::connection_hdl hdl)
+{
+   const auto start = std::chrono::steady_clock::now();
+   std::string frame;
+   try
+   {
+      frame = m_signer.loginFrame(m_config.API_key, m_config.API_passphrase);
+   }
+   catch (const std::exception &e)
+   {
+      std::cout << "PrivateChannel: " << e.what() << std::endl;
+      return;
+   }
+   m_loginSent = std::chrono::steady_clock::now();
+   m_signNs = std::chrono::duration_cast<std::chrono::nanoseconds>(m_loginSent - start).count();
+
+   websocketpp::lib::error_code ec;
+   m_client.send(hdl, frame, websocketpp::frame::opcode::text, ec);
+   if (ec)
+      std::cout << "PrivateChannel: login failed: " << ec.message() << std::endl;
+}
+
+void PrivateChannel::on_message(const std::string &payload)
+{
+   if (payload == "pong")
+      return;
+   // Only event frames (login, error, subscribe) are parsed here; the rest is the handler's
+   if (payload.compare(0, 9, R"({"event":)") == 0)
+   {
+      const nlohmann::json event = nlohmann::json::parse(payload, nullptr, false);
+      const std::string name = event.is_object() ? event.value("event", "") : "";
+      if (name == "login")
+      {
+         m_loginUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_loginSent).count();
+         m_loggedIn = true;
+         m_logins++;
+         m_backoffMs = 0;
+         std::cout << "PrivateChannel: Logged in (sign " << m_signNs.load() << " ns, ack " << m_loginUs.load() << " us)" << std::endl;
+         schedulePing();
+         if (m_onLogin)
+            m_onLogin();
+         return;
+      }
+      if (name == "error" && !m_loggedIn)
+      {
+         // Bad credentials do not get better by retrying quickly
+         std::cout << "PrivateChannel: login rejected: " << event.value("code", "") << " " << event.value("msg", "") << std::endl;
+         m_backoffMs = kMaxBackoffMs / 2;
+         websocketpp::lib::error_code ec;
+         m_client.close(handle(), websocketpp::close::status::normal, "login rejected", ec);
+         return;
+      }
+   }
+   if (m_onMessage)
+      m_onMessage(payload);
+}
+
+bool PrivateChannel::send(const std::string &frame)
+{
+   if (!m_loggedIn)
+      return false;
+   websocketpp::lib::error_code ec;
+   m_client.send(handle(), frame, websocketpp::frame::opcode::text, ec);
+   return !ec;
+}
+
+void PrivateChannel::run(std::atomic<bool> &flag)
+{
+   try
+   {
+      m_client.start_perpetual();
+      connect();
+      // Bounded waits: the channel is often idle and must still notice the flag
+      while (!flag)
+         m_client.get_io_service().run_one_for(std::chrono::milliseconds(50));
+
+      m_stopping = true;
+      m_loggedIn = false;
+      websocketpp::lib::error_code ec;
+      m_client.close(handle(), websocketpp::close::status::normal, "Closing connection", ec);
+      m_client.stop_perpetual();
+      m_client.get_io_service().run_for(std::chrono::milliseconds(500));
+      std::cout << "PrivateChannel has finished the work!\n";
+   }
+   catch (websocketpp::exception const &e)
+   {
+      std::cout << e.what() << std::endl;
+   }
+}
@@ -0,0 +1,154 @@
+#include "ResultCache.h"
+#include <cstring>
+
+namespace
+{
+   constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+   constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+   constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+   constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+   constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+   inline uint64_t rotl(uint64_t x, int r)
+   {
+      return (x << r) | (x >> (64 - r));
+   }
+
+   inline uint64_t round(uint64_t acc, uint64_t input)
+   {
+      acc += input * kPrime2;
+      acc = rotl(acc, 31);
+      return acc * kPrime1;
+   }
+
+   inline uint64_t avalanche(uint64_t h)
+   {
+      h ^= h >> 33;
+      h *= kPrime2;
+      h ^= h >> 29;
+      h *= kPrime3;
+      h ^= h >> 32;
+      return h;
+   }
+
+   inline uint64_t load64(const unsigned char *p)
+   {
+      uint64_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+   }
+
+   size_t bytesOf(const CalculationService::Matrix &m)
+   {
+      return m.data.size() * sizeof(double);
+   }
+}
+
+ResultCache::ResultCache(size_t capacityBytes) : m_capacity(capacityBytes)
+{
+}
+
+ResultCache::Key ResultCache::hash(const void *data, size_t bytes, Key seed)
+{
+   const unsigned char *p = static_cast<const unsigned char *>(data);
+   const unsigned char *end = p + bytes;
+
+   // Four independent lanes over 32-byte stripes
+   uint64_t v[4] = {seed.lo + kPrime1 + kPrime2, seed.hi + kPrime2, seed.lo, seed.hi - kPrime1};
+   while (end - p >= 32)
+   {
+      for (int lane = 0; lane < 4; lane++)
+         v[lane] = round(v[lane], load64(p + 8 * lane));
+      p += 32;
+   }
+
+   uint64_t tail = 0;
+   for (int shift = 0; p < end; shift += 8)
+   {
+      if (shift == 64)
+      {
+         v[0] = round(v[0], tail);
+         tail = 0;
+         shift = 0;
+      }
+      tail |= (uint64_t)*p++ << shift;
+   }
+   v[1] = round(v[1], tail ^ bytes);
+
+   // Two differently mixed folds of the lanes give the 128-bit key
+   Key key;
+   key.lo = avalanche(rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18) + bytes * kPrime5);
+   key.hi = avalanche((v[0] * kPrime4) ^ rotl(v[1], 27) ^ (v[2] * kPrime3) ^ rotl(v[3], 43) ^ key.lo);
+   return key;
+}
+
+ResultCache::Key ResultCache::keyOf(const CalculationService::Request &request)
+{
+   const double header[6] = {(double)request.type, (double)request.a.rows, (double)request.a.cols,
+                             (double)request.b.rows, (double)request.b.cols,
+                             request.type == CalculationService::JobType::CovarianceUpdate ? request.decay : 0.};
+   Key key = hash(header, sizeof(header));
+   key = hash(request.a.data.data(), bytesOf(request.a), key);
+   return hash(request.b.data.data(), bytesOf(request.b), key);
+}
+
+bool ResultCache::lookup(const Key &key, CalculationService::Matrix &value)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto it = m_index.find(key);
+   if (it == m_index.end())
+   {
+      m_stats.misses++;
+      return false;
+   }
+
+   m_lru.splice(m_lru.begin(), m_lru, it->second);
+   value = it->second->value;
+   m_stats.hits++;
+   m_stats.bytesSaved += bytesOf(value);
+   m_stats.microsSaved += it->second->execMicros;
+   return true;
+}
+
+void ResultCache::insert(const Key &key, const CalculationService::Matrix &value, uint64_t execMicros)
+{
+   const size_t bytes = bytesOf(value);
+   if (bytes > m_capacity)
+      return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if (m_index.count(key))
+      return;
+
+   while (m_stats.bytesUsed + bytes > m_capacity && !m_lru.empty())
+   {
+      m_stats.bytesUsed -= bytesOf(m_lru.back().value);
+      m_index.erase(m_lru.back().key);
+      m_lru.pop_back();
+      m_stats.evictions++;
+   }
+
+   m_lru.push_front({key, value, execMicros});
+   m_index[key] = m_lru.begin();
+   m_stats.bytesUsed += bytes;
+}
+
+ResultCache::Stats ResultCache::stats() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   Stats stats = m_stats;
+   stats.entries = m_lru.size();
+   return stats;
+}
+
+void ResultCache::recordHashTime(uint64_t micros)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_stats.hashMicros += micros;
+}
+
+double ResultCache::hitRate(const Stats &stats)
+{
+   const uint64_t lookups = stats.hits + stats.misses;
+   return lookups ? double(stats.hits) / lookups : 0.;
+}
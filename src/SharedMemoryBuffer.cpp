@@ -0,0 +1,55 @@
+#include "SharedMemoryBuffer.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedMemoryBuffer::SharedMemoryBuffer(size_t bytes) : m_fd(-1), m_bytes(bytes), m_data(nullptr)
+{
+   m_fd = memfd_create("calculation-job", MFD_CLOEXEC);
+   if (m_fd < 0)
+      throw std::runtime_error("SharedMemoryBuffer: cannot create memfd: " + std::string(strerror(errno)));
+   if (ftruncate(m_fd, (off_t)(bytes ? bytes : 1)) != 0)
+   {
+      int err = errno;
+      close(m_fd);
+      throw std::runtime_error("SharedMemoryBuffer: cannot size memfd: " + std::string(strerror(err)));
+   }
+   map();
+}
+
+SharedMemoryBuffer::SharedMemoryBuffer(int fd, size_t bytes) : m_fd(fd), m_bytes(bytes), m_data(nullptr)
+{
+   // Never map past the end of the file, that would fault on access
+   struct stat info;
+   if (fstat(m_fd, &info) != 0 || (size_t)info.st_size < bytes)
+   {
+      close(m_fd);
+      throw std::runtime_error("SharedMemoryBuffer: handle is smaller than the requested size");
+   }
+   map();
+}
+
+SharedMemoryBuffer::~SharedMemoryBuffer()
+{
+   if (m_data)
+      munmap(m_data, m_bytes ? m_bytes : 1);
+   if (m_fd >= 0)
+      close(m_fd);
+}
+
+void SharedMemoryBuffer::map()
+{
+   void *data = mmap(nullptr, m_bytes ? m_bytes : 1, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+   if (data == MAP_FAILED)
+   {
+      int err = errno;
+      close(m_fd);
+      m_fd = -1;
+      throw std::runtime_error("SharedMemoryBuffer: cannot map memfd: " + std::string(strerror(err)));
+   }
+   m_data = data;
+}
@@ -0,0 +1,181 @@
+#include "SparseLU.h"
+#include "SparseMatrix.h"
+#include "PreemptionGate.h"
+#include <cmath>
+#include <stdexcept>
+
+int SparseLU::factor(const SparseMatrix &A, const std::vector<int> &columnOrder, double pivotTolerance,
+                     PreemptionGate *gate)
+{
+   const int n = A.size();
+   if ((int)columnOrder.size() != n || A.rows() != n)
+      throw std::invalid_argument("SparseLU: ordering or matrix incomplete");
+   m_n = n;
+   m_q = columnOrder;
+   m_flops = 0.;
+
+   // Column access to A: transpose the CSR pattern
+   std::vector<int> aPtr(n + 1, 0), aIdx(A.nonzeros());
+   std::vector<double> aValues(A.nonzeros());
+   for (int c : A.colIdx())
+      aPtr[c + 1]++;
+   for (int j = 0; j < n; j++)
+      aPtr[j + 1] += aPtr[j];
+   {
+      std::vector<int> next(aPtr.begin(), aPtr.end() - 1);
+      for (int i = 0; i < n; i++)
+         for (int p = A.rowPtr()[i]; p < A.rowPtr()[i + 1]; p++)
+         {
+            const int slot = next[A.colIdx()[p]]++;
+            aIdx[slot] = i;
+            aValues[slot] = A.values()[p];
+         }
+   }
+
+   m_pinv.assign(n, -1);
+   m_lPtr.assign(1, 0);
+   m_uPtr.assign(1, 0);
+   m_lIdx.clear();
+   m_lValues.clear();
+   m_uIdx.clear();
+   m_uValues.clear();
+
+   std::vector<double> x(n, 0.);
+   std::vector<int> reach(n), stack(n), resume(n);
+   std::vector<int> mark(n, -1);
+
+   for (int k = 0; k < n; k++)
+   {
+      if (gate && k % kYieldColumns == 0)
+         gate->yieldIfPending();
+      const int col = m_q[k];
+
+      // Rows reachable from A(:, col) through the columns of L done so far,
+      // in topological order in reach[top, n)
+      int top = n;
+      for (int p = aPtr[col]; p < aPtr[col + 1]; p++)
+      {
+         if (mark[aIdx[p]] == k)
+            continue;
+         int head = 0;
+         stack[0] = aIdx[p];
+         while (head >= 0)
+         {
+            const int j = stack[head];
+            const int J = m_pinv[j];
+            if (mark[j] != k)
+            {
+               mark[j] = k;
+               resume[head] = J < 0 ? 0 : m_lPtr[J] + 1;
+            }
+            bool done = true;
+            const int end = J < 0 ? 0 : m_lPtr[J + 1];
+            for (int q = resume[head]; q < end; q++)
+            {
+               const int i = m_lIdx[q];
+               if (mark[i] == k)
+                  continue;
+               resume[head] = q + 1;
+               stack[++head] = i;
+               done = false;
+               break;
+            }
+            if (done)
+            {
+               head--;
+               reach[--top] = j;
+            }
+         }
+      }
+
+      // x = L \ A(:, col) over the reached rows only
+      for (int p = aPtr[col]; p < aPtr[col + 1]; p++)
+         x[aIdx[p]] = aValues[p];
+      for (int t = top; t < n; t++)
+      {
+         const int j = reach[t];
+         const int J = m_pinv[j];
+         if (J < 0)
+            continue;
+         const double xj = x[j];
+         for (int q = m_lPtr[J] + 1; q < m_lPtr[J + 1]; q++)
+            x[m_lIdx[q]] -= m_lValues[q] * xj;
+         m_flops += 2. * (m_lPtr[J + 1] - m_lPtr[J] - 1);
+      }
+
+      // Pivoted rows form U(:, k); the largest remaining one is the pivot
+      int pivotRow = -1;
+      double largest = -1.;
+      for (int t = top; t < n; t++)
+      {
+         const int i = reach[t];
+         if (m_pinv[i] < 0)
+         {
+            if (std::fabs(x[i]) > largest)
+            {
+               largest = std::fabs(x[i]);
+               pivotRow = i;
+            }
+         }
+         else
+         {
+            m_uIdx.push_back(m_pinv[i]);
+            m_uValues.push_back(x[i]);
+         }
+      }
+      if (pivotRow < 0 || largest <= 0.)
+      {
+         for (int t = top; t < n; t++)
+            x[reach[t]] = 0.;
+         return -1;
+      }
+      if (m_pinv[col] < 0 && mark[col] == k && std::fabs(x[col]) >= pivotTolerance * largest)
+         pivotRow = col;
+
+      const double pivot = x[pivotRow];
+      m_uIdx.push_back(k);
+      m_uValues.push_back(pivot);
+      m_uPtr.push_back((int)m_uValues.size());
+      m_pinv[pivotRow] = k;
+
+      m_lIdx.push_back(pivotRow);
+      m_lValues.push_back(1.);
+      for (int t = top; t < n; t++)
+      {
+         const int i = reach[t];
+         if (m_pinv[i] < 0)
+         {
+            m_lIdx.push_back(i);
+            m_lValues.push_back(x[i] / pivot);
+            m_flops += 1.;
+         }
+         x[i] = 0.;
+      }
+      m_lPtr.push_back((int)m_lValues.size());
+   }
+
+   // L rows from original numbering to pivot steps
+   for (int &i : m_lIdx)
+      i = m_pinv[i];
+   m_work.assign(n, 0.);
+   return 0;
+}
+
+void SparseLU::solve(const double *b, double *x) const
+{
+   // x = Q U^-1 L^-1 P b
+   std::vector<double> &y = m_work;
+   for (int i = 0; i < m_n; i++)
+      y[m_pinv[i]] = b[i];
+   for (int j = 0; j < m_n; j++)
+      for (int p = m_lPtr[j] + 1; p < m_lPtr[j + 1]; p++)
+         y[m_lIdx[p]] -= m_lValues[p] * y[j];
+   for (int j = m_n - 1; j >= 0; j--)
+   {
+      y[j] /= m_uValues[m_uPtr[j + 1] - 1];
+      for (int p = m_uPtr[j]; p < m_uPtr[j + 1] - 1; p++)
+         y[m_uIdx[p]] -= m_uValues[p] * y[j];
+   }
+   for (int k = 0; k < m_n; k++)
+      x[m_q[k]] = y[k];
+}
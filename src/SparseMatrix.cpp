@@ -0,0 +1,100 @@
+#include "SparseMatrix.h"
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+SparseMatrix::SparseMatrix(int n) : m_n(n), m_rowPtr(1, 0)
+{
+   if (n < 0)
+      throw std::invalid_argument("SparseMatrix: negative size");
+}
+
+void SparseMatrix::appendRow(const int *cols, const double *values, int count)
+{
+   if (rows() >= m_n)
+      throw std::logic_error("SparseMatrix: all rows already appended");
+   m_colIdx.insert(m_colIdx.end(), cols, cols + count);
+   m_values.insert(m_values.end(), values, values + count);
+   m_rowPtr.push_back((int)m_values.size());
+}
+
+void SparseMatrix::multiply(const double *x, double *y) const
+{
+   for (int i = 0; i < rows(); i++)
+   {
+      double sum = 0.;
+      for (int p = m_rowPtr[i]; p < m_rowPtr[i + 1]; p++)
+         sum += m_values[p] * x[m_colIdx[p]];
+      y[i] = sum;
+   }
+}
+
+void SparseMatrix::toDense(double *out) const
+{
+   for (int i = 0; i < rows(); i++)
+   {
+      double *row = out + (size_t)i * m_n;
+      std::fill(row, row + m_n, 0.);
+      for (int p = m_rowPtr[i]; p < m_rowPtr[i + 1]; p++)
+         row[m_colIdx[p]] = m_values[p];
+   }
+}
+
+std::vector<int> SparseMatrix::minimumDegreeOrdering() const
+{
+   // Symmetric off-diagonal pattern, one sorted neighbour list per node
+   std::vector<std::vector<int>> adjacent(m_n);
+   for (int i = 0; i < rows(); i++)
+      for (int p = m_rowPtr[i]; p < m_rowPtr[i + 1]; p++)
+         if (m_colIdx[p] != i)
+         {
+            adjacent[i].push_back(m_colIdx[p]);
+            adjacent[m_colIdx[p]].push_back(i);
+         }
+   std::set<std::pair<int, int>> byDegree;
+   for (int v = 0; v < m_n; v++)
+   {
+      std::sort(adjacent[v].begin(), adjacent[v].end());
+      adjacent[v].erase(std::unique(adjacent[v].begin(), adjacent[v].end()), adjacent[v].end());
+      byDegree.insert({(int)adjacent[v].size(), v});
+   }
+
+   std::vector<int> order;
+   order.reserve(m_n);
+   std::vector<int> merged;
+   while (!byDegree.empty())
+   {
+      // Once every remaining node touches most of the others the rest is
+      // effectively a dense block: order cannot save fill there any more
+      const int remaining = (int)byDegree.size();
+      if (byDegree.begin()->first * 2 >= remaining)
+      {
+         for (const auto &entry : byDegree)
+            order.push_back(entry.second);
+         break;
+      }
+
+      const int v = byDegree.begin()->second;
+      byDegree.erase(byDegree.begin());
+      order.push_back(v);
+
+      // Eliminating v makes its neighbours a clique; v leaves their lists
+      const std::vector<int> clique = std::move(adjacent[v]);
+      adjacent[v].clear();
+      for (int u : clique)
+      {
+         std::vector<int> &list = adjacent[u];
+         byDegree.erase({(int)list.size(), u});
+         merged.clear();
+         std::set_union(list.begin(), list.end(), clique.begin(), clique.end(), std::back_inserter(merged));
+         merged.erase(std::remove_if(merged.begin(), merged.end(), [u, v](int w)
+                                     { return w == u || w == v; }),
+                      merged.end());
+         list.swap(merged);
+         byDegree.insert({(int)list.size(), u});
+      }
+   }
+   return order;
+}
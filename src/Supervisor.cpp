@@ -0,0 +1,198 @@
+#include "Supervisor.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <pthread.h>
+
+Supervisor::~Supervisor()
+{
+   stop();
+}
+
+void Supervisor::add(Component component)
+{
+   if (component.name.empty() || find(component.name))
+      throw std::invalid_argument("Supervisor: empty or duplicate component name: " + component.name);
+   auto entry = std::make_unique<Entry>();
+   entry->component = std::move(component);
+   m_entries.push_back(std::move(entry));
+}
+
+Supervisor::Entry *Supervisor::find(const std::string &name) const
+{
+   for (const auto &entry : m_entries)
+      if (entry->component.name == name)
+         return entry.get();
+   return nullptr;
+}
+
+std::vector<Supervisor::Entry *> Supervisor::startOrder() const
+{
+   for (const auto &entry : m_entries)
+      for (const auto &dependency : entry->component.dependsOn)
+         if (!find(dependency))
+            throw std::invalid_argument("Supervisor: " + entry->component.name + " depends on unknown " + dependency);
+
+   // Repeatedly take the earliest registered component whose dependencies are placed
+   std::vector<Entry *> order;
+   while (order.size() < m_entries.size())
+   {
+      Entry *next = nullptr;
+      for (const auto &entry : m_entries)
+      {
+         if (std::find(order.begin(), order.end(), entry.get()) != order.end())
+            continue;
+         const auto &dependsOn = entry->component.dependsOn;
+         if (std::all_of(dependsOn.begin(), dependsOn.end(), [&](const std::string &name)
+                         { return std::find(order.begin(), order.end(), find(name)) != order.end(); }))
+         {
+            next = entry.get();
+            break;
+         }
+      }
+      if (!next)
+         throw std::invalid_argument("Supervisor: dependency cycle among the components");
+      order.push_back(next);
+   }
+   return order;
+}
+
+void Supervisor::start()
+{
+   if (!m_started.empty())
+      return;
+
+   for (Entry *entry : startOrder())
+   {
+      const Component &component = entry->component;
+      const bool dependenciesUp = std::all_of(component.dependsOn.begin(), component.dependsOn.end(), [this](const std::string &name)
+                                              { return find(name)->state.load() == State::Running; });
+      try
+      {
+         if (!dependenciesUp)
+            throw std::runtime_error("a dependency is not running");
+         if (component.start)
+            component.start();
+      }
+      catch (const std::exception &e)
+      {
+         entry->state = dependenciesUp ? State::Failed : State::Skipped;
+         if (component.optional)
+         {
+            std::cerr << "Supervisor: " << component.name << " not started: " << e.what() << "; continuing without it" << std::endl;
+            continue;
+         }
+         stop();
+         throw std::runtime_error("Supervisor: " + component.name + " failed to start: " + e.what());
+      }
+      entry->state = State::Running;
+      m_started.push_back(entry);
+   }
+}
+
+void Supervisor::run(std::chrono::seconds duration)
+{
+   for (Entry *entry : m_started)
+   {
+      if (!entry->component.run)
+         continue;
+      entry->thread = std::thread(&Supervisor::runEntry, this, std::ref(*entry));
+      const int cpu = entry->component.cpu;
+      if (cpu < 0)
+         continue;
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu, &cpus);
+      if (pthread_setaffinity_np(entry->thread.native_handle(), sizeof(cpus), &cpus) != 0)
+         std::cerr << "Supervisor: Cannot pin " << entry->component.name << " to cpu " << cpu << std::endl;
+   }
+
+   {
+      std::unique_lock<std::mutex> lock(m_waitMutex);
+      m_wake.wait_for(lock, duration, [this]()
+                      { return m_stopRequested; });
+   }
+   stop();
+}
+
+void Supervisor::runEntry(Entry &entry)
+{
+   try
+   {
+      entry.component.run(m_stopFlag);
+   }
+   catch (const std::exception &e)
+   {
+      entry.state = State::Failed;
+      std::cerr << "Supervisor: " << entry.component.name << " failed: " << e.what() << "; stopping" << std::endl;
+      requestStop();
+   }
+}
+
+void Supervisor::requestStop()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_waitMutex);
+      m_stopRequested = true;
+   }
+   m_wake.notify_all();
+}
+
+void Supervisor::stop()
+{
+   m_stopFlag = true;
+   requestStop();
+   for (auto it = m_started.rbegin(); it != m_started.rend(); ++it)
+   {
+      Entry &entry = **it;
+      if (entry.thread.joinable())
+         entry.thread.join();
+      try
+      {
+         if (entry.component.stop)
+            entry.component.stop();
+      }
+      catch (const std::exception &e)
+      {
+         entry.state = State::Failed;
+         std::cerr << "Supervisor: " << entry.component.name << " failed to stop: " << e.what() << std::endl;
+      }
+      if (entry.state.load() == State::Running)
+         entry.state = State::Stopped;
+   }
+   m_started.clear();
+}
+
+std::string Supervisor::health() const
+{
+   std::ostringstream out;
+   for (const auto &entry : m_entries)
+   {
+      const State state = entry->state.load();
+      out << entry->component.name << " " << stateName(state);
+      // Hooks read the component's objects, which exist only while it runs
+      if (state == State::Running && entry->component.health)
+         out << " " << entry->component.health();
+      out << "\n";
+   }
+   return out.str();
+}
+
+const char *Supervisor::stateName(State state)
+{
+   switch (state)
+   {
+   case State::Registered:
+      return "registered";
+   case State::Running:
+      return "running";
+   case State::Skipped:
+      return "skipped";
+   case State::Failed:
+      return "failed";
+   case State::Stopped:
+      return "stopped";
+   }
+   return "unknown";
+}
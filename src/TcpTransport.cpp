@@ -0,0 +1,257 @@
+#include "TcpTransport.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+   constexpr uint32_t kMagic = 0x54524e53; // "TRNS"
+
+   struct Hello
+   {
+      uint32_t magic;
+      int32_t rank;
+   };
+
+   struct FrameHeader
+   {
+      uint32_t magic;
+      int32_t source;
+      uint64_t tag;
+      uint64_t count;
+   };
+
+   bool writeAll(int fd, const void *data, size_t bytes)
+   {
+      const char *p = static_cast<const char *>(data);
+      while (bytes > 0)
+      {
+         ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n <= 0)
+            return false;
+         p += n;
+         bytes -= n;
+      }
+      return true;
+   }
+
+   bool readAll(int fd, void *data, size_t bytes)
+   {
+      char *p = static_cast<char *>(data);
+      while (bytes > 0)
+      {
+         ssize_t n = ::recv(fd, p, bytes, 0);
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n <= 0)
+            return false;
+         p += n;
+         bytes -= n;
+      }
+      return true;
+   }
+
+   void splitEndpoint(const std::string &endpoint, std::string &host, std::string &port)
+   {
+      const size_t colon = endpoint.rfind(':');
+      if (colon == std::string::npos || colon + 1 == endpoint.size())
+         throw std::invalid_argument("TcpTransport: endpoint must be host:port, got " + endpoint);
+      host = endpoint.substr(0, colon);
+      port = endpoint.substr(colon + 1);
+   }
+
+   void setNoDelay(int fd)
+   {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   }
+
+   // Bound to this rank's own address, not every interface
+   int listenOn(const std::string &host, const std::string &port, int backlog)
+   {
+      addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo *result = nullptr;
+      if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+         throw std::runtime_error("TcpTransport: cannot resolve " + host + ":" + port);
+
+      int fd = socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, 0);
+      int one = 1;
+      if (fd >= 0)
+         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if (fd < 0 || bind(fd, result->ai_addr, result->ai_addrlen) != 0 || listen(fd, backlog) != 0)
+      {
+         int err = errno;
+         freeaddrinfo(result);
+         if (fd >= 0)
+            close(fd);
+         throw std::runtime_error("TcpTransport: cannot listen on " + host + ":" + port + ": " + strerror(err));
+      }
+      freeaddrinfo(result);
+      return fd;
+   }
+
+   int connectTo(const std::string &host, const std::string &port)
+   {
+      addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo *result = nullptr;
+      if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+         return -1;
+
+      int fd = -1;
+      for (addrinfo *ai = result; ai; ai = ai->ai_next)
+      {
+         fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+         if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+         if (fd >= 0)
+            close(fd);
+         fd = -1;
+      }
+      freeaddrinfo(result);
+      return fd;
+   }
+}
+
+TcpTransport::TcpTransport(int rank, const std::vector<std::string> &endpoints, size_t maxCount, std::chrono::seconds timeout)
+    : Transport(rank, (int)endpoints.size()), m_sockets(endpoints.size(), -1), m_maxCount(maxCount)
+{
+   const auto deadline = std::chrono::steady_clock::now() + timeout;
+   std::string host, port;
+   splitEndpoint(endpoints[rank], host, port);
+   int server = listenOn(host, port, size());
+
+   try
+   {
+      // Lower ranks: connect, retrying while they start up
+      for (int peer = 0; peer < rank; peer++)
+      {
+         splitEndpoint(endpoints[peer], host, port);
+         int fd;
+         while ((fd = connectTo(host, port)) < 0)
+         {
+            if (std::chrono::steady_clock::now() > deadline)
+               throw std::runtime_error("TcpTransport: cannot reach rank " + std::to_string(peer) + " at " + endpoints[peer]);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+         }
+         Hello hello = {kMagic, rank};
+         if (!writeAll(fd, &hello, sizeof(hello)))
+         {
+            close(fd);
+            throw std::runtime_error("TcpTransport: handshake with rank " + std::to_string(peer) + " failed");
+         }
+         setNoDelay(fd);
+         m_sockets[peer] = fd;
+      }
+
+      // Higher ranks: accept, learning who they are from the hello
+      for (int accepted = rank + 1; accepted < size(); accepted++)
+      {
+         const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+         pollfd pfd = {server, POLLIN, 0};
+         if (left.count() <= 0 || poll(&pfd, 1, (int)left.count()) <= 0)
+            throw std::runtime_error("TcpTransport: timed out waiting for higher ranks to connect");
+
+         int fd = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+         Hello hello;
+         if (fd < 0 || !readAll(fd, &hello, sizeof(hello)) || hello.magic != kMagic ||
+             hello.rank <= rank || hello.rank >= size() || m_sockets[hello.rank] >= 0)
+         {
+            if (fd >= 0)
+               close(fd);
+            throw std::runtime_error("TcpTransport: bad handshake from a peer");
+         }
+         setNoDelay(fd);
+         m_sockets[hello.rank] = fd;
+      }
+   }
+   catch (...)
+   {
+      close(server);
+      for (int fd : m_sockets)
+         if (fd >= 0)
+            close(fd);
+      throw;
+   }
+   close(server);
+
+   for (int peer = 0; peer < size(); peer++)
+      m_sendMutex.push_back(std::make_unique<std::mutex>());
+   for (int peer = 0; peer < size(); peer++)
+      if (peer != rank)
+         m_readers.emplace_back(&TcpTransport::readLoop, this, peer);
+}
+
+TcpTransport::~TcpTransport()
+{
+   m_closing = true;
+   for (int fd : m_sockets)
+      if (fd >= 0)
+         shutdown(fd, SHUT_RDWR);
+   for (auto &reader : m_readers)
+      reader.join();
+   for (int fd : m_sockets)
+      if (fd >= 0)
+         close(fd);
+}
+
+void TcpTransport::transmit(int dest, uint64_t tag, const double *data, size_t count)
+{
+   if (dest == rank())
+   {
+      deliver(dest, tag, std::vector<double>(data, data + count));
+      return;
+   }
+
+   FrameHeader header = {kMagic, rank(), tag, count};
+   std::lock_guard<std::mutex> lock(*m_sendMutex[dest]);
+   if (!writeAll(m_sockets[dest], &header, sizeof(header)) ||
+       !writeAll(m_sockets[dest], data, count * sizeof(double)))
+   {
+      throw std::runtime_error("TcpTransport: send to rank " + std::to_string(dest) + " failed");
+   }
+}
+
+void TcpTransport::readLoop(int peer)
+{
+   const int fd = m_sockets[peer];
+   while (true)
+   {
+      FrameHeader header;
+      std::vector<double> payload;
+      bool ok = readAll(fd, &header, sizeof(header)) && header.magic == kMagic && header.source == peer;
+      if (ok && header.count > m_maxCount)
+      {
+         // Corrupt or hostile: do not let the length on the wire size an allocation
+         fail(peer, "frame of " + std::to_string(header.count) + " doubles from rank " + std::to_string(peer) +
+                        " exceeds the limit of " + std::to_string(m_maxCount));
+         return;
+      }
+      if (ok)
+      {
+         payload.resize(header.count);
+         ok = readAll(fd, payload.data(), header.count * sizeof(double));
+      }
+      if (!ok)
+      {
+         // Reported by the next receive(); a peer leaving after its last message is normal
+         if (!m_closing)
+            fail(peer, "connection to rank " + std::to_string(peer) + " lost");
+         return;
+      }
+      deliver(peer, header.tag, std::move(payload));
+   }
+}
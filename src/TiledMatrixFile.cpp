@@ -0,0 +1,355 @@
+#include "TiledMatrixFile.h"
+#include "MatrixKernels.h"
+#include "PreemptionGate.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TiledMatrixFile::TiledMatrixFile(int n, int tileSize, int cacheTiles, const std::string &scratchDir)
+    : m_n(n), m_tileSize(tileSize), m_fd(-1), m_map(nullptr)
+{
+   if (n <= 0 || tileSize <= 0)
+   {
+      throw std::invalid_argument("TiledMatrixFile: size and tile size must be positive");
+   }
+
+   m_tiles = (n + tileSize - 1) / tileSize;
+   m_tileElems = (size_t)tileSize * tileSize;
+   m_bytes = (size_t)m_tiles * m_tiles * m_tileElems * sizeof(double);
+   // One pinned tile row, plus A_ik, A_ij and a scratch slot
+   m_capacity = std::max(cacheTiles, m_tiles + 3);
+
+   std::string path = scratchDir;
+   if (path.empty() || path.back() != '/')
+      path += '/';
+   path += "okx-tiles-XXXXXX";
+   std::vector<char> name(path.begin(), path.end());
+   name.push_back('\0');
+
+   m_fd = mkstemp(name.data());
+   if (m_fd < 0)
+   {
+      throw std::runtime_error("TiledMatrixFile: cannot create scratch file in " + scratchDir + ": " + strerror(errno));
+   }
+   unlink(name.data());
+
+   if (ftruncate(m_fd, (off_t)m_bytes) != 0)
+   {
+      int err = errno;
+      close(m_fd);
+      throw std::runtime_error("TiledMatrixFile: cannot size scratch file: " + std::string(strerror(err)));
+   }
+
+   void *addr = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+   if (addr == MAP_FAILED)
+   {
+      int err = errno;
+      close(m_fd);
+      throw std::runtime_error("TiledMatrixFile: cannot map scratch file: " + std::string(strerror(err)));
+   }
+   m_map = static_cast<double *>(addr);
+
+   // The file starts zeroed; the padding only needs its diagonal.
+   const int padded = m_tiles * m_tileSize;
+   for (int i = n; i < padded; i++)
+   {
+      const int r = i % m_tileSize;
+      mapped(i / m_tileSize, i / m_tileSize)[r * m_tileSize + r] = 1.;
+   }
+}
+
+TiledMatrixFile::~TiledMatrixFile()
+{
+   if (m_map)
+      munmap(m_map, m_bytes);
+   if (m_fd >= 0)
+      close(m_fd);
+}
+
+double *TiledMatrixFile::mapped(int ti, int tj) const
+{
+   return m_map + ((size_t)ti * m_tiles + tj) * m_tileElems;
+}
+
+void TiledMatrixFile::setRow(int i, const double *values)
+{
+   const int ti = i / m_tileSize;
+   const int r = i % m_tileSize;
+   for (int tj = 0; tj < m_tiles; tj++)
+   {
+      const int first = tj * m_tileSize;
+      const int count = std::min(m_tileSize, m_n - first);
+      std::memcpy(mapped(ti, tj) + (size_t)r * m_tileSize, values + first, count * sizeof(double));
+   }
+}
+
+void TiledMatrixFile::evictOne()
+{
+   for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it)
+   {
+      auto entry = m_cache.find(*it);
+      if (entry->second.pins > 0)
+         continue;
+
+      if (entry->second.dirty)
+      {
+         std::memcpy(mapped(*it / m_tiles, *it % m_tiles), entry->second.data.data(), m_tileElems * sizeof(double));
+         m_stats.writebacks++;
+      }
+      m_lru.erase(std::next(it).base());
+      m_cache.erase(entry);
+      return;
+   }
+   throw std::runtime_error("TiledMatrixFile: tile cache exhausted, all tiles pinned");
+}
+
+double *TiledMatrixFile::acquire(int ti, int tj, bool dirty)
+{
+   const int key = ti * m_tiles + tj;
+   auto it = m_cache.find(key);
+   if (it != m_cache.end())
+   {
+      m_stats.hits++;
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+   }
+   else
+   {
+      if ((int)m_cache.size() >= m_capacity)
+         evictOne();
+      it = m_cache.emplace(key, Entry()).first;
+      const double *src = mapped(ti, tj);
+      it->second.data.assign(src, src + m_tileElems);
+      m_lru.push_front(key);
+      it->second.lru = m_lru.begin();
+      m_stats.loads++;
+   }
+   it->second.pins++;
+   it->second.dirty |= dirty;
+   return it->second.data.data();
+}
+
+void TiledMatrixFile::release(int ti, int tj)
+{
+   auto it = m_cache.find(ti * m_tiles + tj);
+   if (it != m_cache.end() && it->second.pins > 0)
+      it->second.pins--;
+}
+
+void TiledMatrixFile::prefetch(int ti, int tj)
+{
+   if (m_cache.count(ti * m_tiles + tj))
+      return;
+   // The mapping and tiles are page aligned whenever a tile is a whole
+   // number of pages; otherwise round the start down.
+   uintptr_t start = reinterpret_cast<uintptr_t>(mapped(ti, tj));
+   const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+   const uintptr_t aligned = start & ~(page - 1);
+   madvise(reinterpret_cast<void *>(aligned), m_tileElems * sizeof(double) + (start - aligned), MADV_WILLNEED);
+   m_stats.prefetches++;
+}
+
+void TiledMatrixFile::flush()
+{
+   for (auto &entry : m_cache)
+   {
+      if (!entry.second.dirty)
+         continue;
+      std::memcpy(mapped(entry.first / m_tiles, entry.first % m_tiles), entry.second.data.data(), m_tileElems * sizeof(double));
+      entry.second.dirty = false;
+      m_stats.writebacks++;
+   }
+}
+
+void TiledMatrixFile::discardCache()
+{
+   m_cache.clear();
+   m_lru.clear();
+   m_stats = Stats();
+}
+
+int TiledMatrixFile::panelPivots(int k, std::vector<std::pair<int, int>> &swaps)
+{
+   // Tile column k from the diagonal down, in memory: the size of one tile row
+   const int T = m_tileSize;
+   const int first = k * T;
+   const int rows = m_tiles * T - first;
+   std::vector<double> panel((size_t)rows * T);
+   for (int i = k; i < m_tiles; i++)
+   {
+      const double *tile = acquire(i, k, false);
+      std::copy(tile, tile + m_tileElems, panel.begin() + (size_t)(i - k) * m_tileElems);
+      release(i, k);
+   }
+
+   for (int c = 0; c < T; c++)
+   {
+      int max_row = c;
+      for (int r = c + 1; r < rows; r++)
+         if (fabs(panel[(size_t)r * T + c]) > fabs(panel[(size_t)max_row * T + c]))
+            max_row = r;
+      if (fabs(panel[(size_t)max_row * T + c]) < 1.e-20)
+         return -1;
+
+      if (max_row != c)
+      {
+         std::swap_ranges(panel.begin() + (size_t)c * T, panel.begin() + (size_t)(c + 1) * T, panel.begin() + (size_t)max_row * T);
+         swaps.emplace_back(first + c, first + max_row);
+      }
+      const double *pivotRow = panel.data() + (size_t)c * T;
+      for (int r = c + 1; r < rows; r++)
+      {
+         double *row = panel.data() + (size_t)r * T;
+         MatrixKernels::axpy(T - c - 1, -row[c] / pivotRow[c], pivotRow + c + 1, row + c + 1);
+      }
+   }
+   return 0;
+}
+
+void TiledMatrixFile::swapRows(const std::pair<int, int> *swaps, size_t count)
+{
+   // Tile column by tile column, so each tile is loaded at most once
+   const int T = m_tileSize;
+   for (int tj = 0; tj < m_tiles; tj++)
+   {
+      for (size_t s = 0; s < count; s++)
+      {
+         const int a = swaps[s].first, b = swaps[s].second;
+         double *x = acquire(a / T, tj, true) + (size_t)(a % T) * T;
+         double *y = acquire(b / T, tj, true) + (size_t)(b % T) * T;
+         std::swap_ranges(x, x + T, y);
+         release(a / T, tj);
+         release(b / T, tj);
+      }
+   }
+}
+
+void TiledMatrixFile::unswapColumns(const std::pair<int, int> *swaps, size_t count)
+{
+   // A^-1 = (P A)^-1 P: the row interchanges in reverse, as column interchanges
+   const int T = m_tileSize;
+   for (int ti = 0; ti < m_tiles; ti++)
+   {
+      for (size_t s = count; s-- > 0;)
+      {
+         const int a = swaps[s].first, b = swaps[s].second;
+         double *x = acquire(ti, a / T, true) + a % T;
+         double *y = acquire(ti, b / T, true) + b % T;
+         for (int r = 0; r < T; r++)
+            std::swap(x[(size_t)r * T], y[(size_t)r * T]);
+         release(ti, a / T);
+         release(ti, b / T);
+      }
+   }
+}
+
+int TiledMatrixFile::invert(PreemptionGate *gate)
+{
+   // Block Gauss-Jordan sweep: for every diagonal tile D = A_kk^-1
+   //    A_kj <- D A_kj,  A_ij <- A_ij - A_ik A_kj,  A_ik <- -A_ik D,  A_kk <- D
+   // Only tile row k stays pinned; the other rows stream through the cache.
+   const int T = m_tileSize;
+   std::vector<double> tmp(m_tileElems);
+   std::vector<double *> rowK(m_tiles);
+   std::vector<std::pair<int, int>> swaps;
+
+   for (int k = 0; k < m_tiles; k++)
+   {
+      // Bring up the rows partial pivoting would choose from tile column k, as
+      // pivoted Gauss-Jordan does: a well-conditioned diagonal tile alone does
+      // not make the step stable when the rows below it dominate
+      const size_t before = swaps.size();
+      if (panelPivots(k, swaps) != 0)
+         return -1;
+      swapRows(swaps.data() + before, swaps.size() - before);
+      m_stats.pivots += swaps.size() - before;
+      const double *pivoted = acquire(k, k, false);
+      std::copy(pivoted, pivoted + m_tileElems, tmp.begin());
+      release(k, k);
+      if (MatrixKernels::invertBase(tmp.data(), T, T) != 0)
+         return -1;
+
+      for (int j = 0; j < m_tiles; j++)
+         rowK[j] = acquire(k, j, true);
+
+      double *D = rowK[k];
+      std::copy(tmp.begin(), tmp.end(), D);
+
+      for (int j = 0; j < m_tiles; j++)
+      {
+         if (j == k)
+            continue;
+         MatrixKernels::multiplyParallel(0, T, T, T, 1., D, T, rowK[j], T, 0., tmp.data(), T);
+         std::copy(tmp.begin(), tmp.end(), rowK[j]);
+      }
+
+      for (int i = 0; i < m_tiles; i++)
+      {
+         if (i == k)
+            continue;
+         // Preemption point: between tile rows, nothing of row i pinned yet
+         if (gate)
+            gate->yieldIfPending();
+
+         int next = i + 1 == k ? i + 2 : i + 1;
+         if (next < m_tiles)
+            for (int j = 0; j < m_tiles; j++)
+               prefetch(next, j);
+
+         double *Aik = acquire(i, k, true);
+         for (int j = 0; j < m_tiles; j++)
+         {
+            if (j == k)
+               continue;
+            double *Aij = acquire(i, j, true);
+            MatrixKernels::multiplyParallel(0, T, T, T, -1., Aik, T, rowK[j], T, 1., Aij, T);
+            release(i, j);
+         }
+
+         MatrixKernels::multiplyParallel(0, T, T, T, -1., Aik, T, D, T, 0., tmp.data(), T);
+         std::copy(tmp.begin(), tmp.end(), Aik);
+         release(i, k);
+      }
+
+      for (int j = 0; j < m_tiles; j++)
+         release(k, j);
+   }
+
+   unswapColumns(swaps.data(), swaps.size());
+
+   flush();
+   return 0;
+}
+
+void TiledMatrixFile::multiplyRowsLeft(int count, const double *rows, double *out)
+{
+   const int T = m_tileSize;
+   std::fill(out, out + (size_t)count * m_n, 0.);
+
+   for (int ti = 0; ti < m_tiles; ti++)
+   {
+      const int rEnd = std::min(T, m_n - ti * T);
+      for (int tj = 0; tj < m_tiles; tj++)
+      {
+         const int cEnd = std::min(T, m_n - tj * T);
+         const double *tile = acquire(ti, tj, false);
+         for (int s = 0; s < count; s++)
+         {
+            const double *a = rows + (size_t)s * m_n + ti * T;
+            double *o = out + (size_t)s * m_n + tj * T;
+            for (int r = 0; r < rEnd; r++)
+            {
+               const double coef = a[r];
+               const double *t = tile + (size_t)r * T;
+               for (int c = 0; c < cEnd; c++)
+                  o[c] += coef * t[c];
+            }
+         }
+         release(ti, tj);
+      }
+   }
+}
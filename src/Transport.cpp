@@ -0,0 +1,60 @@
+#include "Transport.h"
+#include <algorithm>
+#include <stdexcept>
+
+Transport::Transport(int rank, int size) : m_rank(rank), m_size(size)
+{
+   if (size < 1 || rank < 0 || rank >= size)
+      throw std::invalid_argument("Transport: rank " + std::to_string(rank) + " outside group of " + std::to_string(size));
+}
+
+void Transport::send(int dest, uint64_t tag, const double *data, size_t count)
+{
+   if (dest < 0 || dest >= m_size)
+      throw std::invalid_argument("Transport: no rank " + std::to_string(dest));
+   transmit(dest, tag, data, count);
+   m_bytesSent.fetch_add(count * sizeof(double), std::memory_order_relaxed);
+}
+
+void Transport::receive(int source, uint64_t tag, double *data, size_t count)
+{
+   std::vector<double> payload;
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto key = std::make_pair(source, tag);
+      m_arrived.wait(lock, [&]()
+                     { return m_inbox.count(key) || m_errors.count(source); });
+      auto it = m_inbox.find(key);
+      if (it == m_inbox.end())
+         throw std::runtime_error("Transport: " + m_errors[source]);
+
+      payload = std::move(it->second.front());
+      it->second.pop_front();
+      if (it->second.empty())
+         m_inbox.erase(it);
+   }
+
+   if (payload.size() != count)
+      throw std::runtime_error("Transport: message from rank " + std::to_string(source) + " has " +
+                               std::to_string(payload.size()) + " values, expected " + std::to_string(count));
+   std::copy(payload.begin(), payload.end(), data);
+   m_bytesReceived.fetch_add(count * sizeof(double), std::memory_order_relaxed);
+}
+
+void Transport::deliver(int source, uint64_t tag, std::vector<double> &&payload)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_inbox[std::make_pair(source, tag)].push_back(std::move(payload));
+   }
+   m_arrived.notify_all();
+}
+
+void Transport::fail(int source, const std::string &reason)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_errors.emplace(source, reason);
+   }
+   m_arrived.notify_all();
+}
@@ -0,0 +1,78 @@
+#include "Warmup.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netdb.h>
+#include <sys/mman.h>
+
+namespace
+{
+   double secondsSince(std::chrono::steady_clock::time_point start)
+   {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   }
+}
+
+bool Warmup::resolveHost(const std::string &uri)
+{
+   // scheme://host[:port][/path]
+   const size_t scheme = uri.find("://");
+   const size_t begin = scheme == std::string::npos ? 0 : scheme + 3;
+   const std::string host = uri.substr(begin, uri.find_first_of(":/", begin) - begin);
+
+   const auto start = std::chrono::steady_clock::now();
+   addrinfo hints = {};
+   hints.ai_family = AF_UNSPEC;
+   hints.ai_socktype = SOCK_STREAM;
+   addrinfo *result = nullptr;
+   const int status = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+   if (status != 0)
+   {
+      std::cerr << "Warmup: Cannot resolve " << host << ": " << gai_strerror(status) << std::endl;
+      return false;
+   }
+   int addresses = 0;
+   for (addrinfo *entry = result; entry; entry = entry->ai_next)
+      addresses++;
+   freeaddrinfo(result);
+   std::cout << "Warmup: Resolved " << host << " to " << addresses << " addresses in " << std::fixed
+             << std::setprecision(3) << secondsSince(start) * 1e3 << " ms" << std::endl;
+   return true;
+}
+
+bool Warmup::lockMemory()
+{
+   const auto start = std::chrono::steady_clock::now();
+   if (mlockall(MCL_CURRENT) != 0)
+   {
+      std::cerr << "Warmup: mlockall failed: " << strerror(errno) << " (raise RLIMIT_MEMLOCK or grant CAP_IPC_LOCK)" << std::endl;
+      return false;
+   }
+   std::cout << "Warmup: Memory locked in " << std::fixed << std::setprecision(3) << secondsSince(start) * 1e3
+             << " ms" << std::endl;
+   return true;
+}
+
+void Warmup::kernelPasses(int size, CalculationClass::Engine engine, CalculationClass::Options options, int passes)
+{
+   if (passes <= 0 || engine == CalculationClass::Engine::Distributed)
+      return;
+   options.gate = nullptr;
+   options.liveSize = nullptr;
+   options.distributed = nullptr;
+   options.perfCounters = false;
+
+   const auto start = std::chrono::steady_clock::now();
+   CalculationClass calculation(size, engine, options);
+   unsigned int seed = 1;
+   for (int pass = 0; pass < passes; pass++)
+   {
+      if (pass > 0)
+         calculation.reset(&seed);
+      calculation.invert();
+   }
+   std::cout << "Warmup: " << passes << " " << CalculationClass::engineName(engine) << " passes at " << size << "x"
+             << size << " in " << std::fixed << std::setprecision(3) << secondsSince(start) * 1e3 << " ms" << std::endl;
+}
@@ -1,10 +1,27 @@
 #include "WebSocketClass.h"
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
+#include <algorithm>
 
 std::mutex WebSocketClass::m_mutex;
 std::atomic<int> WebSocketClass::m_WebSocketRequestsCount(0);
 
+namespace
+{
+    const ConfigManager::Snapshot s_defaults;
+
+    // Steady state: the mean handling time of a window stays within
+    // kSteadyTolerance of the window before it
+    const int kSteadyWindow = 256;
+    const double kSteadyTolerance = 0.2;
+
+    const char *s_sampleUpdate =
+        R"({"arg":{"channel":"books5","instId":"BTC-USDT"},"data":[{)"
+        R"("asks":[["41006.8","0.60038921","0","1"],["41006.9","0.3","0","2"],["41007.1","1.2","0","3"],["41007.5","0.05","0","1"],["41008.0","2.1","0","4"]],)"
+        R"("bids":[["41006.3","0.30178218","0","2"],["41006.1","0.7","0","1"],["41005.8","0.9","0","2"],["41005.0","3.3","0","5"],["41004.2","0.4","0","1"]],)"
+        R"("instId":"BTC-USDT","ts":"1629966436396","seqId":3}]})";
+}
+
 std::string WebSocketClass::getCurrentUTCTimestamp()
 {
     auto now = std::chrono::system_clock::now();
@@ -20,10 +37,204 @@ std::string WebSocketClass::getCurrentUTCTimestamp()
     return oss.str();
 }
 
-void WebSocketClass::on_message(const std::string &response_data)
+void WebSocketClass::setConfig(RcuPointer<ConfigManager::Snapshot> &config)
 {
-    std::string timestamp = getCurrentUTCTimestamp();
-    std::cout << "WebSocketClass: Timestamp: " << timestamp << std::endl;
+    m_configReader.reset(new RcuPointer<ConfigManager::Snapshot>::Reader(config));
+    m_config = m_configReader->get();
+}
+
+void WebSocketClass::refreshConfig()
+{
+    if (!m_configReader)
+        return;
+
+    // Top of a feed event: nothing from an older snapshot is held any more
+    m_configReader->quiescent();
+    const ConfigManager::Snapshot *current = m_configReader->get();
+    if (current == m_config)
+        return;
+    m_config = current;
+    if (!m_open)
+        return;
+
+    auto contains = [](const std::vector<ConfigManager::Subscription> &list, const ConfigManager::Subscription &s)
+    {
+        for (const auto &entry : list)
+            if (entry.channel == s.channel && entry.instId == s.instId)
+                return true;
+        return false;
+    };
+    std::vector<ConfigManager::Subscription> removed, added;
+    for (const auto &s : m_subscribed)
+        if (!contains(m_config->feed.subscriptions, s))
+            removed.push_back(s);
+    for (const auto &s : m_config->feed.subscriptions)
+        if (!contains(m_subscribed, s))
+            added.push_back(s);
+    if (!removed.empty())
+        sendSubscriptionOp("unsubscribe", removed);
+    if (!added.empty())
+        sendSubscriptionOp("subscribe", added);
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_subscribed = m_config->feed.subscriptions;
+}
+
+void WebSocketClass::changeSubscription(const ConfigManager::Subscription &subscription, bool subscribe)
+{
+    // m_subscribed and the connection belong to the feed thread: run there
+    m_client.get_io_service().post([this, subscription, subscribe]()
+                                   {
+        auto same = [&](const ConfigManager::Subscription &s)
+        { return s.channel == subscription.channel && s.instId == subscription.instId; };
+        const bool present = std::any_of(m_subscribed.begin(), m_subscribed.end(), same);
+        if (present == subscribe)
+            return;
+        if (m_open)
+            sendSubscriptionOp(subscribe ? "subscribe" : "unsubscribe", {subscription});
+
+        {
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            if (subscribe)
+            {
+                m_subscribed.push_back(subscription);
+                return;
+            }
+            m_subscribed.erase(std::remove_if(m_subscribed.begin(), m_subscribed.end(), same), m_subscribed.end());
+        }
+        if (std::none_of(m_subscribed.begin(), m_subscribed.end(), [&](const ConfigManager::Subscription &s)
+                         { return s.instId == subscription.instId; }))
+        {
+            const auto book = m_books.find(subscription.instId);
+            if (book != m_books.end())
+                m_books.erase(book);
+            publishBooks();
+        } });
+}
+
+std::vector<ConfigManager::Subscription> WebSocketClass::subscriptions() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    return m_subscribed;
+}
+
+std::map<std::string, WebSocketClass::BookView> WebSocketClass::books() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    return m_publishedBooks;
+}
+
+void WebSocketClass::publishBooks()
+{
+    m_booksPublished = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_publishedBooks.clear();
+    m_publishedBooks.insert(m_books.begin(), m_books.end());
+}
+
+void WebSocketClass::updateBook(const nlohmann::json &message, std::chrono::system_clock::time_point received,
+                                std::chrono::steady_clock::time_point receivedSteady)
+{
+    const auto &update = message["data"][0];
+    long long exchangeTs = 0;
+    if (update.contains("ts") && update["ts"].is_string())
+    {
+        exchangeTs = std::strtoll(update["ts"].get_ref<const std::string &>().c_str(), nullptr, 10);
+        const long long receivedUs = std::chrono::duration_cast<std::chrono::microseconds>(received.time_since_epoch()).count();
+        // Clocks are only as close as NTP keeps them; never record a negative latency
+        m_exchangeLatency.record((uint64_t)std::max(0LL, receivedUs - exchangeTs * 1000));
+    }
+    if (!message.contains("arg") || !message["arg"].contains("instId"))
+        return;
+
+    // The feed thread owns m_books; readers get a copy published every kBookPublishInterval
+    const std::string &instId = message["arg"]["instId"].get_ref<const std::string &>();
+    auto book = m_books.find(instId);
+    if (book == m_books.end())
+        book = m_books.emplace(instId, BookView()).first;
+    decodeBook(update, book->second);
+    book->second.exchangeTs = exchangeTs;
+    m_lastUpdateTicks.store(receivedSteady.time_since_epoch().count(), std::memory_order_release);
+    if (std::chrono::steady_clock::now() - m_booksPublished >= kBookPublishInterval)
+        publishBooks();
+}
+
+void WebSocketClass::decodeBook(const nlohmann::json &update, BookView &book)
+{
+    // Assigned in place, so a price reuses the string's buffer from the last update
+    auto setTop = [&update](const char *name, size_t &levels, std::string &best)
+    {
+        const auto side = update.find(name);
+        levels = side != update.end() ? side->size() : 0;
+        if (side == update.end() || !side->is_array() || side->empty() || !(*side)[0].is_array() ||
+            (*side)[0].empty() || !(*side)[0][0].is_string())
+            best.clear();
+        else
+            best.assign((*side)[0][0].get_ref<const std::string &>());
+    };
+    setTop("asks", book.askLevels, book.bestAsk);
+    setTop("bids", book.bidLevels, book.bestBid);
+    book.updates++;
+}
+
+void WebSocketClass::prewarm(int decodePasses)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_tlsContext = on_tls_init();
+    BookView scratch;
+    for (int pass = 0; pass < decodePasses; pass++)
+    {
+        const nlohmann::json message = nlohmann::json::parse(s_sampleUpdate);
+        decodeBook(message["data"][0], scratch);
+    }
+    std::cout << "WebSocketClass: TLS context and " << decodePasses << " decode passes in " << std::fixed
+              << std::setprecision(3) << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms" << std::endl;
+}
+
+void WebSocketClass::trackSteadyState(long long handleNs)
+{
+    m_windowNs += handleNs;
+    if (++m_windowCount < kSteadyWindow)
+        return;
+    const long long previous = m_previousWindowNs;
+    m_previousWindowNs = m_windowNs;
+    m_windowNs = 0;
+    m_windowCount = 0;
+    if (previous == 0 || std::abs(m_previousWindowNs - previous) > kSteadyTolerance * previous)
+        return;
+
+    const long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+    m_steadyStateUs.store(elapsed);
+    std::cout << "WebSocketClass: Steady state after " << elapsed / 1000 << " ms, mean handling "
+              << m_previousWindowNs / kSteadyWindow << " ns" << std::endl;
+}
+
+void WebSocketClass::sendSubscriptionOp(const char *op, const std::vector<ConfigManager::Subscription> &subscriptions)
+{
+    nlohmann::ordered_json args = nlohmann::ordered_json::array();
+    for (const auto &s : subscriptions)
+        args.push_back({{"channel", s.channel}, {"instId", s.instId}});
+    const std::string frame = nlohmann::ordered_json({{"op", op}, {"args", args}}).dump();
+
+    websocketpp::lib::error_code ec;
+    m_client.send(m_hdl, frame, websocketpp::frame::opcode::text, ec);
+    std::cout << "WebSocketClass: " << op << " " << args.dump() << (ec ? " failed: " + ec.message() : "") << std::endl;
+}
+
+void WebSocketClass::on_message(const std::string &response_data, std::chrono::system_clock::time_point received,
+                                std::chrono::steady_clock::time_point receivedSteady)
+{
+    refreshConfig();
+    if (m_capture)
+        m_capture->record(std::chrono::duration_cast<std::chrono::nanoseconds>(received.time_since_epoch()).count(), response_data);
+
+    // Book updates print at info and below; counting never stops
+    const bool printBook = m_config->logging.level <= ConfigManager::LogLevel::Info;
+    if (printBook)
+    {
+        std::string timestamp = getCurrentUTCTimestamp();
+        std::cout << "WebSocketClass: Timestamp: " << timestamp << std::endl;
+    }
 
     nlohmann::json json_data = nlohmann::json::parse(response_data);
 
@@ -32,37 +243,48 @@ void WebSocketClass::on_message(const std::string &response_data)
         const auto &data = json_data["data"];
         if (data.is_array() && !data.empty())
         {
-            const auto &asks_data = data[0]["asks"];
-            std::cout << "WebSocketClass: Asks:\n";
-            for (const auto ask : asks_data)
+            updateBook(json_data, received, receivedSteady);
+            if (m_firstUpdateUs.load(std::memory_order_relaxed) < 0)
             {
-                std::cout << "  Depth Price: " << ask[0] << std::endl;
-                std::cout << "  Quantity: " << ask[1] << std::endl;
-                std::cout << "  Deprecated Value: " << ask[2] << std::endl;
-                std::cout << "  Number of Orders: " << ask[3] << std::endl;
+                const long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+                m_firstUpdateUs.store(elapsed);
+                std::cout << "WebSocketClass: First book update after " << elapsed / 1000 << " ms" << std::endl;
             }
-
-            const auto &bids_data = data[0]["bids"];
-            std::cout << "WebSocketClass: Bids:\n";
-            for (const auto &bid : bids_data)
+            if (printBook)
             {
-                std::cout << "  Depth Price: " << bid[0] << std::endl;
-                std::cout << "  Quantity: " << bid[1] << std::endl;
-                std::cout << "  Deprecated Value: " << bid[2] << std::endl;
-                std::cout << "  Number of Orders: " << bid[3] << std::endl;
+                const auto &asks_data = data[0]["asks"];
+                std::cout << "WebSocketClass: Asks:\n";
+                for (const auto ask : asks_data)
+                {
+                    std::cout << "  Depth Price: " << ask[0] << std::endl;
+                    std::cout << "  Quantity: " << ask[1] << std::endl;
+                    std::cout << "  Deprecated Value: " << ask[2] << std::endl;
+                    std::cout << "  Number of Orders: " << ask[3] << std::endl;
+                }
+
+                const auto &bids_data = data[0]["bids"];
+                std::cout << "WebSocketClass: Bids:\n";
+                for (const auto &bid : bids_data)
+                {
+                    std::cout << "  Depth Price: " << bid[0] << std::endl;
+                    std::cout << "  Quantity: " << bid[1] << std::endl;
+                    std::cout << "  Deprecated Value: " << bid[2] << std::endl;
+                    std::cout << "  Number of Orders: " << bid[3] << std::endl;
+                }
             }
             {
                 std::lock_guard<std::mutex> lock(m_mutex);
                 m_WebSocketRequestsCount++;
-                std::cout << "WebSocketClass: Request # " << m_WebSocketRequestsCount << " completed\n\n";
+                if (printBook)
+                    std::cout << "WebSocketClass: Request # " << m_WebSocketRequestsCount << " completed\n\n";
             }
         }
-        else
+        else if (m_config->logging.level <= ConfigManager::LogLevel::Warn)
         {
             std::cerr << "WebSocketClass: No data available in the response." << std::endl;
         }
     }
-    else
+    else if (m_config->logging.level <= ConfigManager::LogLevel::Warn)
     {
         std::cerr << "WebSocketClass: Invalid response format." << std::endl;
     }
@@ -70,6 +292,8 @@ void WebSocketClass::on_message(const std::string &response_data)
 
 context_ptr WebSocketClass::on_tls_init()
 {
+    if (m_tlsContext)
+        return m_tlsContext;
     context_ptr ctx = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
     try
     {
@@ -85,34 +309,74 @@ context_ptr WebSocketClass::on_tls_init()
     return ctx;
 }
 
-void WebSocketClass::on_open(client *m_client, websocketpp::connection_hdl hdl)
+void WebSocketClass::on_open(websocketpp::connection_hdl hdl)
 {
-    std::string subscribe_msg = R"({"op":"subscribe","args":[{"channel":"bbo-tbt","instId":"BTC-USDT"}]})";
+    refreshConfig();
+    m_hdl = hdl;
+    m_open = true;
+    // Bytes waiting on the socket preempt calculations before the handler runs
+    if (m_gate)
+        m_gate->watch(m_client.get_con_from_hdl(hdl)->get_socket().lowest_layer().native_handle());
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_subscribed = m_config->feed.subscriptions;
+    }
     websocketpp::lib::error_code ec;
-    m_client->send(hdl, subscribe_msg, websocketpp::frame::opcode::text, ec);
+    m_client.send(hdl, m_config->feed.subscribe_message, websocketpp::frame::opcode::text, ec);
     if (ec)
     {
         std::cout << "WebSocketClass: subscription failed: " << ec.message() << std::endl;
     }
 }
 
-WebSocketClass::WebSocketClass(const std::string &uri, std::atomic<int> &WebSocketRequestsCount, std::mutex &mutex) : m_uri(uri)
+void WebSocketClass::on_socket_init(websocketpp::connection_hdl hdl, boost::asio::ssl::stream<boost::asio::ip::tcp::socket> &socket)
+{
+    refreshConfig();
+    boost::system::error_code ec;
+    socket.lowest_layer().set_option(boost::asio::ip::tcp::no_delay(m_config->socket.tcp_nodelay), ec);
+    if (m_config->socket.receive_buffer_bytes > 0)
+        socket.lowest_layer().set_option(boost::asio::socket_base::receive_buffer_size(m_config->socket.receive_buffer_bytes), ec);
+    if (ec)
+    {
+        std::cout << "WebSocketClass: Socket option failed: " << ec.message() << std::endl;
+    }
+}
+
+WebSocketClass::WebSocketClass(const std::string &uri, std::atomic<int> &WebSocketRequestsCount, std::mutex &mutex) : m_uri(uri), m_config(&s_defaults)
 {
     m_client.set_access_channels(websocketpp::log::alevel::all);
     m_client.clear_access_channels(websocketpp::log::alevel::frame_payload);
 
     m_client.init_asio();
-    m_client.set_tls_init_handler(bind(&WebSocketClass::on_tls_init));
+    m_client.set_tls_init_handler([this](websocketpp::connection_hdl)
+                                  { return on_tls_init(); });
 
     m_client.set_message_handler([this](websocketpp::connection_hdl hdl, message_ptr msg)
-                                 { on_message(msg->get_payload()); });
-    m_client.set_open_handler(bind(&on_open, &m_client, ::_1));
+                                 { PreemptionGate::Scope scope(m_gate);
+                                   const auto received = std::chrono::system_clock::now();
+                                   const auto start = std::chrono::steady_clock::now();
+                                   on_message(msg->get_payload(), received, start);
+                                   const long long handleNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                                   m_handleLatency.record(handleNs);
+                                   if (m_steadyStateUs.load(std::memory_order_relaxed) < 0)
+                                       trackSteadyState(handleNs); });
+    m_client.set_open_handler([this](websocketpp::connection_hdl hdl)
+                              { on_open(hdl); });
+    m_client.set_close_handler([this](websocketpp::connection_hdl)
+                               { m_open = false;
+                                 if (m_gate)
+                                     m_gate->watch(-1); });
+    m_client.set_socket_init_handler([this](websocketpp::connection_hdl hdl, boost::asio::ssl::stream<boost::asio::ip::tcp::socket> &socket)
+                                     { on_socket_init(hdl, socket); });
 }
 
 void WebSocketClass::wsrun(std::atomic<bool> &flag)
 {
     try
     {
+        if (!m_config->logging.access_log)
+            m_client.clear_access_channels(websocketpp::log::alevel::all);
+
         websocketpp::lib::error_code ec;
         client::connection_ptr con = m_client.get_connection(m_uri, ec);
         if (ec)
@@ -0,0 +1,337 @@
+#include "WorkerProcessPool.h"
+#include "MatrixKernels.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+   // Descriptor number of the job socket in the worker
+   constexpr int kWorkerFd = 3;
+}
+
+WorkerProcessPool::Job::Job(CalculationService::JobType type, int aRows, int aCols, int bRows, int bCols,
+                            double decay)
+{
+   memset(&m_message, 0, sizeof(m_message));
+   m_message.magic = CalculationWorker::kMagic;
+   m_message.type = (uint32_t)type;
+   m_message.aRows = aRows;
+   m_message.aCols = aCols;
+   m_message.bRows = bRows;
+   m_message.bCols = bCols;
+   m_message.decay = decay;
+   m_message.bytes = CalculationWorker::bufferBytes(m_message, &m_resultOffset);
+   CalculationService::resultShape(type, aRows, aCols, bRows, bCols, m_resultRows, m_resultCols);
+   m_buffer.reset(new SharedMemoryBuffer(m_message.bytes));
+}
+
+WorkerProcessPool::WorkerProcessPool(const std::string &binary, int processes, const std::vector<int> &cpus)
+    : m_binary(binary), m_processes(processes < 1 ? 1 : processes), m_slots(m_processes), m_stopping(false)
+{
+   for (int i = 0; i < m_processes; i++)
+   {
+      if (!cpus.empty())
+         m_slots[i].cpu = cpus[i % cpus.size()];
+      m_stats.push_back(std::make_unique<WorkerStats>());
+   }
+}
+
+WorkerProcessPool::~WorkerProcessPool()
+{
+   stop();
+}
+
+bool WorkerProcessPool::spawn(int index)
+{
+   Slot &slot = m_slots[index];
+   int fds[2];
+   if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0)
+   {
+      std::cerr << "WorkerProcessPool: socketpair failed: " << strerror(errno) << std::endl;
+      return false;
+   }
+
+   // Everything the child needs is prepared before fork(); after it only
+   // async-signal-safe calls are allowed.
+   const MatrixKernels::Tuning &tuning = MatrixKernels::tuning();
+   std::vector<std::string> args = {m_binary, "--fd", std::to_string(kWorkerFd),
+                                    "--isa", MatrixKernels::isaName(MatrixKernels::isa()),
+                                    "--gemm-block", std::to_string(tuning.gemmBlock),
+                                    "--gemm-unroll", std::to_string(tuning.gemmUnroll)};
+   std::vector<char *> argv;
+   for (auto &arg : args)
+      argv.push_back(&arg[0]);
+   argv.push_back(nullptr);
+
+   cpu_set_t cpus;
+   CPU_ZERO(&cpus);
+   if (slot.cpu >= 0)
+      CPU_SET(slot.cpu, &cpus);
+
+   pid_t pid = fork();
+   if (pid < 0)
+   {
+      std::cerr << "WorkerProcessPool: fork failed: " << strerror(errno) << std::endl;
+      close(fds[0]);
+      close(fds[1]);
+      return false;
+   }
+   if (pid == 0)
+   {
+      if (slot.cpu >= 0)
+         sched_setaffinity(0, sizeof(cpus), &cpus);
+      if (fds[1] == kWorkerFd)
+         fcntl(kWorkerFd, F_SETFD, 0);
+      else
+         dup2(fds[1], kWorkerFd);
+      execv(argv[0], argv.data());
+      _exit(127);
+   }
+
+   close(fds[1]);
+   slot.pid = pid;
+   slot.socket = fds[0];
+   return true;
+}
+
+void WorkerProcessPool::reap(int index)
+{
+   Slot &slot = m_slots[index];
+   if (slot.socket >= 0)
+      close(slot.socket);
+   slot.socket = -1;
+   if (slot.pid > 0)
+   {
+      // Closing the socket is the worker's signal to exit; a stuck one is killed
+      int status;
+      const Clock::time_point deadline = Clock::now() + kStopGrace;
+      while (waitpid(slot.pid, &status, WNOHANG) == 0)
+      {
+         if (Clock::now() > deadline)
+         {
+            std::cerr << "WorkerProcessPool: Worker " << index << " did not exit, killing it" << std::endl;
+            kill(slot.pid, SIGKILL);
+            waitpid(slot.pid, &status, 0);
+            break;
+         }
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      if (WIFSIGNALED(status))
+         std::cerr << "WorkerProcessPool: Worker " << index << " killed by signal " << WTERMSIG(status) << std::endl;
+      else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+         std::cerr << "WorkerProcessPool: Worker " << index << " exited with status " << WEXITSTATUS(status) << std::endl;
+   }
+   slot.pid = -1;
+}
+
+void WorkerProcessPool::start()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_stopping = false;
+   }
+   for (int i = 0; i < m_processes; i++)
+   {
+      if (!spawn(i))
+         throw std::runtime_error("WorkerProcessPool: cannot start worker " + m_binary);
+      m_threads.emplace_back(&WorkerProcessPool::dispatchLoop, this, i);
+   }
+   std::cout << "WorkerProcessPool: Started " << m_processes << " worker processes (" << m_binary << ")" << std::endl;
+}
+
+void WorkerProcessPool::stop()
+{
+   std::deque<Pending> leftover;
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_stopDeadline = (Clock::now() + kStopGrace).time_since_epoch().count();
+      m_stopping = true;
+      leftover.swap(m_queue);
+   }
+   m_jobReady.notify_all();
+   for (auto &thread : m_threads)
+      if (thread.joinable())
+         thread.join();
+   m_threads.clear();
+
+   for (int i = 0; i < m_processes; i++)
+      reap(i);
+
+   for (auto &pending : leftover)
+   {
+      Outcome outcome;
+      outcome.status = CalculationService::Status::Expired;
+      pending.promise.set_value(outcome);
+   }
+}
+
+std::future<WorkerProcessPool::Outcome> WorkerProcessPool::submit(std::shared_ptr<Job> job)
+{
+   Pending pending;
+   pending.job = std::move(job);
+   pending.enqueued = Clock::now();
+   std::future<Outcome> future = pending.promise.get_future();
+   {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_queue.push_back(std::move(pending));
+   }
+   m_jobReady.notify_one();
+   return future;
+}
+
+void WorkerProcessPool::restart(int index)
+{
+   reap(index);
+   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   if (!m_stopping && spawn(index))
+      m_stats[index]->restarts++;
+}
+
+bool WorkerProcessPool::idleWorkerLost(int index) const
+{
+   // An idle worker never writes, so a readable or hung-up socket means it is gone
+   const Slot &slot = m_slots[index];
+   if (slot.socket < 0)
+      return true;
+   struct pollfd entry = {slot.socket, POLLIN, 0};
+   return poll(&entry, 1, 0) != 0;
+}
+
+bool WorkerProcessPool::awaitReply(int index, CalculationWorker::ReplyMessage &reply)
+{
+   Slot &slot = m_slots[index];
+   struct pollfd entry = {slot.socket, POLLIN, 0};
+   while (true)
+   {
+      const int ready = poll(&entry, 1, 100);
+      if (ready > 0)
+         return CalculationWorker::receiveReply(slot.socket, reply);
+      if (ready < 0 && errno != EINTR)
+         return false;
+      if (m_stopping && Clock::now().time_since_epoch().count() > m_stopDeadline)
+      {
+         std::cerr << "WorkerProcessPool: Worker " << index << " still busy at stop, killing it" << std::endl;
+         kill(slot.pid, SIGKILL);
+         return false;
+      }
+   }
+}
+
+void WorkerProcessPool::dispatchLoop(int index)
+{
+   WorkerStats &stats = *m_stats[index];
+   while (true)
+   {
+      Pending pending;
+      {
+         std::unique_lock<std::mutex> lock(m_queueMutex);
+         if (!m_jobReady.wait_for(lock, kIdleCheck, [&]()
+                                  { return m_stopping || !m_queue.empty(); }))
+         {
+            lock.unlock();
+            if (idleWorkerLost(index))
+            {
+               std::cerr << "WorkerProcessPool: Idle worker " << index << " lost, restarting" << std::endl;
+               restart(index);
+            }
+            continue;
+         }
+         if (m_stopping)
+            return;
+         pending = std::move(m_queue.front());
+         m_queue.pop_front();
+      }
+
+      Outcome outcome;
+      const Clock::time_point start = Clock::now();
+      outcome.queueDelay = std::chrono::duration_cast<std::chrono::microseconds>(start - pending.enqueued);
+
+      Slot &slot = m_slots[index];
+      CalculationWorker::JobMessage message = pending.job->m_message;
+      message.id = m_nextId++;
+      CalculationWorker::ReplyMessage reply;
+      const bool answered = slot.socket >= 0 &&
+                            CalculationWorker::sendJob(slot.socket, message, pending.job->m_buffer->fd()) &&
+                            awaitReply(index, reply) && reply.id == message.id;
+      outcome.execTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+      stats.busyMicros += outcome.execTime.count();
+
+      if (answered && reply.status == CalculationWorker::Done)
+      {
+         outcome.status = CalculationService::Status::Done;
+         stats.completed++;
+      }
+      else
+         stats.failed++;
+
+      if (!answered)
+      {
+         // The worker died or broke the protocol: fail this job, start a fresh one
+         std::cerr << "WorkerProcessPool: Worker " << index << " lost, restarting" << std::endl;
+         restart(index);
+      }
+      pending.promise.set_value(outcome);
+   }
+}
+
+void WorkerProcessPool::run(std::atomic<bool> &flag, std::atomic<int> &heavyTasksCount, std::mutex &mutex,
+                            int matrixSize)
+{
+   // Keep every worker busy with a second job queued behind it
+   const size_t depth = 2 * (size_t)m_processes;
+   const auto started = Clock::now();
+   std::deque<std::pair<std::shared_ptr<Job>, std::future<Outcome>>> inFlight;
+   while (!flag || !inFlight.empty())
+   {
+      while (!flag && inFlight.size() < depth)
+      {
+         auto job = std::make_shared<Job>(CalculationService::JobType::Invert, matrixSize, matrixSize);
+         double *a = job->a();
+         for (size_t q = 0; q < (size_t)matrixSize * matrixSize; q++)
+            a[q] = double(rand() % 10000) / double(1000);
+         std::future<Outcome> future = submit(job);
+         inFlight.emplace_back(std::move(job), std::move(future));
+      }
+
+      Outcome outcome = inFlight.front().second.get();
+      inFlight.pop_front();
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cout << "WorkerProcessPool: Invert " << matrixSize << "x" << matrixSize << " "
+                << CalculationService::statusName(outcome.status) << ", queued " << outcome.queueDelay.count()
+                << " us, ran " << outcome.execTime.count() << " us" << std::endl;
+      if (outcome.status == CalculationService::Status::Done)
+         std::cout << "WorkerProcessPool: Calculation #" << heavyTasksCount++ << std::endl;
+   }
+   m_runMicros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+   std::cout << "WorkerProcessPool: Finished!\n\n";
+}
+
+void WorkerProcessPool::printStats() const
+{
+   const double seconds = m_runMicros / 1e6;
+   int total = 0;
+   for (int i = 0; i < m_processes; i++)
+   {
+      const WorkerStats &stats = *m_stats[i];
+      total += stats.completed;
+      std::cout << "WorkerProcessPool: Worker " << i;
+      if (m_slots[i].cpu >= 0)
+         std::cout << " (cpu " << m_slots[i].cpu << ")";
+      std::cout << ": " << stats.completed << " completed, " << stats.failed << " failed, "
+                << stats.restarts << " restarts, busy " << std::fixed << std::setprecision(2)
+                << stats.busyMicros / 1e6 << " s" << std::endl;
+   }
+   std::cout << "WorkerProcessPool: Total " << total << " completed, " << std::fixed << std::setprecision(2)
+             << (seconds > 0 ? total / seconds : 0.) << " jobs/s over " << seconds << " s with " << m_processes << " processes" << std::endl;
+}
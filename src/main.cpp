@@ -4,98 +4,564 @@
 #include <chrono>
 #include <mutex>
 #include <cstdlib>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include "AdminServer.h"
 #include "CalculationClass.h"
+#include "CalculationPool.h"
+#include "CalculationService.h"
+#include "WorkerProcessPool.h"
+#include "DistributedInverter.h"
+#include "LoopbackTransport.h"
+#include "OrderGateway.h"
+#include "OrderStateEngine.h"
+#include "PrivateChannel.h"
+#include "TcpTransport.h"
 #include "WebSocketClass.h"
 #include "ConfigManager.h"
+#include "ConfigWatcher.h"
+#include "KernelTuner.h"
+#include "Supervisor.h"
+#include "Warmup.h"
 
-int main()
+static int parsePositive(const std::vector<std::string> &args, const char *usage)
 {
+   if (args.size() != 1 || args[0].find_first_not_of("0123456789") != std::string::npos || args[0].size() > 9 ||
+       std::stoi(args[0]) < 1)
+      throw std::invalid_argument(std::string("usage: ") + usage);
+   return std::stoi(args[0]);
+}
+
+static double parsePrice(const std::string &text)
+{
+   char *end = nullptr;
+   const double value = std::strtod(text.c_str(), &end);
+   if (text.empty() || *end != '\0' || !(value > 0))
+      throw std::invalid_argument("not a positive number: " + text);
+   return value;
+}
+
+static uint64_t parseClientId(const std::string &text)
+{
+   if (text.empty() || text.size() > 19 || text.find_first_not_of("0123456789") != std::string::npos)
+      throw std::invalid_argument("not a client id number: " + text);
+   return std::stoull(text);
+}
+
+// Registers every component with the supervisor and runs them. configManager is
+// null when running on the built-in defaults; reloads are then off. configDir
+// also holds the per-host kernel tuning cache
+static void runConnector(ConfigManager *configManager, const ConfigManager::Snapshot &config,
+                         const std::string &configDir, std::chrono::steady_clock::time_point processStart)
+{
+   const auto &okxConfig = config.connectors.OKXDataSrc;
+   const auto &calcConfig = config.calculation;
+   const auto &threading = config.threading;
+   const auto &warmup = config.warmup;
+   const std::string uri = okxConfig.url_pub;
+
+   srand(time(0));
+   std::atomic<int> WebSocketRequestsCount(0);
+   std::atomic<int> heavyTasksCount(0);
+   std::mutex mutex;
+   CalculationClass::Options calcOptions;
+   calcOptions.tileSize = calcConfig.tile_size;
+   calcOptions.cacheTiles = calcConfig.tile_cache_tiles;
+   calcOptions.scratchDir = calcConfig.scratch_dir;
+   calcOptions.perfCounters = calcConfig.perf_counters;
+   calcOptions.density = calcConfig.matrix_density;
+   calcOptions.sparseThreshold = calcConfig.sparse_threshold;
+
+   // Matrix size follows config reloads from the next inversion on
+   std::atomic<int> liveMatrixSize(calcConfig.matrix_size);
+   calcOptions.liveSize = &liveMatrixSize;
+   if (configManager)
+      configManager->addReloadListener([&liveMatrixSize](const ConfigManager::Snapshot &reloaded)
+                                       { liveMatrixSize.store(reloaded.calculation.matrix_size); });
+
+   // Feed data preempts the calculation at its preemption points when enabled
+   PreemptionGate preemptionGate;
+   if (calcConfig.preempt_columns > 0)
+   {
+      calcOptions.gate = &preemptionGate;
+      calcOptions.preemptColumns = calcConfig.preempt_columns;
+   }
+   const auto engine = CalculationClass::engineFromString(calcConfig.engine);
+
+   std::unique_ptr<Transport> nodeTransport;
+   std::vector<std::unique_ptr<LoopbackTransport>> loopbackNodes;
+   std::vector<std::thread> loopbackThreads;
+   std::unique_ptr<DistributedInverter> distributed;
+   std::unique_ptr<CalculationClass> Calculation;
+   std::unique_ptr<CalculationPool> pool;
+   std::unique_ptr<CalculationService> service;
+   std::unique_ptr<WorkerProcessPool> workerProcesses;
+   std::unique_ptr<ConfigWatcher> configWatcher;
+   std::unique_ptr<PrivateChannel> privateChannel;
+   std::unique_ptr<OrderGateway> orderGateway;
+   std::unique_ptr<OrderStateEngine> orderStates;
+
+   WebSocketClass webSocket(uri, WebSocketRequestsCount, mutex);
+   webSocket.setStartTime(processStart);
+   webSocket.setPreemptionGate(calcOptions.gate);
+   if (configManager)
+      webSocket.setConfig(configManager->getLiveSnapshot());
+   if (!config.feed.capture_path.empty())
+      webSocket.setCapture(std::make_unique<FeedCapture>(config.feed.capture_path));
+   AdminServer admin(config.admin.socket_path);
+
+   Supervisor supervisor;
+
+   Supervisor::Component kernels;
+   kernels.name = "kernels";
+   kernels.start = [&]()
+   {
+      // Kernel variants from cpuid, optionally capped, before tuning benchmarks them
+      if (calcConfig.kernel_isa != "auto")
+         MatrixKernels::setIsa(MatrixKernels::isaFromString(calcConfig.kernel_isa));
+      std::cout << "MatrixKernels: Using " << MatrixKernels::isaName(MatrixKernels::isa())
+                << " kernels (cpu supports " << MatrixKernels::isaName(MatrixKernels::detectIsa()) << ")" << std::endl;
+      // Kernel parameters: per-host cache, or benchmark now if enabled
+      MatrixKernels::setTuning(KernelTuner::loadOrTune(configDir, calcConfig.autotune));
+   };
+   kernels.health = []()
+   { return std::string(MatrixKernels::isaName(MatrixKernels::isa())); };
+   supervisor.add(kernels);
+
+   Supervisor::Component calculation;
+   calculation.name = "calculation";
+   calculation.dependsOn = {"kernels"};
+   if (engine == CalculationClass::Engine::Distributed)
+   {
+      // This process is rank 0 of the listed nodes, or of in-process stand-ins
+      Supervisor::Component nodes;
+      nodes.name = "distributed";
+      nodes.dependsOn = {"kernels"};
+      nodes.start = [&]()
+      {
+         if (!calcConfig.distributed_nodes.empty())
+            nodeTransport = std::make_unique<TcpTransport>(0, calcConfig.distributed_nodes,
+                                                           DistributedInverter::maxMessage(calcConfig.tile_size));
+         else
+         {
+            loopbackNodes = LoopbackTransport::createGroup(std::max(2, calcConfig.distributed_loopback));
+            for (size_t rank = 1; rank < loopbackNodes.size(); rank++)
+               loopbackThreads.emplace_back([&loopbackNodes, rank]()
+                                            { DistributedInverter(*loopbackNodes[rank], 0).serve(); });
+         }
+         Transport &transport = nodeTransport ? *nodeTransport : static_cast<Transport &>(*loopbackNodes[0]);
+         distributed = std::make_unique<DistributedInverter>(transport, calcConfig.tile_size);
+         calcOptions.distributed = distributed.get();
+         std::cout << "DistributedInverter: " << transport.size() << " nodes ("
+                   << (nodeTransport ? "tcp" : "loopback") << ")" << std::endl;
+      };
+      nodes.stop = [&]()
+      {
+         if (distributed)
+            distributed->shutdown();
+         for (auto &node : loopbackThreads)
+            node.join();
+      };
+      supervisor.add(nodes);
+      calculation.dependsOn.push_back("distributed");
+   }
+   // The job service, worker processes or the throughput pool replace the single calculation loop
+   calculation.start = [&]()
+   {
+      if (calcConfig.service_workers > 0)
+      {
+         service = std::make_unique<CalculationService>();
+         service->enableCache((size_t)calcConfig.result_cache_mb << 20);
+         service->start(calcConfig.service_workers);
+      }
+      else if (calcConfig.worker_processes > 0)
+      {
+         workerProcesses = std::make_unique<WorkerProcessPool>(calcConfig.worker_binary, calcConfig.worker_processes,
+                                                               calcConfig.worker_cpus);
+         workerProcesses->start();
+      }
+      else if (calcConfig.workers > 0 && !distributed)  // One coordinator, one inversion at a time
+         pool = std::make_unique<CalculationPool>(calcConfig.workers, calcConfig.matrix_size, engine, calcOptions);
+      else
+         Calculation = std::make_unique<CalculationClass>(calcConfig.matrix_size, engine, calcOptions);
+   };
+   calculation.run = [&](std::atomic<bool> &flag)
+   {
+      if (service)
+         service->run(flag, heavyTasksCount, mutex, calcConfig.matrix_size,
+                      std::chrono::milliseconds(calcConfig.job_deadline_ms));
+      else if (workerProcesses)
+         workerProcesses->run(flag, heavyTasksCount, mutex, calcConfig.matrix_size);
+      else if (pool)
+         pool->run(flag, mutex);
+      else
+         Calculation->run(flag, heavyTasksCount, mutex);
+   };
+   calculation.stop = [&]()
+   {
+      if (service)
+         service->stop();
+      if (workerProcesses)
+         workerProcesses->stop();
+   };
+   calculation.health = [&]()
+   { return "calculations " + std::to_string(pool ? pool->totalCompleted() : heavyTasksCount.load()); };
+   calculation.cpu = threading.calculation_cpu;
+   supervisor.add(calculation);
+
+   if (configManager)
+   {
+      Supervisor::Component watcher;
+      watcher.name = "config-watcher";
+      watcher.optional = true;
+      watcher.start = [&]()
+      {
+         configWatcher = std::make_unique<ConfigWatcher>(*configManager);
+         configWatcher->start();
+      };
+      watcher.stop = [&]()
+      { configWatcher->stop(); };
+      watcher.health = [&]()
+      { return "reloads " + std::to_string(configWatcher->reloads()) + " rejected " + std::to_string(configWatcher->rejected()); };
+      supervisor.add(watcher);
+   }
+
+   // First-use costs of the feed are paid at startup, before readiness
+   Supervisor::Component feed;
+   feed.name = "feed";
+   feed.start = [&]()
+   {
+      if (warmup.resolve_dns)
+         Warmup::resolveHost(uri);
+      webSocket.prewarm(warmup.decode_passes);
+   };
+   feed.run = [&](std::atomic<bool> &flag)
+   { webSocket.wsrun(flag); };
+   feed.health = [&]()
+   { return "messages " + std::to_string(webSocket.m_WebSocketRequestsCount.load()) +
+            " first_update_us " + std::to_string(webSocket.timeToFirstUpdateUs()); };
+   feed.cpu = threading.feed_cpu;
+   supervisor.add(feed);
+
+   // Raises the gate as soon as feed data is readable, before the feed thread picks it up
+   if (calcOptions.gate)
+   {
+      Supervisor::Component readiness;
+      readiness.name = "preempt-watch";
+      readiness.dependsOn = {"feed"};
+      readiness.run = [&](std::atomic<bool> &flag)
+      { preemptionGate.runWatcher(flag); };
+      readiness.health = [&]()
+      { return "readable " + std::to_string(preemptionGate.readableSignals()) +
+               " yields " + std::to_string(preemptionGate.yields()); };
+      supervisor.add(readiness);
+   }
+
+   // Logged in on every (re)connect; nothing to do without credentials
+   if (!okxConfig.API_key.empty())
+   {
+      Supervisor::Component account;
+      account.name = "private";
+      account.optional = true;
+      account.start = [&]()
+      { privateChannel = std::make_unique<PrivateChannel>(okxConfig, config.socket); };
+      account.run = [&](std::atomic<bool> &flag)
+      { privateChannel->run(flag); };
+      account.health = [&]()
+      { return std::string(privateChannel->loggedIn() ? "logged_in" : "logged_out") +
+               " logins " + std::to_string(privateChannel->logins()) +
+               " reconnects " + std::to_string(privateChannel->reconnects()) +
+               " sign_ns " + std::to_string(privateChannel->lastSignNs()) +
+               " login_us " + std::to_string(privateChannel->lastLoginUs()); };
+      supervisor.add(account);
+
+      if (config.orders.enabled)
+      {
+         // A run thread only to close coalescing windows
+         Supervisor::Component orders;
+         orders.name = "orders";
+         orders.dependsOn = {"private"};
+         orders.optional = true;
+         orders.start = [&]()
+         {
+            orderGateway = std::make_unique<OrderGateway>(*privateChannel, config.orders);
+            orderStates = std::make_unique<OrderStateEngine>(config.orders.max_open_orders, config.orders.client_id_prefix);
+            orderGateway->setSubmitHandler([&](const OrderGateway::Submit &submit)
+                                           { orderStates->onSubmit(submit); });
+            orderGateway->setAckHandler([&](const OrderGateway::Ack &ack)
+                                        { orderStates->onAck(ack); });
+            privateChannel->setMessageHandler([&](const std::string &payload)
+                                              {
+               if (!orderGateway->onMessage(payload))
+                  orderStates->onMessage(payload); });
+            // Subscriptions and the replies to requests in flight do not survive a reconnect
+            privateChannel->setLoginHandler([&]()
+                                            { orderStates->onLogin(privateChannel->loginSent());
+                                              privateChannel->send(OrderStateEngine::subscribeFrame()); });
+         };
+         if (config.orders.batch_window_us > 0)
+            orders.run = [&](std::atomic<bool> &flag)
+            { orderGateway->run(flag); };
+         orders.stop = [&]()
+         { orderGateway->flush(); };
+         orders.health = [&]()
+         { return "sent " + std::to_string(orderGateway->sent()) +
+                  " frames " + std::to_string(orderGateway->frames()) +
+                  " accepted " + std::to_string(orderGateway->accepted()) +
+                  " rejected " + std::to_string(orderGateway->rejected()) +
+                  " open " + std::to_string(orderStates->openOrders()); };
+         supervisor.add(orders);
+      }
+   }
+
+   // Introspection and steering from outside, served on the admin thread
+   admin.addCommand("counters", "- feed, calculation and reload counters", [&](const std::vector<std::string> &)
+                    {
+      std::ostringstream out;
+      out << "feed_messages " << webSocket.m_WebSocketRequestsCount << "\n"
+          << "time_to_first_update_us " << webSocket.timeToFirstUpdateUs() << "\n"
+          << "time_to_steady_state_us " << webSocket.timeToSteadyStateUs() << "\n"
+          << "calculations " << (pool ? pool->totalCompleted() : heavyTasksCount.load()) << "\n"
+          << "config_reloads " << (configWatcher ? configWatcher->reloads() : 0) << "\n"
+          << "config_rejected " << (configWatcher ? configWatcher->rejected() : 0) << "\n";
+      if (webSocket.capture())
+         out << "captured " << webSocket.capture()->records() << "\n"
+             << "capture_rolls " << webSocket.capture()->rolls() << "\n";
+      return out.str(); });
+   admin.addCommand("latency", "- feed handling (ns) and exchange-to-receive (us) histograms", [&](const std::vector<std::string> &)
+                    {
+      std::string out = "handle " + webSocket.handleLatency().summary("ns") + "\n" +
+                        "exchange " + webSocket.exchangeLatency().summary("us");
+      if (orderGateway)
+         out += "\ntick_to_order " + orderGateway->tickToOrder().summary("ns") + "\n" +
+                "order_ack " + orderGateway->ackLatency().summary("us") + "\n" +
+                "order_batch " + orderGateway->batchSizes().summary("ops");
+      return out; });
+   admin.addCommand("subscriptions", "- channels the feed is subscribed to", [&](const std::vector<std::string> &)
+                    {
+      std::string out;
+      for (const auto &s : webSocket.subscriptions())
+         out += s.channel + " " + s.instId + "\n";
+      return out; });
+   admin.addCommand("book", "- depth and top of book per instrument", [&](const std::vector<std::string> &)
+                    {
+      std::ostringstream out;
+      for (const auto &entry : webSocket.books())
+         out << entry.first << " bids " << entry.second.bidLevels << " asks " << entry.second.askLevels
+             << " best " << entry.second.bestBid << " / " << entry.second.bestAsk
+             << " ts " << entry.second.exchangeTs << " updates " << entry.second.updates << "\n";
+      return out.str(); });
+   for (const bool subscribe : {true, false})
+      admin.addCommand(subscribe ? "subscribe" : "unsubscribe", "<channel> <instId> - until the next config reload",
+                       [&webSocket, subscribe](const std::vector<std::string> &args)
+                       {
+         if (args.size() != 2)
+            throw std::invalid_argument("usage: <channel> <instId>");
+         webSocket.changeSubscription({args[0], args[1]}, subscribe);
+         return std::string("requested"); });
+   admin.addCommand("matrix-size", "<n> - matrix size from the next inversion", [&](const std::vector<std::string> &args)
+                    {
+      liveMatrixSize.store(parsePositive(args, "matrix-size <n>"));
+      return "matrix_size " + std::to_string(liveMatrixSize.load()); });
+   admin.addCommand("workers", "<n> - active throughput pool workers", [&](const std::vector<std::string> &args)
+                    {
+      const int requested = parsePositive(args, "workers <n>");
+      if (!pool)
+         throw std::runtime_error("no throughput pool (Calculation.workers is 0)");
+      return "workers " + std::to_string(pool->setActiveWorkers(requested)) + " of " +
+             std::to_string(pool->workerCount()); });
+   admin.addCommand("capture-roll", "- start a new capture file", [&](const std::vector<std::string> &)
+                    {
+      if (!webSocket.capture())
+         throw std::runtime_error("capture is off (Feed.capture_path)");
+      webSocket.capture()->requestRoll();
+      return std::string("roll requested"); });
+   // Manual order entry; all three run on the admin thread, the gateway's one sender
+   auto gateway = [&]() -> OrderGateway &
+   {
+      if (!orderGateway)
+         throw std::runtime_error("order entry is off (Orders.enabled, API credentials)");
+      return *orderGateway;
+   };
+   admin.addCommand("order", "<buy|sell> <px> <sz> - place a limit order on Orders.inst_id", [&](const std::vector<std::string> &args)
+                    {
+      if (args.size() != 3 || (args[0] != "buy" && args[0] != "sell"))
+         throw std::invalid_argument("usage: order <buy|sell> <px> <sz>");
+      const uint64_t clientId = gateway().placeOrder(args[0] == "buy" ? OrderGateway::Side::Buy : OrderGateway::Side::Sell,
+                                                     parsePrice(args[1]), parsePrice(args[2]), webSocket.lastUpdateReceived());
+      if (!clientId)
+         throw std::runtime_error("not sent: private channel not logged in");
+      return "sent " + config.orders.client_id_prefix + std::to_string(clientId); });
+   admin.addCommand("amend", "<client id number> <px> <sz> - amend an order", [&](const std::vector<std::string> &args)
+                    {
+      if (args.size() != 3)
+         throw std::invalid_argument("usage: amend <client id number> <px> <sz>");
+      if (!gateway().amendOrder(parseClientId(args[0]), parsePrice(args[1]), parsePrice(args[2]), webSocket.lastUpdateReceived()))
+         throw std::runtime_error("not sent: private channel not logged in");
+      return std::string("sent"); });
+   admin.addCommand("cancel", "<client id number> - cancel an order", [&](const std::vector<std::string> &args)
+                    {
+      if (args.size() != 1)
+         throw std::invalid_argument("usage: cancel <client id number>");
+      if (!gateway().cancelOrder(parseClientId(args[0]), webSocket.lastUpdateReceived()))
+         throw std::runtime_error("not sent: private channel not logged in");
+      return std::string("sent"); });
+   admin.addCommand("orders", "- open orders and order state counters", [&](const std::vector<std::string> &)
+                    {
+      if (!orderStates)
+         throw std::runtime_error("order entry is off (Orders.enabled, API credentials)");
+      const OrderStateEngine::Counters counters = orderStates->counters();
+      std::string out = "inserted " + std::to_string(counters.inserted) +
+                        " filled " + std::to_string(counters.filled) +
+                        " canceled " + std::to_string(counters.canceled) +
+                        " rejected " + std::to_string(counters.rejected) +
+                        " unknown_acks " + std::to_string(counters.unknownAcks) +
+                        " stale_acks " + std::to_string(counters.staleAcks) +
+                        " unknown_updates " + std::to_string(counters.unknownUpdates) +
+                        " stale_updates " + std::to_string(counters.staleUpdates) +
+                        " table_full " + std::to_string(counters.tableFull) +
+                        " duplicates " + std::to_string(counters.duplicates) +
+                        " expired_requests " + std::to_string(counters.expiredRequests) +
+                        " expired " + std::to_string(counters.expired);
+      for (const auto &order : orderStates->orders())
+         out += "\n" + config.orders.client_id_prefix + std::to_string(order.clientId) +
+                " " + OrderStateEngine::stateName(order.state) +
+                (order.side == OrderGateway::Side::Buy ? " buy " : " sell ") +
+                std::to_string(order.price) + " " + std::to_string(order.filled) + "/" + std::to_string(order.size);
+      return out; });
+   admin.addCommand("health", "- state of each component", [&](const std::vector<std::string> &)
+                    { return supervisor.health(); });
+   admin.addCommand("shutdown", "- stop every component and exit", [&](const std::vector<std::string> &)
+                    {
+      supervisor.requestStop();
+      return std::string("stopping"); });
+   if (!admin.path().empty())
+   {
+      Supervisor::Component control;
+      control.name = "admin";
+      control.dependsOn = {"calculation", "feed"};
+      control.optional = true;
+      control.start = [&]()
+      { admin.start(); };
+      control.stop = [&]()
+      { admin.stop(); };
+      supervisor.add(control);
+   }
+
+   // Registered last so it runs once every workspace exists
+   Supervisor::Component warm;
+   warm.name = "warmup";
+   warm.dependsOn = {"calculation", "feed"};
+   warm.start = [&]()
+   {
+      Warmup::kernelPasses(std::min(calcConfig.matrix_size, 256), engine, calcOptions, warmup.kernel_passes);
+      if (warmup.lock_memory)
+         Warmup::lockMemory();
+   };
+   supervisor.add(warm);
+
+   supervisor.start();
+   std::cout << "Ready after " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - processStart).count()
+             << " ms" << std::endl;
+
+   std::cout << "=====================================================\n"
+             << "| ORDER BOOK FOR BTC-USDT AND INVERSE MATRIX AX = E |\n"
+             << "=====================================================\n";
+
+   supervisor.run(std::chrono::seconds(threading.run_seconds));
+
+   std::cout << "Total WebSocket requests made: " << webSocket.m_WebSocketRequestsCount << std::endl;
+   std::cout << "Time to first update: " << webSocket.timeToFirstUpdateUs() << " us, to steady state: "
+             << webSocket.timeToSteadyStateUs() << " us (-1 = not reached)" << std::endl;
+   if (service)
+      service->printStats();
+   if (workerProcesses)
+      workerProcesses->printStats();
+   if (pool)
+   {
+      pool->printStats();
+      std::cout << "Total calculations completed: " << pool->totalCompleted() << std::endl;
+   }
+   else
+      std::cout << "Total calculations completed: " << heavyTasksCount << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+   const auto processStart = std::chrono::steady_clock::now();
+   ConfigManager::CommandLine commandLine;
+   try
+   {
+      commandLine = ConfigManager::parseCommandLine(argc, argv);
+   }
+   catch (const std::invalid_argument &e)
+   {
+      std::cerr << e.what() << "\n" << ConfigManager::usage();
+      return 2;
+   }
+   if (commandLine.help)
+   {
+      std::cout << ConfigManager::usage();
+      return 0;
+   }
    std::cout << "=====================================================\n"
              << "| OKX EXCHANGE CONNECTOR WITH CONFIGURATION SYSTEM |\n"
              << "=====================================================\n" << std::endl;
 
-   // Test Configuration Manager
+   // File, then WSCLIENT__* environment, then --set; credentials from the environment or descriptors
+   ConfigManager configManager(commandLine.mode, commandLine.configDir);
+   ConfigManager::Snapshot config;
+   bool configured = false;
+   // Settings asked for explicitly are never silently replaced by the defaults
+   const bool layered = !commandLine.overrides.empty() || !commandLine.secretFds.empty() ||
+                        ConfigManager::hasEnvironmentLayer();
    try {
        std::cout << "Testing Configuration Manager..." << std::endl;
-       
-       // Load demo configuration
-       ConfigManager configManager("demo");
+       configManager.setOverrides(commandLine.overrides);
+       for (const auto &secret : commandLine.secretFds)
+           configManager.readSecretFromFd(secret.first, secret.second);
        configManager.loadConfig();
-       
-       // Get OKX configuration
-       auto okxConfig = configManager.getOKXConfig();
-       
+
+       // Compiled once by loadConfig(). Startup settings are copied out: a reload
+       // may free this snapshot once the live components have moved on
+       config = configManager.getSnapshot();
+       configured = true;
+
+       const auto &okxConfig = config.connectors.OKXDataSrc;
        std::cout << "Configuration loaded successfully!" << std::endl;
        std::cout << "Mode: " << configManager.getMode() << std::endl;
        std::cout << "Public URL: " << okxConfig.url_pub << std::endl;
        std::cout << "Private URL: " << okxConfig.url_private << std::endl;
-       std::cout << "API Key: " << okxConfig.API_key.substr(0, 8) << "..." << std::endl;
+       if (okxConfig.API_key.empty())
+           std::cout << "API Key: none, private channel off" << std::endl;
+       else
+           std::cout << "API Key: " << okxConfig.API_key.substr(0, 8) << "..." << std::endl;
+       std::cout << "Calculation: " << config.calculation.matrix_size << "x" << config.calculation.matrix_size
+                 << " (" << config.calculation.engine << ")" << std::endl;
        std::cout << std::endl;
-       
-       // Use the configuration for WebSocket connection
-       std::string uri = okxConfig.url_pub;
-       
-       srand(time(0));
-       std::atomic<bool> flag(false);
-       std::atomic<int> WebSocketRequestsCount(0);
-       std::atomic<int> heavyTasksCount(0);
-       std::mutex mutex;
-       CalculationClass Calculation(1000);
-
-       WebSocketClass webSocket(uri, WebSocketRequestsCount, mutex);
-
-       std::cout << "=====================================================\n"
-                 << "| ORDER BOOK FOR BTC-USDT AND INVERSE MATRIX AX = E |\n"
-                 << "=====================================================\n";
-
-       std::thread webSocketThread([&]()
-                                   { webSocket.wsrun(flag); });
-
-       std::thread calculationThread([&]()
-                                     { Calculation.run(flag, heavyTasksCount, mutex); });
-
-       std::this_thread::sleep_for(std::chrono::seconds(60));
-       flag.store(true);
-
-       calculationThread.join();
-       webSocketThread.join();
-
-       std::cout << "Total WebSocket requests made: " << webSocket.m_WebSocketRequestsCount << std::endl;
-       std::cout << "Total calculations completed: " << heavyTasksCount << std::endl;
-       
    } catch (const std::exception& e) {
        std::cerr << "Configuration Error: " << e.what() << std::endl;
-       std::cerr << "Falling back to hardcoded configuration..." << std::endl;
-       
-       // Fallback to original hardcoded behavior
-       srand(time(0));
-       std::atomic<bool> flag(false);
-       std::atomic<int> WebSocketRequestsCount(0);
-       std::atomic<int> heavyTasksCount(0);
-       std::mutex mutex;
-       CalculationClass Calculation(1000);
-
-       std::string uri = "wss://ws.okx.com:8443/ws/v5/public";
-       WebSocketClass webSocket(uri, WebSocketRequestsCount, mutex);
-
-       std::cout << "=====================================================\n"
-                 << "| ORDER BOOK FOR BTC-USDT AND INVERSE MATRIX AX = E |\n"
-                 << "=====================================================\n";
-
-       std::thread webSocketThread([&]()
-                                   { webSocket.wsrun(flag); });
-
-       std::thread calculationThread([&]()
-                                     { Calculation.run(flag, heavyTasksCount, mutex); });
-
-       std::this_thread::sleep_for(std::chrono::seconds(60));
-       flag.store(true);
-
-       calculationThread.join();
-       webSocketThread.join();
+       if (layered) {
+           std::cerr << "Not falling back to the built-in defaults: --set, --secret-fd or the environment "
+                        "asked for specific settings" << std::endl;
+           return 1;
+       }
+       std::cerr << "Falling back to the built-in defaults..." << std::endl;
+       config = ConfigManager::Snapshot();
+   }
 
-       std::cout << "Total WebSocket requests made: " << webSocket.m_WebSocketRequestsCount << std::endl;
-       std::cout << "Total calculations completed: " << heavyTasksCount << std::endl;
+   // One startup path for both; a component that cannot start stops the ones before it
+   try
+   {
+      runConnector(configured ? &configManager : nullptr, config, commandLine.configDir, processStart);
+   }
+   catch (const std::exception &e)
+   {
+      std::cerr << e.what() << std::endl;
+      return 1;
    }
 
    return 0;
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include "CalculationWorker.h"
+#include "DistributedInverter.h"
+#include "TcpTransport.h"
+#include "MatrixKernels.h"
+
+// Standalone calculation worker process. Started by WorkerProcessPool with
+// --fd, or run by hand (e.g. under numactl) with --socket. With --node it
+// is instead one rank of a distributed inversion group (see DistributedInverter).
+static void usage(const char *program)
+{
+   std::cerr << "Usage: " << program << " (--fd N | --socket PATH | --node RANK --nodes HOST:PORT,...)"
+             << " [--cpu N] [--isa NAME] [--tile-size N]"
+             << " [--gemm-block N] [--gemm-unroll N]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+   int fd = -1;
+   int cpu = -1;
+   int node = -1;
+   int tileSize = 256;  // With --node: the largest tile edge accepted from the coordinator
+   std::string socketPath;
+   std::vector<std::string> nodes;
+   MatrixKernels::Tuning tuning = MatrixKernels::tuning();
+
+   try
+   {
+      for (int i = 1; i < argc; i++)
+      {
+         const std::string arg = argv[i];
+         if (i + 1 >= argc)
+         {
+            usage(argv[0]);
+            return 2;
+         }
+         const std::string value = argv[++i];
+         if (arg == "--fd")
+            fd = std::stoi(value);
+         else if (arg == "--socket")
+            socketPath = value;
+         else if (arg == "--node")
+            node = std::stoi(value);
+         else if (arg == "--nodes")
+         {
+            std::istringstream list(value);
+            std::string endpoint;
+            while (std::getline(list, endpoint, ','))
+               nodes.push_back(endpoint);
+         }
+         else if (arg == "--tile-size")
+            tileSize = std::stoi(value);
+         else if (arg == "--cpu")
+            cpu = std::stoi(value);
+         else if (arg == "--isa")
+            MatrixKernels::setIsa(MatrixKernels::isaFromString(value));
+         else if (arg == "--gemm-block")
+            tuning.gemmBlock = std::stoi(value);
+         else if (arg == "--gemm-unroll")
+            tuning.gemmUnroll = std::stoi(value);
+         else
+         {
+            usage(argv[0]);
+            return 2;
+         }
+      }
+   }
+   catch (const std::exception &e)
+   {
+      std::cerr << "CalculationWorker: Bad argument: " << e.what() << std::endl;
+      return 2;
+   }
+
+   const int modes = (fd >= 0) + !socketPath.empty() + (node >= 0);
+   if (modes != 1 || (node >= 0) != !nodes.empty() || node >= (int)nodes.size() || tileSize <= 0)
+   {
+      usage(argv[0]);
+      return 2;
+   }
+
+   // Jobs run on this process's single thread only; a node has the machine to itself
+   if (node < 0)
+      tuning.gemmThreads = 1;
+   MatrixKernels::setTuning(tuning);
+
+   if (cpu >= 0)
+   {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu, &cpus);
+      if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+         std::cerr << "CalculationWorker: Cannot pin to cpu " << cpu << ": " << strerror(errno) << std::endl;
+   }
+
+   if (!socketPath.empty())
+      return CalculationWorker::listen(socketPath);
+
+   if (node >= 0)
+   {
+      try
+      {
+         TcpTransport transport(node, nodes, DistributedInverter::maxMessage(tileSize));
+         std::cout << "CalculationWorker: Node " << node << " of " << nodes.size() << " joined" << std::endl;
+         DistributedInverter(transport, 0).serve();
+      }
+      catch (const std::exception &e)
+      {
+         std::cerr << "CalculationWorker: Node " << node << ": " << e.what() << std::endl;
+         return 1;
+      }
+      return 0;
+   }
+
+   CalculationWorker::serve(fd);
+   close(fd);
+   return 0;
+}
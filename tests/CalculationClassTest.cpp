@@ -0,0 +1,41 @@
+#include "Check.h"
+#include "CalculationClass.h"
+
+namespace
+{
+   CalculationClass::Options denseOptions()
+   {
+      CalculationClass::Options options;
+      options.sparseThreshold = 0.;  // Keep every matrix on the dense engines
+      return options;
+   }
+
+   void testInPlace()
+   {
+      // Odd sizes and a 1 x 1 matrix as well as a full one
+      for (int n : {1, 7, 64, 203})
+      {
+         CalculationClass calculation(n, CalculationClass::Engine::InPlace, denseOptions());
+         unsigned int seed = n;
+         calculation.reset(&seed);
+         CHECK(calculation.invert() == 0);
+         CHECK(calculation.verify() < 1e-8);
+      }
+   }
+
+   void testGaussJordan()
+   {
+      CalculationClass calculation(50, CalculationClass::Engine::GaussJordan, denseOptions());
+      unsigned int seed = 3;
+      calculation.reset(&seed);
+      CHECK(calculation.invert() == 0);
+      CHECK(calculation.verify() < 1e-8);
+   }
+}
+
+int main()
+{
+   testInPlace();
+   testGaussJordan();
+   return checkFailures();
+}
@@ -0,0 +1,28 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief Minimal checks for the unit tests: each failure is printed, main returns the count
+ */
+inline int& checkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            checkFailures()++;                                                            \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) CHECK(std::fabs((actual) - (expected)) <= (tolerance))
+
+#endif // TESTS_CHECK_H
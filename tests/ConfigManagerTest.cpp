@@ -0,0 +1,329 @@
+#include "Check.h"
+#include "ConfigManager.h"
+#include "ConfigWatcher.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+   const char *kConnector = R"("OKXDataSrc": {
+      "url_pub": "wss://ws.okx.com:8443/ws/v5/public",
+      "url_private": "wss://ws.okx.com:8443/ws/v5/private"
+   })";
+
+   // Write <dir>/demo.json for a fresh directory under /tmp and return the directory
+   std::string writeConfig(const std::string &name, const std::string &body)
+   {
+      const std::string dir = "/tmp/config_manager_test." + std::to_string(getpid()) + "." + name;
+      std::filesystem::create_directories(dir);
+      std::ofstream(dir + "/demo.json") << body;
+      return dir;
+   }
+
+   std::string withMatrixSize(const std::string &size)
+   {
+      return std::string("{") + kConnector + R"(, "Calculation": {"matrix_size": )" + size + "}}";
+   }
+
+   // Pipe holding value, for the descriptor credential sources; returns the read end
+   int secretPipe(const std::string &value)
+   {
+      int fds[2];
+      if (pipe(fds) != 0)
+         return -1;
+      const ssize_t written = write(fds[1], value.data(), value.size());
+      close(fds[1]);
+      return written == (ssize_t)value.size() ? fds[0] : -1;
+   }
+
+   bool loads(ConfigManager &config)
+   {
+      try
+      {
+         config.loadConfig();
+         return true;
+      }
+      catch (const std::runtime_error &)
+      {
+         return false;
+      }
+   }
+
+   void testCompile()
+   {
+      const std::string dir = writeConfig("compile", std::string("{") + kConnector + R"(,
+         "Feed": {"subscriptions": [{"channel": "books5", "instId": "ETH-USDT"},
+                                    {"channel": "bbo-tbt", "instId": "BTC-USDT"}]},
+         "Logging": {"level": "warn", "access_log": false},
+         "Calculation": {"matrix_size": 300, "engine": "recursive", "worker_cpus": [2, 3]}
+      })");
+      ConfigManager config("demo", dir);
+      config.loadConfig();
+      const ConfigManager::Snapshot &snapshot = config.getSnapshot();
+      CHECK(snapshot.connectors.OKXDataSrc.url_pub == "wss://ws.okx.com:8443/ws/v5/public");
+      CHECK(snapshot.connectors.OKXDataSrc.API_key.empty());
+      CHECK(snapshot.feed.subscriptions.size() == 2);
+      CHECK(snapshot.feed.subscriptions[0].channel == "books5");
+      CHECK(snapshot.feed.subscriptions[0].instId == "ETH-USDT");
+      CHECK(snapshot.feed.subscribe_message ==
+            R"({"op":"subscribe","args":[{"channel":"books5","instId":"ETH-USDT"},{"channel":"bbo-tbt","instId":"BTC-USDT"}]})");
+      CHECK(snapshot.logging.level == ConfigManager::LogLevel::Warn);
+      CHECK(!snapshot.logging.access_log);
+      CHECK(snapshot.calculation.matrix_size == 300);
+      CHECK(snapshot.calculation.engine == "recursive");
+      CHECK(snapshot.calculation.worker_cpus == std::vector<int>({2, 3}));
+      // Fields the file leaves out keep their defaults
+      CHECK(snapshot.calculation.tile_size == 256);
+      CHECK(snapshot.threading.run_seconds == 60);
+      CHECK(snapshot.socket.tcp_nodelay);
+
+      // The getters hand out the snapshot itself, not copies
+      CHECK(&config.getOKXConfig() == &snapshot.connectors.OKXDataSrc);
+      CHECK(&config.getCalculationConfig() == &snapshot.calculation);
+      std::filesystem::remove_all(dir);
+   }
+
+   void testDefaults()
+   {
+      const std::string dir = writeConfig("defaults", std::string("{") + kConnector + "}");
+      ConfigManager config("demo", dir);
+      CHECK(!config.isLoaded());
+      config.loadConfig();
+      CHECK(config.isLoaded());
+      const ConfigManager::Snapshot &snapshot = config.getSnapshot();
+      CHECK(snapshot.feed.subscribe_message == ConfigManager::FeedConfig().subscribe_message);
+      CHECK(snapshot.calculation.engine == "gauss_jordan");
+      CHECK(snapshot.logging.level == ConfigManager::LogLevel::Info);
+      std::filesystem::remove_all(dir);
+   }
+
+   void testRejected()
+   {
+      const char *invalid[] = {
+         R"("Calculation": {"engine": "cholesky"})",
+         R"("Calculation": {"matrix_size": 0})",
+         R"("Logging": {"level": "verbose"})",
+         R"("Feed": {"subscriptions": [{"channel": "bbo-tbt"}]})",
+         R"("Threading": {"run_seconds": "60"})",
+      };
+      for (const char *section : invalid)
+      {
+         const std::string dir = writeConfig("rejected", std::string("{") + kConnector + "," + section + "}");
+         ConfigManager config("demo", dir);
+         bool threw = false;
+         try
+         {
+            config.loadConfig();
+         }
+         catch (const std::runtime_error &)
+         {
+            threw = true;
+         }
+         CHECK(threw);
+         CHECK(!config.isLoaded());
+         std::filesystem::remove_all(dir);
+      }
+
+      ConfigManager missing("demo", "/nonexistent");
+      bool threw = false;
+      try
+      {
+         missing.loadConfig();
+      }
+      catch (const std::runtime_error &)
+      {
+         threw = true;
+      }
+      CHECK(threw);
+   }
+
+   void testReload()
+   {
+      const std::string dir = writeConfig("reload", withMatrixSize("100"));
+      ConfigManager config("demo", dir);
+      config.loadConfig();
+      int published = 0;
+      config.addReloadListener([&](const ConfigManager::Snapshot &snapshot)
+                               { published = snapshot.calculation.matrix_size; });
+
+      std::ofstream(dir + "/demo.json") << withMatrixSize("200");
+      CHECK(config.reload());
+      CHECK(published == 200);
+      CHECK(config.getCalculationConfig().matrix_size == 200);
+
+      // A file that fails validation leaves the running snapshot and the raw JSON alone
+      std::ofstream(dir + "/demo.json") << withMatrixSize("-1");
+      CHECK(!config.reload());
+      CHECK(published == 200);
+      CHECK(config.getCalculationConfig().matrix_size == 200);
+      CHECK(config.getRawConfig()["Calculation"]["matrix_size"] == 200);
+      std::ofstream(dir + "/demo.json") << "{";
+      CHECK(!config.reload());
+      CHECK(config.getCalculationConfig().matrix_size == 200);
+      std::filesystem::remove_all(dir);
+   }
+
+   void testWatcher()
+   {
+      const std::string dir = writeConfig("watcher", withMatrixSize("100"));
+      ConfigManager config("demo", dir);
+      config.loadConfig();
+      ConfigWatcher watcher(config, std::chrono::milliseconds(20));
+      watcher.start();
+
+      // Write-then-rename, as editors save
+      std::ofstream(dir + "/demo.json.tmp") << withMatrixSize("300");
+      std::rename((dir + "/demo.json.tmp").c_str(), (dir + "/demo.json").c_str());
+      for (int i = 0; i < 500 && watcher.reloads() == 0; i++)
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      CHECK(watcher.reloads() == 1);
+      CHECK(watcher.rejected() == 0);
+      CHECK(config.getLiveSnapshot().load()->calculation.matrix_size == 300);
+      watcher.stop();
+      std::filesystem::remove_all(dir);
+   }
+
+   void testLayers()
+   {
+      const std::string dir = writeConfig("layers", std::string("{") + kConnector + R"(,
+         "Calculation": {"matrix_size": 100, "engine": "recursive", "workers": 1}
+      })");
+      // The environment beats the file, --set beats the environment; values keep their JSON type
+      setenv("WSCLIENT__Calculation__matrix_size", "200", 1);
+      setenv("WSCLIENT__Calculation__workers", "3", 1);
+      setenv("WSCLIENT__Threading__run_seconds", "5", 1);
+      setenv("WSCLIENT__Socket__tcp_nodelay", "false", 1);
+      CHECK(ConfigManager::hasEnvironmentLayer());
+      ConfigManager config("demo", dir);
+      config.setOverrides({"Calculation.matrix_size=300", "Calculation.worker_cpus=[1,2]", "Calculation.scratch_dir=/var/tmp"});
+      CHECK(loads(config));
+      const ConfigManager::Snapshot &snapshot = config.getSnapshot();
+      CHECK(snapshot.calculation.matrix_size == 300);
+      CHECK(snapshot.calculation.workers == 3);
+      CHECK(snapshot.calculation.engine == "recursive");
+      CHECK(snapshot.calculation.worker_cpus == std::vector<int>({1, 2}));
+      CHECK(snapshot.calculation.scratch_dir == "/var/tmp");
+      CHECK(snapshot.threading.run_seconds == 5);
+      CHECK(!snapshot.socket.tcp_nodelay);
+
+      // Layered values are validated like the file's
+      setenv("WSCLIENT__Calculation__workers", "many", 1);
+      ConfigManager invalid("demo", dir);
+      CHECK(!loads(invalid));
+      for (const char *variable : {"WSCLIENT__Calculation__matrix_size", "WSCLIENT__Calculation__workers",
+                                   "WSCLIENT__Threading__run_seconds", "WSCLIENT__Socket__tcp_nodelay"})
+         unsetenv(variable);
+      CHECK(!ConfigManager::hasEnvironmentLayer());
+
+      // Neither layer may carry credentials
+      bool threw = false;
+      try
+      {
+         config.setOverrides({"OKXDataSrc.API_secret=secret"});
+      }
+      catch (const std::invalid_argument &)
+      {
+         threw = true;
+      }
+      CHECK(threw);
+      setenv("WSCLIENT__OKXDataSrc__API_key", "key", 1);
+      ConfigManager environment("demo", dir);
+      CHECK(!loads(environment));
+      unsetenv("WSCLIENT__OKXDataSrc__API_key");
+      std::filesystem::remove_all(dir);
+   }
+
+   void testCommandLine()
+   {
+      const char *argv[] = {"websocket_client", "--mode", "prod", "--config-dir", "/etc/okx",
+                            "--set", "Calculation.matrix_size=500", "--secret-fd", "API_secret=3"};
+      ConfigManager::CommandLine options = ConfigManager::parseCommandLine(9, const_cast<char **>(argv));
+      CHECK(options.mode == "prod");
+      CHECK(options.configDir == "/etc/okx");
+      CHECK(options.overrides == std::vector<std::string>({"Calculation.matrix_size=500"}));
+      CHECK(options.secretFds.size() == 1 && options.secretFds[0].first == "API_secret" && options.secretFds[0].second == 3);
+
+      const char *malformed[][2] = {{"--secret-fd", "API_secret"}, {"--secret-fd", "API_secret=x"}, {"--verbose", "1"}};
+      for (const auto &option : malformed)
+      {
+         const char *args[] = {"websocket_client", option[0], option[1]};
+         bool threw = false;
+         try
+         {
+            ConfigManager::parseCommandLine(3, const_cast<char **>(args));
+         }
+         catch (const std::invalid_argument &)
+         {
+            threw = true;
+         }
+         CHECK(threw);
+      }
+   }
+
+   void testSecrets()
+   {
+      const std::string dir = writeConfig("secrets", std::string("{") + kConnector + "}");
+      // A descriptor wins over the environment; the variables are consumed
+      setenv("OKX_API_KEY", "env-key", 1);
+      setenv("OKX_API_SECRET", "env-secret", 1);
+      setenv("OKX_API_PASSPHRASE_FD", std::to_string(secretPipe("fd-passphrase\n")).c_str(), 1);
+      ConfigManager config("demo", dir);
+      config.readSecretFromFd("API_secret", secretPipe("fd-secret"));
+      CHECK(loads(config));
+      const ConfigManager::OKXConfig &okx = config.getOKXConfig();
+      CHECK(okx.API_key == "env-key");
+      CHECK(okx.API_secret == "fd-secret");
+      CHECK(okx.API_passphrase == "fd-passphrase");
+      CHECK(!std::getenv("OKX_API_KEY") && !std::getenv("OKX_API_SECRET") && !std::getenv("OKX_API_PASSPHRASE_FD"));
+      CHECK(config.getRawConfig().dump().find("secret") == std::string::npos);
+
+      // A partial set would log in with blanks
+      setenv("OKX_API_KEY", "env-key", 1);
+      ConfigManager partial("demo", dir);
+      CHECK(!loads(partial));
+      unsetenv("OKX_API_KEY");
+
+      bool threw = false;
+      try
+      {
+         config.readSecretFromFd("API_token", secretPipe("token"));
+      }
+      catch (const std::invalid_argument &)
+      {
+         threw = true;
+      }
+      CHECK(threw);
+      std::filesystem::remove_all(dir);
+
+      // Credentials in the file are refused, placeholders included
+      for (const char *field : {"API_key", "API_secret", "API_passphrase"})
+      {
+         const std::string inFile = writeConfig("in_file", std::string(R"({"OKXDataSrc": {
+            "url_pub": "wss://ws.okx.com:8443/ws/v5/public",
+            "url_private": "wss://ws.okx.com:8443/ws/v5/private", ")") + field + R"(": "placeholder"}})");
+         ConfigManager placeholder("demo", inFile);
+         CHECK(!loads(placeholder));
+         std::filesystem::remove_all(inFile);
+      }
+   }
+}
+
+int main()
+{
+   testCompile();
+   testDefaults();
+   testRejected();
+   testLayers();
+   testCommandLine();
+   testSecrets();
+   testReload();
+   testWatcher();
+   return checkFailures();
+}
@@ -0,0 +1,104 @@
+#include "Check.h"
+#include "DistributedInverter.h"
+#include "LoopbackTransport.h"
+#include "MatrixKernels.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   std::vector<double> randomMatrix(int n, unsigned int seed)
+   {
+      std::minstd_rand random(seed);
+      std::uniform_real_distribution<double> value(0., 10.);
+      std::vector<double> A((size_t)n * n);
+      for (auto &entry : A)
+         entry = value(random);
+      return A;
+   }
+
+   // [[0, I], [I, 0]]: with tiles of half its size both diagonal tiles are zero
+   std::vector<double> swapHalves(int n)
+   {
+      std::vector<double> A((size_t)n * n, 0.);
+      for (int i = 0; i < n; i++)
+         A[(size_t)i * n + (i + n / 2) % n] = 1.;
+      return A;
+   }
+
+   double residual(const std::vector<double> &A, const std::vector<double> &inverse, int n)
+   {
+      std::vector<double> product((size_t)n * n);
+      MatrixKernels::multiply(n, n, n, 1., A.data(), n, inverse.data(), n, 0., product.data(), n);
+      double worst = 0.;
+      for (int i = 0; i < n; i++)
+         for (int j = 0; j < n; j++)
+            worst = std::max(worst, std::fabs(product[(size_t)i * n + j] - (i == j ? 1. : 0.)));
+      return worst;
+   }
+
+   // Runs jobs on rank 0 of a loopback group of the given size, the other ranks serving
+   template <typename Jobs>
+   void withGroup(int nodes, int tileSize, Jobs &&jobs)
+   {
+      auto group = LoopbackTransport::createGroup(nodes);
+      std::vector<std::thread> servers;
+      for (int r = 1; r < nodes; r++)
+         servers.emplace_back([&group, r, tileSize]()
+                              { DistributedInverter(*group[r], tileSize).serve(); });
+      DistributedInverter coordinator(*group[0], tileSize);
+      jobs(coordinator);
+      coordinator.shutdown();
+      for (auto &server : servers)
+         server.join();
+   }
+
+   void testPermutation()
+   {
+      for (int nodes : {1, 2, 4})
+         withGroup(nodes, 4, [](DistributedInverter &inverter)
+                   {
+            const std::vector<double> P = swapHalves(8);
+            std::vector<double> inverse = P;
+            CHECK(inverter.invert(inverse.data(), 8) == 0);
+            CHECK(residual(P, inverse, 8) == 0.); });
+   }
+
+   void testRandom()
+   {
+      withGroup(4, 8, [](DistributedInverter &inverter)
+                {
+         CHECK(inverter.gridRows() == 2 && inverter.gridCols() == 2);
+         // Padded last tiles, then a leading tile scaled down so only pivoting keeps the digits
+         for (int n : {50, 64})
+         {
+            std::vector<double> A = randomMatrix(n, n);
+            if (n == 64)
+               for (int i = 0; i < 8; i++)
+                  for (int j = 0; j < 8; j++)
+                     A[(size_t)i * n + j] *= 1e-8;
+            std::vector<double> inverse = A;
+            CHECK(inverter.invert(inverse.data(), n) == 0);
+            CHECK(residual(A, inverse, n) < 1e-10);
+         }
+
+         // A singular matrix fails on every node and leaves the group usable
+         std::vector<double> singular = randomMatrix(40, 3);
+         for (int i = 0; i < 40; i++)
+            singular[(size_t)i * 40 + 17] = 0.;
+         CHECK(inverter.invert(singular.data(), 40) == -1);
+         const std::vector<double> P = swapHalves(16);
+         std::vector<double> inverse = P;
+         CHECK(inverter.invert(inverse.data(), 16) == 0);
+         CHECK(residual(P, inverse, 16) == 0.); });
+   }
+}
+
+int main()
+{
+   testPermutation();
+   testRandom();
+   return checkFailures();
+}
@@ -0,0 +1,40 @@
+#include "Check.h"
+#include "FeedCapture.h"
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <unistd.h>
+
+int main()
+{
+   const std::string dir = "/tmp/feed_capture_test." + std::to_string(getpid());
+   std::filesystem::create_directories(dir);
+   const std::string path = dir + "/capture.log";
+   {
+      // Three rolls well inside one second: each must land under its own name
+      FeedCapture capture(path);
+      for (const char *payload : {"a", "b", "c"})
+      {
+         capture.record(1, payload);
+         capture.requestRoll();
+      }
+      capture.record(2, "d");
+      CHECK(capture.rolls() == 3);
+      CHECK(capture.records() == 4);
+   }
+
+   std::set<std::string> lines;
+   int files = 0;
+   for (const auto &entry : std::filesystem::directory_iterator(dir))
+   {
+      std::ifstream file(entry.path());
+      for (std::string line; std::getline(file, line);)
+         lines.insert(line);
+      files++;
+   }
+   CHECK(files == 4);
+   CHECK(lines == std::set<std::string>({"1 a", "1 b", "1 c", "2 d"}));
+   std::filesystem::remove_all(dir);
+   return checkFailures();
+}
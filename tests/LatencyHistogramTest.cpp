@@ -0,0 +1,39 @@
+#include "Check.h"
+#include "LatencyHistogram.h"
+
+int main()
+{
+   {
+      LatencyHistogram empty;
+      CHECK(empty.count() == 0);
+      CHECK(empty.mean() == 0.);
+      CHECK(empty.percentile(0.5) == 0);
+   }
+   {
+      // 1..1000: bucket b holds [2^(b-1), 2^b), a percentile reports its bucket's upper bound
+      LatencyHistogram histogram;
+      for (uint64_t value = 1; value <= 1000; value++)
+         histogram.record(value);
+      CHECK(histogram.count() == 1000);
+      CHECK(histogram.max() == 1000);
+      CHECK_NEAR(histogram.mean(), 500.5, 1e-9);
+      CHECK(histogram.percentile(0.) == 1);
+      CHECK(histogram.percentile(0.5) == 511);
+      CHECK(histogram.percentile(0.9) == 1000);  // Capped at the maximum seen
+      CHECK(histogram.percentile(1.) == 1000);
+      CHECK(histogram.summary("us") == "count 1000 mean 500 p50 511 p90 1000 p99 1000 p99.9 1000 max 1000 us");
+   }
+   {
+      LatencyHistogram histogram;
+      histogram.record(0);
+      histogram.record(0);
+      histogram.record(7);
+      CHECK(histogram.percentile(0.5) == 0);
+      CHECK(histogram.percentile(1.) == 7);
+      // Values past the last bucket land in it
+      histogram.record(~uint64_t(0));
+      CHECK(histogram.count() == 4);
+      CHECK(histogram.percentile(1.) == (uint64_t(1) << (LatencyHistogram::kBuckets - 1)) - 1);
+   }
+   return checkFailures();
+}
@@ -0,0 +1,48 @@
+#include "Check.h"
+#include "LoginSigner.h"
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+int main()
+{
+   // Expected values computed independently: base64(HMAC-SHA256(secret, timestamp + "GET/users/self/verify"))
+   {
+      LoginSigner signer("22582BD0CFF14C41EDBF1AB98506286D");
+      char signature[LoginSigner::kSignatureSize];
+      CHECK(signer.sign(1538054050, signature));
+      CHECK(strcmp(signature, "+LdIr8lkkvhr5hoA3g9TMC0+uQJ849ftAcocA/ouu4M=") == 0);
+      // The context is re-keyed on every call: signing twice gives the same result
+      CHECK(signer.sign(1538054050, signature));
+      CHECK(strcmp(signature, "+LdIr8lkkvhr5hoA3g9TMC0+uQJ849ftAcocA/ouu4M=") == 0);
+   }
+   {
+      LoginSigner signer("secret");
+      char signature[LoginSigner::kSignatureSize];
+      CHECK(signer.sign(0, signature));
+      CHECK(strcmp(signature, "niowDTQBIkVSS9n0ncnYHElVvC+kE7kmN5NIWNYNXhE=") == 0);
+   }
+   {
+      LoginSigner signer("secret");
+      // Credentials are escaped into the frame, which is signed for its own timestamp
+      const nlohmann::json frame = nlohmann::json::parse(signer.loginFrame("key", "pa\"ss\\"));
+      CHECK(frame["op"] == "login");
+      const nlohmann::json &args = frame["args"][0];
+      CHECK(args["apiKey"] == "key");
+      CHECK(args["passphrase"] == "pa\"ss\\");
+      char signature[LoginSigner::kSignatureSize];
+      CHECK(signer.sign(std::stoll(args["timestamp"].get<std::string>()), signature));
+      CHECK(args["sign"] == signature);
+   }
+
+   bool threw = false;
+   try
+   {
+      LoginSigner signer("");
+   }
+   catch (const std::runtime_error &)
+   {
+      threw = true;
+   }
+   CHECK(threw);
+   return checkFailures();
+}
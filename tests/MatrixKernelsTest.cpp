@@ -0,0 +1,142 @@
+#include "Check.h"
+#include "MatrixKernels.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+   std::vector<double> randomMatrix(int n, unsigned int seed)
+   {
+      std::minstd_rand random(seed);
+      std::uniform_real_distribution<double> value(0., 10.);
+      std::vector<double> A((size_t)n * n);
+      for (auto &entry : A)
+         entry = value(random);
+      return A;
+   }
+
+   // [[0, I], [I, 0]]: every leading block is singular, only pivoting inverts it
+   std::vector<double> swapHalves(int n)
+   {
+      std::vector<double> A((size_t)n * n, 0.);
+      for (int i = 0; i < n; i++)
+         A[(size_t)i * n + (i + n / 2) % n] = 1.;
+      return A;
+   }
+
+   // max |A * inverse - I|
+   double residual(const std::vector<double> &A, const std::vector<double> &inverse, int n)
+   {
+      std::vector<double> product((size_t)n * n);
+      MatrixKernels::multiply(n, n, n, 1., A.data(), n, inverse.data(), n, 0., product.data(), n);
+      double worst = 0.;
+      for (int i = 0; i < n; i++)
+         for (int j = 0; j < n; j++)
+            worst = std::max(worst, std::fabs(product[(size_t)i * n + j] - (i == j ? 1. : 0.)));
+      return worst;
+   }
+
+   void testRecursive()
+   {
+      for (int n : {1, 5, 64, 130})
+      {
+         const std::vector<double> A = randomMatrix(n, n);
+         std::vector<double> inverse = A;
+         CHECK(MatrixKernels::invertRecursive(inverse.data(), n, n, 16) == 0);
+         CHECK(residual(A, inverse, n) < 1e-9);
+      }
+
+      // Pivoting across the recursion, with a base case that splits the halves again
+      const std::vector<double> P = swapHalves(64);
+      std::vector<double> inverse = P;
+      CHECK(MatrixKernels::invertRecursive(inverse.data(), 64, 64, 8) == 0);
+      CHECK(residual(P, inverse, 64) < 1e-12);
+
+      // Inverting a block in place inside a larger matrix leaves the rest alone
+      std::vector<double> big = randomMatrix(40, 9);
+      const std::vector<double> original = big;
+      std::vector<double> block(20 * 20);
+      for (int i = 0; i < 20; i++)
+         std::copy(&big[(size_t)i * 40], &big[(size_t)i * 40 + 20], &block[(size_t)i * 20]);
+      CHECK(MatrixKernels::invertRecursive(big.data(), 40, 20, 4) == 0);
+      std::vector<double> inverse20(20 * 20);
+      for (int i = 0; i < 20; i++)
+         std::copy(&big[(size_t)i * 40], &big[(size_t)i * 40 + 20], &inverse20[(size_t)i * 20]);
+      CHECK(residual(block, inverse20, 20) < 1e-9);
+      CHECK(std::equal(big.begin() + 20, big.begin() + 40, original.begin() + 20));
+
+      std::vector<double> singular = randomMatrix(32, 4);
+      for (int i = 0; i < 32; i++)
+         singular[(size_t)i * 32 + 21] = 0.;  // An empty column stays exactly zero through elimination
+      CHECK(MatrixKernels::invertRecursive(singular.data(), 32, 32, 8) == -1);
+   }
+
+   void testNewtonSchulz()
+   {
+      const int n = 48;
+      const std::vector<double> A = randomMatrix(n, 5);
+      std::vector<double> X((size_t)n * n);
+      MatrixKernels::NewtonSchulzStats cold;
+      CHECK(MatrixKernels::invertNewtonSchulz(A.data(), n, X.data(), false, 1e-10, 100, &cold) == 0);
+      CHECK(!cold.warmStarted);
+      CHECK(cold.residual <= 1e-10);
+      CHECK(residual(A, X, n) < 1e-9);
+
+      // The inverse of a nearby matrix is a good enough start to save most of the steps
+      std::vector<double> nearby = A;
+      nearby[7] += 1e-4;
+      MatrixKernels::NewtonSchulzStats warm;
+      CHECK(MatrixKernels::invertNewtonSchulz(nearby.data(), n, X.data(), true, 1e-10, 100, &warm) == 0);
+      CHECK(warm.warmStarted);
+      CHECK(warm.iterations < cold.iterations);
+      CHECK(residual(nearby, X, n) < 1e-9);
+
+      // An unusable guess falls back to the cold start
+      std::fill(X.begin(), X.end(), 1e6);
+      MatrixKernels::NewtonSchulzStats rejected;
+      CHECK(MatrixKernels::invertNewtonSchulz(A.data(), n, X.data(), true, 1e-10, 100, &rejected) == 0);
+      CHECK(!rejected.warmStarted);
+
+      // A singular matrix never converges: reported as a failure, not an inverse
+      std::vector<double> singular = A;
+      for (int i = 0; i < n; i++)
+         singular[(size_t)i * n + 3] = 0.;
+      CHECK(MatrixKernels::invertNewtonSchulz(singular.data(), n, X.data(), false, 1e-10, 100) != 0);
+   }
+
+   void testStrassen()
+   {
+      // Odd sizes peel a row and column at every level down to the crossover
+      for (int n : {64, 101, 130})
+      {
+         const std::vector<double> A = randomMatrix(n, 11), B = randomMatrix(n, 12);
+         std::vector<double> expected((size_t)n * n), C((size_t)n * n, -1.);
+         MatrixKernels::multiply(n, n, n, 1., A.data(), n, B.data(), n, 0., expected.data(), n);
+         for (int depth : {0, 1})
+         {
+            MatrixKernels::multiplyStrassen(n, A.data(), n, B.data(), n, C.data(), n, 16, depth);
+            double worst = 0.;
+            for (size_t i = 0; i < C.size(); i++)
+               worst = std::max(worst, std::fabs(C[i] - expected[i]) / std::fabs(expected[i]));
+            CHECK(worst < 1e-12);
+         }
+      }
+
+      // Below the threshold multiplyFast() is the plain GEMM
+      const int n = 40;
+      const std::vector<double> A = randomMatrix(n, 13), B = randomMatrix(n, 14);
+      std::vector<double> expected((size_t)n * n), C((size_t)n * n);
+      MatrixKernels::multiply(n, n, n, 1., A.data(), n, B.data(), n, 0., expected.data(), n);
+      CHECK(!MatrixKernels::multiplyFast(n, A.data(), n, B.data(), n, C.data(), n));
+      CHECK(C == expected);
+   }
+}
+
+int main()
+{
+   testRecursive();
+   testNewtonSchulz();
+   testStrassen();
+   return checkFailures();
+}
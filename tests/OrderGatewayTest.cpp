@@ -0,0 +1,164 @@
+#include "Check.h"
+#include "OrderGateway.h"
+#include "PrivateChannel.h"  // The stand-in from tests/support
+#include <nlohmann/json.hpp>
+#include <vector>
+
+namespace
+{
+   using Op = OrderGateway::Op;
+   using Side = OrderGateway::Side;
+   const std::chrono::steady_clock::time_point kNoTick;
+
+   ConfigManager::OrdersConfig ordersConfig(int batchWindowUs, int batchLimit)
+   {
+      ConfigManager::OrdersConfig config;
+      config.inst_id = "BTC-USDT";
+      config.px_decimals = 1;
+      config.sz_decimals = 8;
+      config.client_id_prefix = "t";
+      config.batch_window_us = batchWindowUs;
+      config.batch_limit = batchLimit;
+      return config;
+   }
+
+   std::string reply(const std::string &id, const char *op, const nlohmann::json &data, const char *code = "0")
+   {
+      // Replies lead with the id, as the exchange sends them (dump() would sort the keys)
+      return R"({"id":")" + id + R"(","op":")" + op + R"(","code":")" + code + R"(","msg":"","data":)" + data.dump() + "}";
+   }
+
+   void testFrames()
+   {
+      PrivateChannel channel;
+      OrderGateway gateway(channel, ordersConfig(0, 20));
+      const uint64_t id = gateway.placeOrder(Side::Sell, 100.04, 0.00000001, std::chrono::steady_clock::now());
+      CHECK(id != 0);
+      CHECK(gateway.amendOrder(id, 0.05, 2, kNoTick));
+      CHECK(gateway.cancelOrder(id, kNoTick));
+      CHECK(channel.frames.size() == 3);
+      CHECK(gateway.tickToOrder().count() == 1);  // Only the place had a tick
+
+      // Slots are padded with JSON whitespace; the frames parse to the plain requests
+      CHECK(channel.frames[0].find(R"("px":"100.0"  )") != std::string::npos);
+      const nlohmann::json place = nlohmann::json::parse(channel.frames[0]);
+      CHECK(place["id"] == "1");
+      CHECK(place["op"] == "order");
+      const nlohmann::json &args = place["args"][0];
+      CHECK(args["instId"] == "BTC-USDT");
+      CHECK(args["tdMode"] == "cash");
+      CHECK(args["ordType"] == "limit");
+      CHECK(args["side"] == "sell");
+      CHECK(args["px"] == "100.0");
+      CHECK(args["sz"] == "0.00000001");
+      CHECK(args["clOrdId"] == "t" + std::to_string(id));
+
+      const nlohmann::json amend = nlohmann::json::parse(channel.frames[1]);
+      CHECK(amend["id"] == "2");
+      CHECK(amend["op"] == "amend-order");
+      CHECK(amend["args"][0]["newPx"] == "0.1");
+      CHECK(amend["args"][0]["newSz"] == "2.00000000");
+      CHECK(!amend["args"][0].contains("side"));
+
+      const nlohmann::json cancel = nlohmann::json::parse(channel.frames[2]);
+      CHECK(cancel["op"] == "cancel-order");
+      CHECK(cancel["args"][0].size() == 2);  // instId and clOrdId
+
+      // Values that cannot be written are refused before anything is queued
+      CHECK(gateway.placeOrder(Side::Buy, -1., 1., kNoTick) == 0);
+      CHECK(gateway.placeOrder(Side::Buy, 1e20, 1., kNoTick) == 0);
+      channel.loggedInFlag = false;
+      CHECK(gateway.placeOrder(Side::Buy, 1., 1., kNoTick) == 0);
+      CHECK(channel.frames.size() == 3);
+
+      bool threw = false;
+      try
+      {
+         ConfigManager::OrdersConfig config = ordersConfig(0, 20);
+         config.client_id_prefix = "bad-id";
+         OrderGateway invalid(channel, config);
+      }
+      catch (const std::invalid_argument &)
+      {
+         threw = true;
+      }
+      CHECK(threw);
+   }
+
+   void testBatchAcks()
+   {
+      PrivateChannel channel;
+      OrderGateway gateway(channel, ordersConfig(1000000, 3));
+      std::vector<OrderGateway::Ack> acks;
+      std::vector<OrderGateway::Submit> submits;
+      gateway.setAckHandler([&](const OrderGateway::Ack &ack)
+                            { acks.push_back(ack); });
+      gateway.setSubmitHandler([&](const OrderGateway::Submit &submit)
+                               { submits.push_back(submit); });
+
+      // The third placement fills the batch
+      uint64_t ids[3];
+      for (int i = 0; i < 3; i++)
+         ids[i] = gateway.placeOrder(Side::Buy, 100. + i, 1., kNoTick);
+      CHECK(submits.size() == 3);
+      CHECK(channel.frames.size() == 1);
+      const nlohmann::json batch = nlohmann::json::parse(channel.frames[0]);
+      CHECK(batch["op"] == "batch-orders");
+      CHECK(batch["args"].size() == 3);
+      CHECK(batch["args"][2]["px"] == "102.0");
+      CHECK(gateway.batchSizes().max() == 3);
+
+      // Results are matched by clOrdId, or by position when it is missing
+      const nlohmann::json data = nlohmann::json::array(
+          {{{"clOrdId", "t" + std::to_string(ids[1])}, {"ordId", "11"}, {"sCode", "0"}, {"sMsg", ""}},
+           {{"clOrdId", ""}, {"ordId", "12"}, {"sCode", "0"}, {"sMsg", ""}},
+           {{"clOrdId", "t" + std::to_string(ids[2])}, {"ordId", ""}, {"sCode", "51008"}, {"sMsg", "Insufficient balance"}}});
+      CHECK(gateway.onMessage(reply("1", "batch-orders", data)));
+      CHECK(acks.size() == 3);
+      CHECK(acks[0].clientId == ids[1] && acks[0].accepted && acks[0].orderId == "11");
+      CHECK(acks[1].clientId == ids[1]);  // Second in the request
+      CHECK(acks[2].clientId == ids[2] && !acks[2].accepted && acks[2].code == "51008");
+      CHECK(acks[0].batchSize == 3 && acks[0].requestId == 1);
+      CHECK(gateway.accepted() == 2 && gateway.rejected() == 1);
+      CHECK(gateway.ackLatency().count() == 1);
+
+      // A repeated reply is not matched to the request again
+      acks.clear();
+      CHECK(gateway.onMessage(reply("1", "batch-orders", data)));
+      CHECK(acks.size() == 3 && acks[1].clientId == 0);
+
+      // Another kind of operation sends what is queued first; flush sends the rest
+      CHECK(gateway.cancelOrder(ids[0], kNoTick));
+      CHECK(gateway.amendOrder(ids[0], 99., 1., kNoTick));
+      CHECK(channel.frames.size() == 2);
+      CHECK(nlohmann::json::parse(channel.frames[1])["op"] == "cancel-order");
+      gateway.flush();
+      CHECK(channel.frames.size() == 3);
+      CHECK(nlohmann::json::parse(channel.frames[2])["op"] == "amend-order");
+
+      // A request rejected as a whole acks every operation in it with its code
+      acks.clear();
+      CHECK(gateway.onMessage(reply("3", "amend-order", nlohmann::json::array(), "60012")));
+      CHECK(acks.size() == 1 && acks[0].clientId == ids[0] && acks[0].code == "60012" && !acks[0].accepted);
+
+      // Operations in a frame that could not be sent are acked as not sent
+      acks.clear();
+      channel.connected = false;
+      gateway.placeOrder(Side::Buy, 1., 1., kNoTick);
+      gateway.placeOrder(Side::Buy, 1., 1., kNoTick);
+      gateway.flush();
+      CHECK(acks.size() == 2);
+      CHECK(acks[0].message == "not sent" && acks[0].batchSize == 2 && !acks[0].accepted);
+
+      // Messages that are not order replies are left to other handlers
+      CHECK(!gateway.onMessage(R"({"event":"login","code":"0"})"));
+      CHECK(!gateway.onMessage(R"({"id":"9","op":"subscribe"})"));
+   }
+}
+
+int main()
+{
+   testFrames();
+   testBatchAcks();
+   return checkFailures();
+}
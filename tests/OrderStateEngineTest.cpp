@@ -0,0 +1,186 @@
+#include "Check.h"
+#include "OrderStateEngine.h"
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace
+{
+   using Op = OrderGateway::Op;
+   using State = OrderStateEngine::State;
+
+   OrderGateway::Submit submit(Op op, uint64_t clientId)
+   {
+      return {op, clientId, OrderGateway::Side::Buy, 100., 1.};
+   }
+
+   OrderGateway::Ack ack(Op op, uint64_t clientId, bool accepted, const std::string &orderId = "")
+   {
+      OrderGateway::Ack reply;
+      reply.op = op;
+      reply.clientId = clientId;
+      reply.accepted = accepted;
+      reply.code = accepted ? "0" : "51000";
+      reply.orderId = orderId;
+      return reply;
+   }
+
+   std::string push(uint64_t clientId, const char *state, long long uTime, const char *filled = "0")
+   {
+      return R"({"arg":{"channel":"orders","instType":"ANY"},"data":[{"clOrdId":"t)" + std::to_string(clientId) +
+             R"(","ordId":"77","state":")" + state + R"(","px":"101.5","sz":"2","accFillSz":")" + filled +
+             R"(","uTime":")" + std::to_string(uTime) + R"("}]})";
+   }
+
+   State stateOf(const OrderStateEngine &engine, uint64_t clientId)
+   {
+      OrderStateEngine::Order order;
+      return engine.find(clientId, order) ? order.state : State::Rejected;
+   }
+
+   void testLifecycle()
+   {
+      OrderStateEngine engine(16, "t");
+      engine.onSubmit(submit(Op::Place, 1));
+      CHECK(stateOf(engine, 1) == State::PendingNew);
+      engine.onAck(ack(Op::Place, 1, true, "77"));
+      OrderStateEngine::Order order;
+      CHECK(engine.find(1, order) && order.state == State::Live && order.orderId == 77 && !order.awaiting);
+
+      CHECK(engine.onMessage(push(1, "partially_filled", 10, "0.5")));
+      CHECK(engine.find(1, order) && order.state == State::PartiallyFilled && order.filled == 0.5 && order.price == 101.5);
+
+      // A failed amend returns to the state it left
+      engine.onSubmit(submit(Op::Amend, 1));
+      CHECK(stateOf(engine, 1) == State::PendingAmend);
+      engine.onAck(ack(Op::Amend, 1, false));
+      CHECK(stateOf(engine, 1) == State::PartiallyFilled);
+
+      // A failed cancel too; an accepted one completes on the channel
+      engine.onSubmit(submit(Op::Cancel, 1));
+      engine.onAck(ack(Op::Cancel, 1, false));
+      CHECK(stateOf(engine, 1) == State::PartiallyFilled);
+      engine.onSubmit(submit(Op::Cancel, 1));
+      engine.onAck(ack(Op::Cancel, 1, true));
+      CHECK(stateOf(engine, 1) == State::PendingCancel);
+      CHECK(engine.onMessage(push(1, "canceled", 20)));
+      CHECK(engine.openOrders() == 0);
+
+      engine.onSubmit(submit(Op::Place, 2));
+      engine.onAck(ack(Op::Place, 2, false));
+      engine.onSubmit(submit(Op::Place, 3));
+      engine.onAck(ack(Op::Place, 3, true));
+      CHECK(engine.onMessage(push(3, "filled", 30, "2")));
+      CHECK(engine.openOrders() == 0);
+
+      const OrderStateEngine::Counters counters = engine.counters();
+      CHECK(counters.inserted == 3);
+      CHECK(counters.canceled == 1);
+      CHECK(counters.rejected == 1);
+      CHECK(counters.filled == 1);
+   }
+
+   void testIgnoredReplies()
+   {
+      OrderStateEngine engine(16, "t");
+      engine.onSubmit(submit(Op::Place, 1));
+      engine.onAck(ack(Op::Place, 1, true));
+      engine.onAck(ack(Op::Place, 1, true));     // Nothing outstanding: stale
+      engine.onAck(ack(Op::Place, 9, true));     // Not in the table: unknown
+      engine.onMessage(push(1, "live", 50));
+      engine.onMessage(push(1, "filled", 40));  // Older than the last update: stale
+      engine.onMessage(push(9, "live", 50));
+      CHECK(!engine.onMessage(R"({"arg":{"channel":"tickers"}})"));
+      engine.onSubmit(submit(Op::Place, 1));     // Client id already tracked
+
+      const OrderStateEngine::Counters counters = engine.counters();
+      CHECK(counters.staleAcks == 1);
+      CHECK(counters.unknownAcks == 1);
+      CHECK(counters.staleUpdates == 1);
+      CHECK(counters.unknownUpdates == 1);
+      CHECK(counters.duplicates == 1);
+      CHECK(counters.tableFull == 0);
+      CHECK(stateOf(engine, 1) == State::Live);
+   }
+
+   void testTableFull()
+   {
+      OrderStateEngine engine(4, "t");
+      for (uint64_t id = 1; id <= 6; id++)
+         engine.onSubmit(submit(Op::Place, id));
+      CHECK(engine.openOrders() == 4);
+      CHECK(engine.counters().tableFull == 2);
+   }
+
+   // Random inserts and removals against a reference set: backward-shift
+   // deletion must keep every remaining order reachable
+   void testInsertErase()
+   {
+      OrderStateEngine engine(64, "t");
+      std::set<uint64_t> open;
+      std::mt19937_64 random(7);
+      for (int step = 0; step < 20000; step++)
+      {
+         // Ids from a narrow range collide often, in runs that wrap the table
+         const uint64_t id = 1 + random() % 96;
+         if (open.count(id))
+         {
+            engine.onAck(ack(Op::Place, id, false));
+            open.erase(id);
+         }
+         else if (open.size() < 64)
+         {
+            engine.onSubmit(submit(Op::Place, id));
+            open.insert(id);
+         }
+         if (step % 97 == 0)
+         {
+            CHECK(engine.openOrders() == open.size());
+            for (uint64_t probe = 1; probe <= 96; probe++)
+            {
+               OrderStateEngine::Order order;
+               CHECK(engine.find(probe, order) == (open.count(probe) == 1));
+            }
+         }
+      }
+   }
+
+   void testLogin()
+   {
+      OrderStateEngine engine(16, "t");
+      engine.onSubmit(submit(Op::Place, 1));
+      engine.onAck(ack(Op::Place, 1, true));
+      engine.onSubmit(submit(Op::Amend, 1));
+      engine.onSubmit(submit(Op::Place, 2));
+      engine.onSubmit(submit(Op::Place, 3));
+      engine.onAck(ack(Op::Place, 3, true));
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      const auto loginSent = std::chrono::steady_clock::now();
+      engine.onSubmit(submit(Op::Place, 4));
+      engine.onLogin(loginSent);
+
+      // The amend and the unacknowledged placement went out on the old connection
+      OrderStateEngine::Order order;
+      CHECK(engine.find(1, order) && order.state == State::Live && !order.awaiting);
+      CHECK(!engine.find(2, order));
+      CHECK(stateOf(engine, 3) == State::Live);
+      CHECK(engine.find(4, order) && order.state == State::PendingNew && order.awaiting);
+      CHECK(engine.counters().expiredRequests == 2);
+      CHECK(engine.counters().expired == 1);
+
+      // Their replies, should they come after all, are stale
+      engine.onAck(ack(Op::Amend, 1, true));
+      CHECK(engine.counters().staleAcks == 1);
+   }
+}
+
+int main()
+{
+   testLifecycle();
+   testIgnoredReplies();
+   testTableFull();
+   testInsertErase();
+   testLogin();
+   return checkFailures();
+}
@@ -0,0 +1,81 @@
+#include "Check.h"
+#include "RcuPointer.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   std::atomic<int> g_live{0};
+
+   struct Tracked
+   {
+      explicit Tracked(int value) : value(value) { g_live++; }
+      ~Tracked() { g_live--; }
+      int value;
+   };
+}
+
+int main()
+{
+   {
+      RcuPointer<Tracked> pointer(std::make_unique<const Tracked>(1));
+      CHECK(pointer.load()->value == 1);
+
+      // Without readers a replaced object is freed at once
+      pointer.publish(std::make_unique<const Tracked>(2));
+      CHECK(pointer.load()->value == 2);
+      CHECK(g_live == 1);
+
+      // A reader that has not passed a quiescent point keeps the old object alive
+      RcuPointer<Tracked>::Reader reader(pointer);
+      const Tracked *held = reader.get();
+      pointer.publish(std::make_unique<const Tracked>(3));
+      CHECK(g_live == 2);
+      CHECK(held->value == 2);
+      CHECK(pointer.reclaim() == 1);
+      reader.quiescent();
+      CHECK(reader.get()->value == 3);
+      CHECK(pointer.reclaim() == 0);
+      CHECK(g_live == 1);
+
+      // A reader registered after a publish does not hold back what came before it
+      pointer.publish(std::make_unique<const Tracked>(4));
+      RcuPointer<Tracked>::Reader late(pointer);
+      CHECK(pointer.reclaim() == 1);  // Still waiting for the first reader
+      reader.quiescent();
+      CHECK(pointer.reclaim() == 0);
+   }
+   CHECK(g_live == 0);
+
+   {
+      // Readers dereference while a writer keeps publishing; every value seen is intact
+      RcuPointer<Tracked> pointer(std::make_unique<const Tracked>(0));
+      std::atomic<bool> stop{false};
+      std::atomic<int> torn{0};
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 4; r++)
+         readers.emplace_back([&]()
+                              {
+            RcuPointer<Tracked>::Reader reader(pointer);
+            int last = 0;
+            while (!stop)
+            {
+               reader.quiescent();
+               const int value = reader.get()->value;
+               if (value < last)
+                  torn++;
+               last = value;
+            } });
+      for (int i = 1; i <= 20000; i++)
+         pointer.publish(std::make_unique<const Tracked>(i));
+      stop = true;
+      for (auto &thread : readers)
+         thread.join();
+      CHECK(torn == 0);
+      CHECK(pointer.reclaim() == 0);
+      CHECK(g_live == 1);
+   }
+   CHECK(g_live == 0);
+   return checkFailures();
+}
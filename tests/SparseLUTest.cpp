@@ -0,0 +1,113 @@
+#include "Check.h"
+#include "SparseLU.h"
+#include "SparseMatrix.h"
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+   // Residual max |A x - b| of a solve with the factors of A
+   double residual(const SparseMatrix &A, const SparseLU &lu, const std::vector<double> &b)
+   {
+      std::vector<double> x(b.size()), check(b.size());
+      lu.solve(b.data(), x.data());
+      A.multiply(x.data(), check.data());
+      double worst = 0.;
+      for (size_t i = 0; i < b.size(); i++)
+         worst = std::max(worst, std::fabs(check[i] - b[i]));
+      return worst;
+   }
+
+   std::vector<int> identityOrder(int n)
+   {
+      std::vector<int> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      return order;
+   }
+
+   void testRandom()
+   {
+      // Banded plus scattered entries, a few rows with a zero diagonal so pivoting is needed
+      const int n = 300;
+      std::mt19937 random(11);
+      std::uniform_real_distribution<double> value(-1., 1.);
+      SparseMatrix A(n);
+      for (int i = 0; i < n; i++)
+      {
+         std::vector<int> cols;
+         std::vector<double> values;
+         for (int j = 0; j < n; j++)
+         {
+            const bool band = j >= i - 2 && j <= i + 2;
+            if ((band && !(j == i && i % 10 == 0)) || random() % 100 == 0)
+            {
+               cols.push_back(j);
+               values.push_back(j == i ? 4. + value(random) : value(random));
+            }
+         }
+         A.appendRow(cols.data(), values.data(), (int)cols.size());
+      }
+      std::vector<double> b(n);
+      for (auto &entry : b)
+         entry = value(random);
+
+      SparseLU lu;
+      CHECK(lu.factor(A, A.minimumDegreeOrdering()) == 0);
+      CHECK(lu.size() == n);
+      CHECK(residual(A, lu, b) < 1e-9);
+
+      SparseLU natural;
+      CHECK(natural.factor(A, identityOrder(n)) == 0);
+      CHECK(residual(A, natural, b) < 1e-9);
+
+      // b and x may alias
+      std::vector<double> x = b;
+      lu.solve(x.data(), x.data());
+      std::vector<double> check(n);
+      A.multiply(x.data(), check.data());
+      for (int i = 0; i < n; i++)
+         CHECK_NEAR(check[i], b[i], 1e-9);
+   }
+
+   void testPermutation()
+   {
+      // Zero diagonal throughout: only row pivoting makes it factorable
+      SparseMatrix A(3);
+      const int cols[] = {1, 2, 0};
+      const double values[] = {2., 3., 4.};
+      for (int i = 0; i < 3; i++)
+         A.appendRow(&cols[i], &values[i], 1);
+      SparseLU lu;
+      CHECK(lu.factor(A, identityOrder(3)) == 0);
+      const double b[] = {2., 6., 12.};
+      double x[3];
+      lu.solve(b, x);
+      CHECK_NEAR(x[0], 3., 1e-12);
+      CHECK_NEAR(x[1], 1., 1e-12);
+      CHECK_NEAR(x[2], 2., 1e-12);
+   }
+
+   void testSingular()
+   {
+      SparseMatrix A(3);
+      const int cols[] = {0, 1};
+      const double row[] = {1., 2.};
+      const double twice[] = {2., 4.};
+      const int last[] = {2};
+      const double one[] = {1.};
+      A.appendRow(cols, row, 2);
+      A.appendRow(cols, twice, 2);
+      A.appendRow(last, one, 1);
+      SparseLU lu;
+      CHECK(lu.factor(A, identityOrder(3)) == -1);
+   }
+}
+
+int main()
+{
+   testRandom();
+   testPermutation();
+   testSingular();
+   return checkFailures();
+}
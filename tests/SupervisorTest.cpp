@@ -0,0 +1,186 @@
+#include "Check.h"
+#include "Supervisor.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   // Component that logs "start <name>" and "stop <name>" into events
+   Supervisor::Component logged(const std::string &name, std::vector<std::string> &events,
+                                std::vector<std::string> dependsOn = {})
+   {
+      Supervisor::Component component;
+      component.name = name;
+      component.dependsOn = std::move(dependsOn);
+      component.start = [&events, name]()
+      { events.push_back("start " + name); };
+      component.stop = [&events, name]()
+      { events.push_back("stop " + name); };
+      return component;
+   }
+
+   template <typename Exception, typename Call>
+   bool throws(Call call)
+   {
+      try
+      {
+         call();
+      }
+      catch (const Exception &)
+      {
+         return true;
+      }
+      return false;
+   }
+
+   void testOrder()
+   {
+      std::vector<std::string> events;
+      {
+         // Registered before what it depends on; d is independent and keeps its place
+         Supervisor supervisor;
+         supervisor.add(logged("c", events, {"b"}));
+         supervisor.add(logged("a", events));
+         supervisor.add(logged("d", events));
+         supervisor.add(logged("b", events, {"a"}));
+         supervisor.start();
+         CHECK(events == std::vector<std::string>({"start a", "start d", "start b", "start c"}));
+         CHECK(supervisor.health() == "c running\na running\nd running\nb running\n");
+         supervisor.stop();
+         CHECK(supervisor.health() == "c stopped\na stopped\nd stopped\nb stopped\n");
+         // Idempotent, and the destructor does not stop anything twice
+         supervisor.stop();
+      }
+      CHECK(events == std::vector<std::string>({"start a", "start d", "start b", "start c",
+                                                "stop c", "stop b", "stop d", "stop a"}));
+   }
+
+   void testRollback()
+   {
+      std::vector<std::string> events;
+      Supervisor supervisor;
+      supervisor.add(logged("a", events));
+      supervisor.add(logged("b", events, {"a"}));
+      Supervisor::Component failing = logged("c", events, {"b"});
+      failing.start = [&events]()
+      {
+         events.push_back("start c");
+         throw std::runtime_error("no route");
+      };
+      supervisor.add(failing);
+      supervisor.add(logged("d", events));
+
+      // What was started is stopped in reverse; the failed one is not stopped, d is never started
+      CHECK(throws<std::runtime_error>([&]()
+                                       { supervisor.start(); }));
+      CHECK(events == std::vector<std::string>({"start a", "start b", "start c", "stop b", "stop a"}));
+      CHECK(supervisor.health() == "a stopped\nb stopped\nc failed\nd registered\n");
+   }
+
+   void testOptional()
+   {
+      std::vector<std::string> events;
+      Supervisor supervisor;
+      Supervisor::Component account = logged("account", events);
+      account.optional = true;
+      account.start = []()
+      { throw std::runtime_error("no credentials"); };
+      Supervisor::Component orders = logged("orders", events, {"account"});
+      orders.optional = true;
+      supervisor.add(logged("feed", events));
+      supervisor.add(account);
+      supervisor.add(orders);
+      supervisor.add(logged("calculation", events));
+      supervisor.start();
+      CHECK(events == std::vector<std::string>({"start feed", "start calculation"}));
+      CHECK(supervisor.health() == "feed running\naccount failed\norders skipped\ncalculation running\n");
+      supervisor.stop();
+      CHECK(events.back() == "stop feed");
+
+      // A required dependent of a skipped component fails the start
+      std::vector<std::string> required;
+      Supervisor strict;
+      Supervisor::Component optional = logged("account", required);
+      optional.optional = true;
+      optional.start = []()
+      { throw std::runtime_error("no credentials"); };
+      strict.add(logged("feed", required));
+      strict.add(optional);
+      strict.add(logged("orders", required, {"account"}));
+      CHECK(throws<std::runtime_error>([&]()
+                                       { strict.start(); }));
+      CHECK(required == std::vector<std::string>({"start feed", "stop feed"}));
+   }
+
+   void testInvalid()
+   {
+      std::vector<std::string> events;
+      Supervisor supervisor;
+      supervisor.add(logged("a", events));
+      CHECK(throws<std::invalid_argument>([&]()
+                                          { supervisor.add(logged("a", events)); }));
+      CHECK(throws<std::invalid_argument>([&]()
+                                          { supervisor.add(logged("", events)); }));
+
+      Supervisor unknown;
+      unknown.add(logged("a", events, {"missing"}));
+      CHECK(throws<std::invalid_argument>([&]()
+                                          { unknown.start(); }));
+
+      Supervisor cycle;
+      cycle.add(logged("a", events, {"b"}));
+      cycle.add(logged("b", events, {"a"}));
+      CHECK(throws<std::invalid_argument>([&]()
+                                          { cycle.start(); }));
+      CHECK(events.empty());
+   }
+
+   void testRun()
+   {
+      // A run hook that throws stops the others long before the run time is over
+      std::vector<std::string> events;
+      std::atomic<bool> polled{false};
+      Supervisor supervisor;
+      Supervisor::Component feed = logged("feed", events);
+      feed.run = [&](std::atomic<bool> &stop)
+      {
+         while (!stop)
+         {
+            polled = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      };
+      // Stopped only once its thread has been joined
+      feed.stop = [&]()
+      { events.push_back(polled ? "stop feed after run" : "stop feed"); };
+      Supervisor::Component worker = logged("worker", events, {"feed"});
+      worker.run = [&](std::atomic<bool> &)
+      {
+         while (!polled)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         throw std::runtime_error("out of memory");
+      };
+      supervisor.add(feed);
+      supervisor.add(worker);
+      supervisor.start();
+      const auto begin = std::chrono::steady_clock::now();
+      supervisor.run(std::chrono::seconds(30));
+      CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(10));
+      CHECK(events == std::vector<std::string>({"start feed", "start worker", "stop worker", "stop feed after run"}));
+      CHECK(supervisor.health() == "feed stopped\nworker failed\n");
+   }
+}
+
+int main()
+{
+   testOrder();
+   testRollback();
+   testOptional();
+   testInvalid();
+   testRun();
+   return checkFailures();
+}
@@ -0,0 +1,129 @@
+#include "Check.h"
+#include "TcpTransport.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+   // The wire format, as TcpTransport writes it
+   constexpr uint32_t kMagic = 0x54524e53;
+   struct Hello
+   {
+      uint32_t magic;
+      int32_t rank;
+   };
+   struct FrameHeader
+   {
+      uint32_t magic;
+      int32_t source;
+      uint64_t tag;
+      uint64_t count;
+   };
+
+   std::string endpoint(int port)
+   {
+      return "127.0.0.1:" + std::to_string(port);
+   }
+
+   // Connect to 127.0.0.1:port as the given rank, retrying while the listener starts
+   int connectAs(int port, int rank)
+   {
+      for (int attempt = 0; attempt < 100; attempt++)
+      {
+         int fd = socket(AF_INET, SOCK_STREAM, 0);
+         sockaddr_in address;
+         memset(&address, 0, sizeof(address));
+         address.sin_family = AF_INET;
+         address.sin_port = htons(port);
+         address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+         if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+         {
+            const Hello hello = {kMagic, rank};
+            if (write(fd, &hello, sizeof(hello)) == (ssize_t)sizeof(hello))
+               return fd;
+         }
+         close(fd);
+         std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      return -1;
+   }
+
+   void testExchange(int port)
+   {
+      const std::vector<std::string> endpoints = {endpoint(port), endpoint(port + 1)};
+      std::unique_ptr<TcpTransport> higher;
+      std::thread joining([&]()
+                          { higher = std::make_unique<TcpTransport>(1, endpoints, 16, std::chrono::seconds(5)); });
+      TcpTransport lower(0, endpoints, 16, std::chrono::seconds(5));
+      joining.join();
+
+      const double values[3] = {1., 2., 3.};
+      lower.send(1, 7, values, 3);
+      double received[3] = {};
+      higher->receive(0, 7, received, 3);
+      CHECK(received[2] == 3.);
+      higher->send(0, 8, values, 1);
+      lower.receive(1, 8, received, 1);
+      CHECK(received[0] == 1.);
+   }
+
+   void testOversizedFrame(int port)
+   {
+      // Rank 1 is played by hand: a frame claiming 2^40 doubles must not be allocated
+      const std::vector<std::string> endpoints = {endpoint(port), endpoint(port + 1)};
+      int peer = -1;
+      std::thread joining([&]()
+                          { peer = connectAs(port, 1); });
+      TcpTransport lower(0, endpoints, 16, std::chrono::seconds(5));
+      joining.join();
+      CHECK(peer >= 0);
+      const FrameHeader header = {kMagic, 1, 9, uint64_t(1) << 40};
+      CHECK(write(peer, &header, sizeof(header)) == (ssize_t)sizeof(header));
+
+      bool threw = false;
+      double value;
+      try
+      {
+         lower.receive(1, 9, &value, 1);
+      }
+      catch (const std::runtime_error &e)
+      {
+         threw = std::string(e.what()).find("exceeds the limit") != std::string::npos;
+      }
+      CHECK(threw);
+      close(peer);
+   }
+
+   void testListensOnListedHost(int port)
+   {
+      // With the listener on 127.0.0.1 alone, another loopback address can still take the port
+      const std::vector<std::string> endpoints = {endpoint(port)};
+      TcpTransport alone(0, endpoints, 16, std::chrono::seconds(1));
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = inet_addr("127.0.0.2");
+      CHECK(bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+      CHECK(listen(fd, 1) == 0);
+      close(fd);
+   }
+}
+
+int main()
+{
+   const int port = 20000 + getpid() % 20000;
+   testExchange(port);
+   testOversizedFrame(port + 2);
+   testListensOnListedHost(port + 4);
+   return checkFailures();
+}
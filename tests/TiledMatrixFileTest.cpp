@@ -0,0 +1,89 @@
+#include "Check.h"
+#include "TiledMatrixFile.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+   std::vector<double> randomMatrix(int n, unsigned int seed)
+   {
+      std::minstd_rand random(seed);
+      std::uniform_real_distribution<double> value(0., 10.);
+      std::vector<double> A((size_t)n * n);
+      for (auto &entry : A)
+         entry = value(random);
+      return A;
+   }
+
+   // Invert A through a scratch file; returns max |A * inverse - I|, or -1 if invert() failed
+   double invertedResidual(const std::vector<double> &A, int n, int tileSize, int cacheTiles, uint64_t *pivots = nullptr)
+   {
+      TiledMatrixFile file(n, tileSize, cacheTiles, "/tmp");
+      for (int i = 0; i < n; i++)
+         file.setRow(i, A.data() + (size_t)i * n);
+      if (file.invert() != 0)
+         return -1.;
+      if (pivots)
+         *pivots = file.stats().pivots;
+      std::vector<double> product((size_t)n * n);
+      file.multiplyRowsLeft(n, A.data(), product.data());
+      double worst = 0.;
+      for (int i = 0; i < n; i++)
+         for (int j = 0; j < n; j++)
+            worst = std::max(worst, std::fabs(product[(size_t)i * n + j] - (i == j ? 1. : 0.)));
+      return worst;
+   }
+
+   void testRandom()
+   {
+      // Padded last tiles, and the smallest cache the sweep accepts
+      const int n = 150;
+      const std::vector<double> A = randomMatrix(n, 1);
+      const double residual = invertedResidual(A, n, 32, 0);
+      CHECK(residual >= 0. && residual < 1e-10);
+   }
+
+   void testSingularDiagonalTiles()
+   {
+      // [[0, I], [I, 0]] with tiles of half its size: both diagonal tiles are zero
+      const int n = 8;
+      std::vector<double> A((size_t)n * n, 0.);
+      for (int i = 0; i < n; i++)
+         A[(size_t)i * n + (i + n / 2) % n] = 1.;
+      uint64_t pivots = 0;
+      CHECK(invertedResidual(A, n, 4, 0, &pivots) == 0.);
+      CHECK(pivots == 4);
+   }
+
+   void testSmallDiagonalTile()
+   {
+      // A leading tile scaled down is as well conditioned as before, yet
+      // eliminating with it unpivoted loses every digit the scale costs
+      const int n = 96;
+      std::vector<double> A = randomMatrix(n, 2);
+      for (int i = 0; i < 32; i++)
+         for (int j = 0; j < 32; j++)
+            A[(size_t)i * n + j] *= 1e-8;
+      const double residual = invertedResidual(A, n, 32, 0);
+      CHECK(residual >= 0. && residual < 1e-10);
+   }
+
+   void testSingular()
+   {
+      const int n = 64;
+      std::vector<double> A = randomMatrix(n, 3);
+      for (int i = 0; i < n; i++)
+         A[(size_t)i * n + 40] = 0.;
+      CHECK(invertedResidual(A, n, 16, 0) == -1.);
+   }
+}
+
+int main()
+{
+   testRandom();
+   testSingularDiagonalTiles();
+   testSmallDiagonalTile();
+   testSingular();
+   return checkFailures();
+}
@@ -0,0 +1,26 @@
+#ifndef PRIVATE_CHANNEL_H
+#define PRIVATE_CHANNEL_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Stand-in for the private channel in OrderGatewayTest: records frames instead of sending them
+ */
+class PrivateChannel {
+public:
+    bool send(const std::string& frame)
+    {
+        if (!connected)
+            return false;
+        frames.push_back(frame);
+        return true;
+    }
+    bool loggedIn() const { return loggedInFlag; }
+
+    bool loggedInFlag = true;
+    bool connected = true;  // send() fails when false
+    std::vector<std::string> frames;
+};
+
+#endif // PRIVATE_CHANNEL_H